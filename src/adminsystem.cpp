@@ -35,6 +35,7 @@
 #include "gamesystem.h"
 #include "votemanager.h"
 #include "map_votes.h"
+#include "sharedcache.h"
 #include <vector>
 
 extern IVEngineServer2 *g_pEngineServer2;
@@ -44,7 +45,10 @@ extern CCSGameRules *g_pGameRules;
 
 CAdminSystem* g_pAdminSystem = nullptr;
 
-CUtlMap<uint32, CChatCommand *> g_CommandList(0, 0, DefLessFunc(uint32));
+static bool g_bAdminHotReload = true;
+FAKE_BOOL_CVAR(cs2f_admins_hot_reload, "Whether to reload admins.cfg automatically when it changes", g_bAdminHotReload, true, false)
+
+CUtlVector<CChatCommand *> g_CommandList;
 
 void ParseInfraction(const CCommand &args, CCSPlayerController* pAdmin, bool bAdding, CInfractionBase::EInfractionType infType);
 const char* GetActionPhrase(CInfractionBase::EInfractionType infType, GrammarTense iTense, bool bAdding);
@@ -117,15 +121,7 @@ CON_COMMAND_F(c_reload_admins, "Reload admin config", FCVAR_SPONLY | FCVAR_LINKE
 	if (!g_pAdminSystem->LoadAdmins())
 		return;
 
-	for (int i = 0; i < gpGlobals->maxClients; i++)
-	{
-		ZEPlayer* pPlayer = g_playerManager->GetPlayer(i);
-
-		if (!pPlayer || pPlayer->IsFakeClient() || !pPlayer->IsAuthenticated())
-			continue;
-
-		pPlayer->CheckAdmin();
-	}
+	g_pAdminSystem->ReapplyAdmins();
 
 	Message("Admins reloaded\n");
 }
@@ -171,8 +167,6 @@ CON_COMMAND_CHAT_FLAGS(unban, "<steamid64> - Unban a player. Takes decimal STEAM
 		return;		
 	}
 
-	g_pAdminSystem->SaveInfractions();
-
 	// no need to broadcast this
 	ClientPrint(player, HUD_PRINTTALK, CHAT_PREFIX "User with STEAMID64 <%llu> has been unbanned.", iTargetSteamId64);
 }
@@ -625,7 +619,7 @@ CON_COMMAND_CHAT_FLAGS(map, "<mapname> - Change map", ADMFLAG_CHANGEMAP)
 
 		ClientPrintAll(HUD_PRINTTALK, CHAT_PREFIX "Changing map to %s...", pszMapName);
 
-		new CTimer(5.0f, false, true, [sCommand]()
+		new CTimer("map_change", 5.0f, false, true, [sCommand]()
 		{
 			g_pEngineServer2->ServerCommand(sCommand.c_str());
 			return -1.0f;
@@ -636,7 +630,7 @@ CON_COMMAND_CHAT_FLAGS(map, "<mapname> - Change map", ADMFLAG_CHANGEMAP)
 
 	ClientPrintAll(HUD_PRINTTALK, CHAT_PREFIX "Changing map to %s...", pszMapName);
 
-	new CTimer(5.0f, false, true, [sMapName]()
+	new CTimer("map_change", 5.0f, false, true, [sMapName]()
 	{
 		g_pEngineServer2->ChangeLevel(sMapName.c_str(), nullptr);
 		return -1.0f;
@@ -753,16 +747,12 @@ CON_COMMAND_CHAT_FLAGS(pm, "<name> <message> - Private message a player. This wi
 		return;
 	}
 
-	for (int i = 0; i < gpGlobals->maxClients; i++)
-	{
-		ZEPlayer* pPlayer = g_playerManager->GetPlayer(i);
+	uint64 iAdmins = g_playerManager->GetAdminMask(ADMFLAG_GENERIC) & ~(1ull << pTarget->GetPlayerSlot());
 
-		if (!pPlayer || pTargetPlayer == pPlayer)
-			continue;
+	if (player)
+		iAdmins &= ~(1ull << player->GetPlayerSlot());
 
-		if (pPlayer->IsAdminFlagSet(ADMFLAG_GENERIC) && CCSPlayerController::FromSlot(i) != player)
-			ClientPrint(CCSPlayerController::FromSlot(i), HUD_PRINTTALK, "\x0A[PM to %s]\x0C %s\1: \x0B%s", pTarget->GetPlayerName(), pszName, strMessage.c_str());
-	}
+	ClientPrintMask(iAdmins, HUD_PRINTTALK, "\x0A[PM to %s]\x0C %s\1: \x0B%s", pTarget->GetPlayerName(), pszName, strMessage.c_str());
 
 	ClientPrint(player, HUD_PRINTTALK, "\x0A[PM to %s]\x0C %s\1: \x0B%s", pTarget->GetPlayerName(), pszName, strMessage.c_str());
 	ClientPrint(pTarget, HUD_PRINTTALK, "\x0A[PM]\x0C %s\1: \x0B%s", pszName, strMessage.c_str());
@@ -1000,82 +990,105 @@ CON_COMMAND_CHAT_FLAGS(add_dc, "<name> <SteamID 64> <IP Address> - Adds a fake p
 
 CAdminSystem::CAdminSystem()
 {
+	m_infractionJournal.Start();
+
 	LoadAdmins();
 	LoadInfractions();
 
+	char szPath[MAX_PATH];
+	V_snprintf(szPath, sizeof(szPath), "%s%s", Plat_GetGameDirectory(), "/csgo/addons/cs2fixes/configs/admins.cfg");
+	m_adminWatcher.Start(szPath);
+
 	// Fill out disconnected player list with empty objects which we overwrite as players leave
 	for (int i = 0; i < 20; i++)
 		m_rgDCPly[i] = std::tuple<std::string, uint64, std::string>("", 0, "");
 	m_iDCPlyIndex = 0;
 }
 
+CAdminSystem::~CAdminSystem()
+{
+	m_adminWatcher.Stop();
+	delete m_pAdmins;
+}
+
 bool CAdminSystem::LoadAdmins()
 {
-	m_vecAdmins.Purge();
-	KeyValues* pKV = new KeyValues("admins");
-	KeyValues::AutoDelete autoDelete(pKV);
+	char szPath[MAX_PATH];
+	V_snprintf(szPath, sizeof(szPath), "%s%s", Plat_GetGameDirectory(), "/csgo/addons/cs2fixes/configs/admins.cfg");
 
-	const char *pszPath = "addons/cs2fixes/configs/admins.cfg";
+	CAdminTable *pAdmins = CAdminTable::Parse(szPath, true);
 
-	if (!pKV->LoadFromFile(g_pFullFileSystem, pszPath))
-	{
-		Warning("Failed to load %s\n", pszPath);
+	// Keep whatever was loaded before rather than end up with half a list
+	if (!pAdmins)
 		return false;
-	}
-	for (KeyValues* pKey = pKV->GetFirstSubKey(); pKey; pKey = pKey->GetNextKey())
-	{
-		const char *pszName = pKey->GetName();
-		const char *pszSteamID = pKey->GetString("steamid", nullptr);
-		const char *pszFlags = pKey->GetString("flags", nullptr);
-		int iImmunityLevel = pKey->GetInt("immunity", -1);
 
-		if (!pszSteamID)
-		{
-			Warning("Admin entry %s is missing 'steam' key\n", pszName);
-			return false;
-		}
+	SetAdmins(pAdmins);
+	g_sharedCache.PublishAdmins(pAdmins);
 
-		if (!pszFlags)
-		{
-			Warning("Admin entry %s is missing 'flags' key\n", pszName);
-			return false;
-		}
+	return true;
+}
 
-		if (iImmunityLevel < 0)
-		{
-			Warning("Admin entry %s is missing 'immunity' key\n", pszName);
-			iImmunityLevel = 0; // Zero is default immunity, so set that if not given
-		}
+// Takes ownership, FindAdmin results from before are gone
+void CAdminSystem::SetAdmins(CAdminTable *pAdmins)
+{
+	delete m_pAdmins;
+	m_pAdmins = pAdmins;
+}
 
-		ConMsg("Loaded admin %s\n", pszName);
-		ConMsg(" - Steam ID: %5s\n", pszSteamID);
-		ConMsg(" - Flags: %5s\n", pszFlags);
-		ConMsg(" - Immunity: %i\n", iImmunityLevel);
+void CAdminSystem::ReapplyAdmins()
+{
+	for (int i = 0; i < gpGlobals->maxClients; i++)
+	{
+		ZEPlayer* pPlayer = g_playerManager->GetPlayer(i);
 
-		uint64 iFlags = ParseFlags(pszFlags);
+		if (!pPlayer || pPlayer->IsFakeClient() || !pPlayer->IsAuthenticated())
+			continue;
 
-		// Let's just use steamID64 for now
-		m_vecAdmins.AddToTail(CAdmin(pszName, atoll(pszSteamID), iFlags, iImmunityLevel));
+		pPlayer->CheckAdmin();
 	}
+}
 
-	return true;
+// Swaps in admins.cfg once the watcher has parsed a new version of it
+void CAdminSystem::RunFrame()
+{
+	CAdminTable *pAdmins = m_adminWatcher.TakeReloaded();
+
+	if (!pAdmins)
+		return;
+
+	if (!g_bAdminHotReload)
+	{
+		delete pAdmins;
+		return;
+	}
+
+	SetAdmins(pAdmins);
+	ReapplyAdmins();
+	g_sharedCache.PublishAdmins(pAdmins);
+
+	Message("Admins reloaded, %i admins\n", m_pAdmins->Count());
 }
 
 bool CAdminSystem::LoadInfractions()
 {
-	m_vecInfractions.PurgeAndDeleteElements();
+	// Anything still being written has to be on disk before it's read back
+	m_infractionJournal.Flush();
+
+	ClearInfractions();
 	KeyValues* pKV = new KeyValues("infractions");
 	KeyValues::AutoDelete autoDelete(pKV);
 
 	const char *pszPath = "addons/cs2fixes/data/infractions.txt";
+	bool bLoaded = pKV->LoadFromFile(g_pFullFileSystem, pszPath);
 
-	if (!pKV->LoadFromFile(g_pFullFileSystem, pszPath))
-	{
+	if (!bLoaded)
 		Warning("Failed to load %s\n", pszPath);
-		return false;
-	}
 
-	for (KeyValues* pKey = pKV->GetFirstSubKey(); pKey; pKey = pKey->GetNextKey())
+	// A bad entry is skipped rather than ending the load, the journal still has to be replayed after it
+	// Nothing can be lost when there's no file yet
+	bool bComplete = bLoaded || !g_pFullFileSystem->FileExists(pszPath);
+
+	for (KeyValues* pKey = bLoaded ? pKV->GetFirstSubKey() : nullptr; pKey; pKey = pKey->GetNextKey())
 	{
 		uint64 iSteamId = pKey->GetUint64("steamid", -1);
 		time_t iEndTime = pKey->GetUint64("endtime", -1);
@@ -1083,109 +1096,359 @@ bool CAdminSystem::LoadInfractions()
 
 		if (iSteamId == -1)
 		{
-			Warning("Infraction entry is missing 'steam' key\n");
-			return false;
+			Warning("Infraction entry %s is missing 'steamid' key, skipping it\n", pKey->GetName());
+			bComplete = false;
+			continue;
 		}
 
 		if (iEndTime == -1)
 		{
-			Warning("Infraction entry is missing 'endtime' key\n");
-			return false;
+			Warning("Infraction entry %s is missing 'endtime' key, skipping it\n", pKey->GetName());
+			bComplete = false;
+			continue;
 		}
 
 		if (iType == -1)
 		{
-			Warning("Infraction entry is missing 'type' key\n");
-			return false;
+			Warning("Infraction entry %s is missing 'type' key, skipping it\n", pKey->GetName());
+			bComplete = false;
+			continue;
 		}
 
-		switch (iType)
+		if (CInfractionBase *pInfraction = CreateInfraction(iType, iEndTime, iSteamId))
+			IndexInfraction(pInfraction);
+		else
+			bComplete = false;
+	}
+
+	// Then every change made since infractions.txt was last written, replaying one that's already in there changes nothing
+	std::vector<JournalEntry_t> vecEntries;
+	m_infractionJournal.Read(vecEntries);
+
+	for (const JournalEntry_t &entry : vecEntries)
+	{
+		CInfractionBase *pExisting = FindInfraction(entry.record.iSteamID, entry.record.iType, entry.record.iEndTime);
+
+		if (entry.nOp == EJournalOp::REMOVE && pExisting)
+			RemoveInfraction(pExisting);
+		else if (entry.nOp == EJournalOp::ADD && !pExisting)
 		{
-		case CInfractionBase::Ban:
-			AddInfraction(new CBanInfraction(iEndTime, iSteamId, true));
-			break;
-		case CInfractionBase::Mute:
-			AddInfraction(new CMuteInfraction(iEndTime, iSteamId, true));
-			break;
-		case CInfractionBase::Gag:
-			AddInfraction(new CGagInfraction(iEndTime, iSteamId, true));
-			break;
-		default:
-			Warning("Invalid infraction type %d\n", iType);
+			if (CInfractionBase *pInfraction = CreateInfraction(entry.record.iType, entry.record.iEndTime, entry.record.iSteamID))
+				IndexInfraction(pInfraction);
 		}
 	}
 
-	return true;
+	m_bInfractionsComplete = bComplete;
+
+	// Start the next journal from a snapshot that has all of it, unless some of the old one couldn't be read
+	if (!bComplete)
+		Warning("Not compacting the infraction journal until %s loads cleanly\n", pszPath);
+	else if (!vecEntries.empty())
+		SaveInfractions();
+
+	return bLoaded;
 }
 
+// Hands a copy of every infraction to the journal's writer thread, which replaces infractions.txt with it
 void CAdminSystem::SaveInfractions()
 {
-	KeyValues* pKV = new KeyValues("infractions");
-	KeyValues* pSubKey;
-	KeyValues::AutoDelete autoDelete(pKV);
+	// The journal keeps growing instead, a snapshot now would drop whatever couldn't be read for good
+	if (!m_bInfractionsComplete)
+		return;
+
+	std::vector<InfractionRecord_t> vecInfractions;
+	GetInfractionRecords(vecInfractions);
+
+	m_infractionJournal.Compact(std::move(vecInfractions));
+}
+
+// Every infraction that hasn't run out yet
+void CAdminSystem::GetInfractionRecords(std::vector<InfractionRecord_t> &vecInfractions)
+{
+	vecInfractions.clear();
+	vecInfractions.reserve(m_vecInfractions.Count());
+
+	time_t iNow = std::time(0);
 
 	FOR_EACH_VEC(m_vecInfractions, i)
 	{
 		time_t timestamp = m_vecInfractions[i]->GetTimestamp();
-		if (timestamp != 0 && timestamp < std::time(0))
+		if (timestamp != 0 && timestamp < iNow)
 			continue;
 
-		char buf[5];
-		V_snprintf(buf, sizeof(buf), "%d", i);
-		pSubKey = new KeyValues(buf);
-		pSubKey->AddUint64("steamid", m_vecInfractions[i]->GetSteamId64());
-		pSubKey->AddUint64("endtime", m_vecInfractions[i]->GetTimestamp());
-		pSubKey->AddInt("type", m_vecInfractions[i]->GetType());
+		vecInfractions.push_back({m_vecInfractions[i]->GetSteamId64(), timestamp, m_vecInfractions[i]->GetType()});
+	}
+}
 
-		pKV->AddSubKey(pSubKey);
+CInfractionBase *CAdminSystem::CreateInfraction(int iType, time_t iEndTime, uint64 iSteamID)
+{
+	switch (iType)
+	{
+	case CInfractionBase::Ban:
+		return new CBanInfraction(iEndTime, iSteamID, true);
+	case CInfractionBase::Mute:
+		return new CMuteInfraction(iEndTime, iSteamID, true);
+	case CInfractionBase::Gag:
+		return new CGagInfraction(iEndTime, iSteamID, true);
+	default:
+		Warning("Invalid infraction type %d\n", iType);
 	}
 
-	char szPath[MAX_PATH];
-	V_snprintf(szPath, sizeof(szPath), "%s%s", Plat_GetGameDirectory(), "/csgo/addons/cs2fixes/data/infractions.txt");
+	return nullptr;
+}
+
+CInfractionBase *CAdminSystem::FindInfraction(uint64 iSteamID, int iType, time_t iEndTime)
+{
+	CInfractionBase **ppNewest = m_mapInfractions.Find(iSteamID);
+
+	for (CInfractionBase *pInfraction = ppNewest ? *ppNewest : nullptr; pInfraction; pInfraction = pInfraction->m_pNextForPlayer)
+	{
+		if (pInfraction->GetType() == iType && pInfraction->GetTimestamp() == iEndTime)
+			return pInfraction;
+	}
+
+	return nullptr;
+}
+
+// Only changes made by admins are journaled, expired infractions are dropped on the next snapshot
+void CAdminSystem::JournalInfraction(EJournalOp nOp, CInfractionBase *pInfraction)
+{
+	InfractionRecord_t record = {pInfraction->GetSteamId64(), pInfraction->GetTimestamp(), pInfraction->GetType()};
 
-	// Create the directory in case it doesn't exist
-	g_pFullFileSystem->CreateDirHierarchyForFile(szPath, nullptr);
+	m_infractionJournal.Append(nOp, record);
+	g_sharedCache.PublishInfraction(nOp, record);
 
-	if (!pKV->SaveToFile(g_pFullFileSystem, szPath))
-		Warning("Failed to save infractions to %s\n", szPath);
+	if (m_infractionJournal.ShouldCompact())
+		SaveInfractions();
 }
 
 void CAdminSystem::AddInfraction(CInfractionBase* infraction)
 {
-	m_vecInfractions.AddToTail(infraction);
+	IndexInfraction(infraction);
+	JournalInfraction(EJournalOp::ADD, infraction);
 }
 
+void CAdminSystem::IndexInfraction(CInfractionBase* infraction)
+{
+	infraction->m_iIndex = m_vecInfractions.AddToTail(infraction);
 
-// This function can run at least twice when a player connects: Immediately upon client connection, and also upon getting authenticated by steam.
-// It's also run when we're periodically checking for infraction expiry in the case of mutes/gags.
-// This returns false only when called from ClientConnect and the player is banned in order to reject them.
-bool CAdminSystem::ApplyInfractions(ZEPlayer *player)
+	CInfractionBase **ppNewest = m_mapInfractions.Find(infraction->GetSteamId64());
+
+	if (ppNewest)
+	{
+		infraction->m_pNextForPlayer = *ppNewest;
+		*ppNewest = infraction;
+	}
+	else
+	{
+		m_mapInfractions.Insert(infraction->GetSteamId64(), infraction);
+	}
+
+	if (infraction->GetTimestamp() != 0)
+	{
+		infraction->m_iHeapIndex = m_vecExpiryHeap.AddToTail(infraction);
+		SiftExpiryHeapUp(infraction->m_iHeapIndex);
+	}
+}
+
+// Takes the infraction out of every index and deletes it
+void CAdminSystem::RemoveInfraction(CInfractionBase *pInfraction)
 {
-	FOR_EACH_VEC(m_vecInfractions, i)
+	uint64 iSteamID = pInfraction->GetSteamId64();
+	CInfractionBase **ppNewest = m_mapInfractions.Find(iSteamID);
+
+	if (ppNewest && *ppNewest == pInfraction)
 	{
-		// Because this can run without the player being authenticated, and the fact that we're applying a ban/mute here,
-		// we can immediately just use the steamid we got from the connecting player.
-		uint64 iSteamID = player->IsAuthenticated() ? player->GetSteamId64() : player->GetUnauthenticatedSteamId64();
+		if (pInfraction->m_pNextForPlayer)
+			*ppNewest = pInfraction->m_pNextForPlayer;
+		else
+			m_mapInfractions.Remove(iSteamID);
+	}
+	else if (ppNewest)
+	{
+		CInfractionBase *pPrev = *ppNewest;
 
-		// We're only interested in infractions concerning this player
-		if (m_vecInfractions[i]->GetSteamId64() != iSteamID)
-			continue;
+		while (pPrev->m_pNextForPlayer && pPrev->m_pNextForPlayer != pInfraction)
+			pPrev = pPrev->m_pNextForPlayer;
 
-		// Undo the infraction just briefly while checking if it ran out
-		m_vecInfractions[i]->UndoInfraction(player);
+		pPrev->m_pNextForPlayer = pInfraction->m_pNextForPlayer;
+	}
 
-		time_t timestamp = m_vecInfractions[i]->GetTimestamp();
-		if (timestamp != 0 && timestamp <= std::time(0))
+	int iHeapIndex = pInfraction->m_iHeapIndex;
+
+	if (iHeapIndex != -1)
+	{
+		int iLast = m_vecExpiryHeap.Count() - 1;
+
+		SwapExpiryHeap(iHeapIndex, iLast);
+		m_vecExpiryHeap.RemoveMultipleFromTail(1);
+
+		if (iHeapIndex < iLast)
 		{
-			m_vecInfractions.Remove(i);
-			continue;
+			SiftExpiryHeapDown(iHeapIndex);
+			SiftExpiryHeapUp(iHeapIndex);
 		}
+	}
+
+	int iIndex = pInfraction->m_iIndex;
+
+	m_vecInfractions.FastRemove(iIndex);
+
+	if (iIndex < m_vecInfractions.Count())
+		m_vecInfractions[iIndex]->m_iIndex = iIndex;
+
+	delete pInfraction;
+}
+
+void CAdminSystem::ClearInfractions()
+{
+	m_vecInfractions.PurgeAndDeleteElements();
+	m_mapInfractions.Clear();
+	m_vecExpiryHeap.Purge();
+}
+
+void CAdminSystem::SwapExpiryHeap(int i, int j)
+{
+	CInfractionBase *pTemp = m_vecExpiryHeap[i];
+	m_vecExpiryHeap[i] = m_vecExpiryHeap[j];
+	m_vecExpiryHeap[j] = pTemp;
+
+	m_vecExpiryHeap[i]->m_iHeapIndex = i;
+	m_vecExpiryHeap[j]->m_iHeapIndex = j;
+}
+
+void CAdminSystem::SiftExpiryHeapUp(int i)
+{
+	while (i > 0)
+	{
+		int iParent = (i - 1) / 2;
+
+		if (m_vecExpiryHeap[iParent]->GetTimestamp() <= m_vecExpiryHeap[i]->GetTimestamp())
+			break;
+
+		SwapExpiryHeap(i, iParent);
+		i = iParent;
+	}
+}
+
+void CAdminSystem::SiftExpiryHeapDown(int i)
+{
+	int iCount = m_vecExpiryHeap.Count();
+
+	while (true)
+	{
+		int iSmallest = i;
+		int iLeft = i * 2 + 1;
+		int iRight = iLeft + 1;
+
+		if (iLeft < iCount && m_vecExpiryHeap[iLeft]->GetTimestamp() < m_vecExpiryHeap[iSmallest]->GetTimestamp())
+			iSmallest = iLeft;
+
+		if (iRight < iCount && m_vecExpiryHeap[iRight]->GetTimestamp() < m_vecExpiryHeap[iSmallest]->GetTimestamp())
+			iSmallest = iRight;
+
+		if (iSmallest == i)
+			break;
+
+		SwapExpiryHeap(i, iSmallest);
+		i = iSmallest;
+	}
+}
+
+// A change made on another server on this machine, journaled here too so this server's files have it after a restart
+// It goes straight to the journal rather than through JournalInfraction, which would publish it right back
+void CAdminSystem::ApplySharedInfraction(EJournalOp nOp, const InfractionRecord_t &record)
+{
+	CInfractionBase *pExisting = FindInfraction(record.iSteamID, record.iType, record.iEndTime);
+	ZEPlayer *pPlayer = g_playerManager->GetPlayerFromUnauthenticatedSteamId(record.iSteamID);
+
+	if (nOp == EJournalOp::ADD && !pExisting)
+	{
+		CInfractionBase *pInfraction = CreateInfraction(record.iType, record.iEndTime, record.iSteamID);
+
+		if (!pInfraction)
+			return;
+
+		IndexInfraction(pInfraction);
+	}
+	else if (nOp == EJournalOp::REMOVE && pExisting)
+	{
+		if (pPlayer)
+			pExisting->UndoInfraction(pPlayer);
+
+		RemoveInfraction(pExisting);
+	}
+	else
+	{
+		return;
+	}
+
+	m_infractionJournal.Append(nOp, record);
+
+	if (m_infractionJournal.ShouldCompact())
+		SaveInfractions();
+
+	if (pPlayer)
+		ApplyInfractions(pPlayer);
+}
+
+// Removes every infraction that ran out and updates whoever they were on, returns false if nothing did
+bool CAdminSystem::ExpireInfractions()
+{
+	time_t iNow = std::time(0);
+	bool bExpired = false;
+
+	while (m_vecExpiryHeap.Count() > 0 && m_vecExpiryHeap[0]->GetTimestamp() <= iNow)
+	{
+		CInfractionBase *pInfraction = m_vecExpiryHeap[0];
+		ZEPlayer *pPlayer = g_playerManager->GetPlayerFromUnauthenticatedSteamId(pInfraction->GetSteamId64());
+
+		if (pPlayer)
+			pInfraction->UndoInfraction(pPlayer);
+
+		RemoveInfraction(pInfraction);
+		bExpired = true;
+
+		// Another infraction of the same type could still be running
+		if (pPlayer)
+			ApplyInfractions(pPlayer);
+	}
+
+	return bExpired;
+}
+
+// This function can run at least twice when a player connects: Immediately upon client connection, and also upon getting authenticated by steam.
+// It's also run when an infraction of this player expires, to apply whatever is left.
+// This returns false only when called from ClientConnect and the player is banned in order to reject them.
+bool CAdminSystem::ApplyInfractions(ZEPlayer *player)
+{
+	// Because this can run without the player being authenticated, and the fact that we're applying a ban/mute here,
+	// we can immediately just use the steamid we got from the connecting player.
+	uint64 iSteamID = player->IsAuthenticated() ? player->GetSteamId64() : player->GetUnauthenticatedSteamId64();
+
+	CInfractionBase **ppNewest = m_mapInfractions.Find(iSteamID);
+	time_t iNow = std::time(0);
+
+	// Undo every infraction just briefly while checking if it ran out, all of them first so an expired one can't lift another of the same type
+	for (CInfractionBase *pInfraction = ppNewest ? *ppNewest : nullptr, *pNext; pInfraction; pInfraction = pNext)
+	{
+		pNext = pInfraction->m_pNextForPlayer;
+		pInfraction->UndoInfraction(player);
+
+		time_t timestamp = pInfraction->GetTimestamp();
+		if (timestamp != 0 && timestamp <= iNow)
+			RemoveInfraction(pInfraction);
+	}
+
+	ppNewest = m_mapInfractions.Find(iSteamID);
 
+	for (CInfractionBase *pInfraction = ppNewest ? *ppNewest : nullptr; pInfraction; pInfraction = pInfraction->m_pNextForPlayer)
+	{
 		// We are called from ClientConnect and the player is banned, immediately reject them
-		if (!player->IsConnected() && m_vecInfractions[i]->GetType() == CInfractionBase::EInfractionType::Ban)
+		if (!player->IsConnected() && pInfraction->GetType() == CInfractionBase::EInfractionType::Ban)
 			return false;
-		
-		m_vecInfractions[i]->ApplyInfraction(player);
+
+		pInfraction->ApplyInfraction(player);
 	}
 
 	return true;
@@ -1193,13 +1456,16 @@ bool CAdminSystem::ApplyInfractions(ZEPlayer *player)
 
 bool CAdminSystem::FindAndRemoveInfraction(ZEPlayer *player, CInfractionBase::EInfractionType type)
 {
-	FOR_EACH_VEC_BACK(m_vecInfractions, i)
+	CInfractionBase **ppNewest = m_mapInfractions.Find(player->GetSteamId64());
+
+	for (CInfractionBase *pInfraction = ppNewest ? *ppNewest : nullptr; pInfraction; pInfraction = pInfraction->m_pNextForPlayer)
 	{
-		if (m_vecInfractions[i]->GetSteamId64() == player->GetSteamId64() && m_vecInfractions[i]->GetType() == type)
+		if (pInfraction->GetType() == type)
 		{
-			m_vecInfractions[i]->UndoInfraction(player);
-			m_vecInfractions.Remove(i);
-			
+			pInfraction->UndoInfraction(player);
+			JournalInfraction(EJournalOp::REMOVE, pInfraction);
+			RemoveInfraction(pInfraction);
+
 			return true;
 		}
 	}
@@ -1209,12 +1475,15 @@ bool CAdminSystem::FindAndRemoveInfraction(ZEPlayer *player, CInfractionBase::EI
 
 bool CAdminSystem::FindAndRemoveInfractionSteamId64(uint64 steamid64, CInfractionBase::EInfractionType type)
 {
-	FOR_EACH_VEC_BACK(m_vecInfractions, i)
+	CInfractionBase **ppNewest = m_mapInfractions.Find(steamid64);
+
+	for (CInfractionBase *pInfraction = ppNewest ? *ppNewest : nullptr; pInfraction; pInfraction = pInfraction->m_pNextForPlayer)
 	{
-		if (m_vecInfractions[i]->GetSteamId64() == steamid64 && m_vecInfractions[i]->GetType() == type)
+		if (pInfraction->GetType() == type)
 		{
-			m_vecInfractions.Remove(i);
-			
+			JournalInfraction(EJournalOp::REMOVE, pInfraction);
+			RemoveInfraction(pInfraction);
+
 			return true;
 		}
 	}
@@ -1224,13 +1493,7 @@ bool CAdminSystem::FindAndRemoveInfractionSteamId64(uint64 steamid64, CInfractio
 
 CAdmin *CAdminSystem::FindAdmin(uint64 iSteamID)
 {
-	FOR_EACH_VEC(m_vecAdmins, i)
-	{
-		if (m_vecAdmins[i].GetSteamID() == iSteamID)
-			return &m_vecAdmins[i];
-	}
-
-	return nullptr;
+	return m_pAdmins ? m_pAdmins->Find(iSteamID) : nullptr;
 }
 
 uint64 CAdminSystem::ParseFlags(const char* pszFlags)
@@ -1512,8 +1775,6 @@ void ParseInfraction(const CCommand &args, CCSPlayerController* pAdmin, bool bAd
 		PrintMultiAdminAction(nType, pszCommandPlayerName, GetActionPhrase(infType, GrammarTense::Past, bAdding),
 							  bAdding ? (" for " + FormatTime(iDuration, false)).c_str() : "");
 	}
-
-	g_pAdminSystem->SaveInfractions();
 }
 
 // Returns a string matching the type of punishment and grammar tense specified
@@ -21,6 +21,9 @@
 #include "platform.h"
 #include "utlvector.h"
 #include "playermanager.h"
+#include "steamidmap.h"
+#include "infractionjournal.h"
+#include "admintable.h"
 #include <ctime>
 
 #define ADMFLAG_NONE		(0)
@@ -91,6 +94,12 @@ public:
 private:
 	time_t m_iTimestamp;
 	uint64 m_iSteamID;
+
+	// Where CAdminSystem keeps track of this infraction
+	friend class CAdminSystem;
+	int m_iIndex = -1;								// In m_vecInfractions
+	int m_iHeapIndex = -1;							// In m_vecExpiryHeap, permanent infractions aren't in it
+	CInfractionBase *m_pNextForPlayer = nullptr;	// The next older infraction with the same SteamID
 };
 
 class CBanInfraction : public CInfractionBase
@@ -125,44 +134,48 @@ public:
 	void UndoInfraction(ZEPlayer *) override;
 };
 
-class CAdmin
-{
-public:
-	CAdmin(const char* pszName, uint64 iSteamID, uint64 iFlags, int iAdminImmunity) : 
-		m_pszName(pszName), m_iSteamID(iSteamID), m_iFlags(iFlags), m_iAdminImmunity(iAdminImmunity)
-	{}
-
-	const char* GetName() { return m_pszName; }
-	uint64 GetSteamID() { return m_iSteamID; }
-	uint64 GetFlags() { return m_iFlags; }
-	int GetImmunity() { return m_iAdminImmunity; }
-
-private:
-	const char* m_pszName;
-	uint64 m_iSteamID;
-	uint64 m_iFlags;
-	int m_iAdminImmunity;
-};
-
 class CAdminSystem
 {
 public:
 	CAdminSystem();
+	~CAdminSystem();
 	bool LoadAdmins();
+	void SetAdmins(CAdminTable *pAdmins);
+	CAdminTable *GetAdmins() { return m_pAdmins; }
+	void ReapplyAdmins();
+	void RunFrame();
 	bool LoadInfractions();
 	void AddInfraction(CInfractionBase*);
 	void SaveInfractions();
+	void GetInfractionRecords(std::vector<InfractionRecord_t> &vecInfractions);
 	bool ApplyInfractions(ZEPlayer *player);
 	bool FindAndRemoveInfraction(ZEPlayer *player, CInfractionBase::EInfractionType type);
 	bool FindAndRemoveInfractionSteamId64(uint64 steamid64, CInfractionBase::EInfractionType type);
+	bool ExpireInfractions();
+	void ApplySharedInfraction(EJournalOp nOp, const InfractionRecord_t &record);
 	CAdmin *FindAdmin(uint64 iSteamID);
-	uint64 ParseFlags(const char* pszFlags);
+	static uint64 ParseFlags(const char* pszFlags);
 	void AddDisconnectedPlayer(const char* pszName, uint64 xuid, const char* pszIP);
 	void ShowDisconnectedPlayers(CCSPlayerController* const pAdmin);
 
 private:
-	CUtlVector<CAdmin> m_vecAdmins;
-	CUtlVector<CInfractionBase*> m_vecInfractions;
+	CAdminTable *m_pAdmins = nullptr; // Only ever swapped on the main thread, between frames
+	CAdminWatcher m_adminWatcher;
+	static CInfractionBase *CreateInfraction(int iType, time_t iEndTime, uint64 iSteamID);
+	CInfractionBase *FindInfraction(uint64 iSteamID, int iType, time_t iEndTime);
+	void IndexInfraction(CInfractionBase *pInfraction);
+	void JournalInfraction(EJournalOp nOp, CInfractionBase *pInfraction);
+	void RemoveInfraction(CInfractionBase *pInfraction);
+	void ClearInfractions();
+	void SwapExpiryHeap(int i, int j);
+	void SiftExpiryHeapUp(int i);
+	void SiftExpiryHeapDown(int i);
+
+	CUtlVector<CInfractionBase*> m_vecInfractions; // Unordered, removal swaps the last one in
+	CSteamIDMap<CInfractionBase*> m_mapInfractions; // SteamID64 to the newest infraction, the rest follow through m_pNextForPlayer
+	CUtlVector<CInfractionBase*> m_vecExpiryHeap; // Min-heap on the end time of everything that isn't permanent
+	CInfractionJournal m_infractionJournal;
+	bool m_bInfractionsComplete = false; // Whether all of infractions.txt was read, compacting otherwise would lose what wasn't
 	
 	// Implemented as a circular buffer.
 	std::tuple<std::string, uint64, std::string> m_rgDCPly[20];
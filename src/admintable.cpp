@@ -0,0 +1,440 @@
+/**
+ * =============================================================================
+ * CS2Fixes
+ * Copyright (C) 2023-2024 Source2ZE
+ * =============================================================================
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License, version 3.0, as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "admintable.h"
+#include "adminsystem.h"
+#include "common.h"
+#include "icvar.h"
+#include "tier0/platform.h"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "tier0/memdbgon.h"
+
+// Just enough of the KeyValues text format for admins.cfg: quoted or bare tokens, braces and // comments
+// KeyValues itself isn't safe to use away from the main thread
+static bool NextAdminToken(const std::string &strFile, size_t &i, std::string &strToken)
+{
+	while (i < strFile.size())
+	{
+		char c = strFile[i];
+
+		if (c == '/' && i + 1 < strFile.size() && strFile[i + 1] == '/')
+		{
+			while (i < strFile.size() && strFile[i] != '\n')
+				i++;
+		}
+		else if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+			i++;
+		else
+			break;
+	}
+
+	if (i >= strFile.size())
+		return false;
+
+	if (strFile[i] == '{' || strFile[i] == '}')
+	{
+		strToken.assign(1, strFile[i++]);
+		return true;
+	}
+
+	if (strFile[i] == '"')
+	{
+		size_t iEnd = strFile.find('"', i + 1);
+
+		if (iEnd == std::string::npos)
+			iEnd = strFile.size();
+
+		strToken = strFile.substr(i + 1, iEnd - i - 1);
+		i = iEnd + 1;
+		return true;
+	}
+
+	size_t iStart = i;
+
+	while (i < strFile.size() && !strchr(" \t\r\n{}\"", strFile[i]))
+		i++;
+
+	strToken = strFile.substr(iStart, i - iStart);
+	return true;
+}
+
+CAdminTable *CAdminTable::Parse(const char *pszPath, bool bVerbose)
+{
+	FILE *pFile = fopen(pszPath, "rb");
+
+	if (!pFile)
+	{
+		Warning("Failed to load %s\n", pszPath);
+		return nullptr;
+	}
+
+	std::string strFile;
+	char szBuffer[16384];
+	size_t nRead;
+
+	while ((nRead = fread(szBuffer, 1, sizeof(szBuffer), pFile)) > 0)
+		strFile.append(szBuffer, nRead);
+
+	fclose(pFile);
+
+	CAdminTable *pAdmins = new CAdminTable();
+	std::string strToken, strName, strKey, strSteamID, strFlags, strImmunity;
+	bool bHasSteamID = false, bHasFlags = false, bHasImmunity = false, bHasKey = false;
+	int iDepth = 0;
+	size_t i = 0;
+
+	while (NextAdminToken(strFile, i, strToken))
+	{
+		if (strToken == "{")
+		{
+			if (++iDepth == 2)
+				bHasSteamID = bHasFlags = bHasImmunity = bHasKey = false;
+
+			continue;
+		}
+
+		if (strToken == "}")
+		{
+			if (iDepth-- != 2)
+			{
+				bHasKey = false;
+				continue;
+			}
+
+			if (!bHasSteamID)
+			{
+				Warning("Admin entry %s is missing 'steam' key\n", strName.c_str());
+				delete pAdmins;
+				return nullptr;
+			}
+
+			if (!bHasFlags)
+			{
+				Warning("Admin entry %s is missing 'flags' key\n", strName.c_str());
+				delete pAdmins;
+				return nullptr;
+			}
+
+			int iImmunityLevel = bHasImmunity ? atoi(strImmunity.c_str()) : -1;
+
+			if (iImmunityLevel < 0)
+			{
+				Warning("Admin entry %s is missing 'immunity' key\n", strName.c_str());
+				iImmunityLevel = 0; // Zero is default immunity, so set that if not given
+			}
+
+			if (bVerbose)
+			{
+				ConMsg("Loaded admin %s\n", strName.c_str());
+				ConMsg(" - Steam ID: %5s\n", strSteamID.c_str());
+				ConMsg(" - Flags: %5s\n", strFlags.c_str());
+				ConMsg(" - Immunity: %i\n", iImmunityLevel);
+			}
+
+			uint64 iFlags = CAdminSystem::ParseFlags(strFlags.c_str());
+
+			// Let's just use steamID64 for now
+			pAdmins->AddAdmin(strName.c_str(), atoll(strSteamID.c_str()), iFlags, iImmunityLevel);
+			continue;
+		}
+
+		// The admin's name, which opens their block
+		if (iDepth == 1)
+			strName = strToken;
+
+		if (iDepth != 2)
+			continue;
+
+		if (!bHasKey)
+		{
+			strKey = strToken;
+			bHasKey = true;
+			continue;
+		}
+
+		if (!V_stricmp(strKey.c_str(), "steamid"))
+		{
+			strSteamID = strToken;
+			bHasSteamID = true;
+		}
+		else if (!V_stricmp(strKey.c_str(), "flags"))
+		{
+			strFlags = strToken;
+			bHasFlags = true;
+		}
+		else if (!V_stricmp(strKey.c_str(), "immunity"))
+		{
+			strImmunity = strToken;
+			bHasImmunity = true;
+		}
+
+		bHasKey = false;
+	}
+
+	return pAdmins;
+}
+
+void CAdminTable::AddAdmin(const char *pszName, uint64 iSteamID, uint64 iFlags, int iImmunity)
+{
+	int iAdmin = (int)m_vecAdmins.size();
+	m_vecAdmins.emplace_back(pszName, iSteamID, iFlags, iImmunity);
+
+	// Duplicate entries keep resolving to the first one
+	m_mapAdmins.Insert(iSteamID, iAdmin);
+}
+
+CAdmin *CAdminTable::Find(uint64 iSteamID)
+{
+	int *pAdmin = m_mapAdmins.Find(iSteamID);
+
+	return pAdmin ? &m_vecAdmins[*pAdmin] : nullptr;
+}
+
+void CAdminWatcher::Start(const char *pszPath)
+{
+	if (m_thread.joinable())
+		return;
+
+	m_strPath = pszPath;
+	m_bStopping = false;
+	m_thread = std::thread(&CAdminWatcher::WatcherMain, this);
+}
+
+void CAdminWatcher::Stop()
+{
+	if (m_thread.joinable())
+	{
+		m_bStopping = true;
+		m_thread.join();
+	}
+
+	delete m_pReloaded.exchange(nullptr);
+}
+
+void CAdminWatcher::WatcherMain()
+{
+	std::filesystem::path path(m_strPath);
+	std::error_code error;
+	auto lastWriteTime = std::filesystem::last_write_time(path, error);
+
+#ifdef __linux__
+	// The directory is watched rather than the file, editors tend to save by writing a new file and renaming it over the old one
+	int iNotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+	if (iNotify >= 0 && inotify_add_watch(iNotify, path.parent_path().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+	{
+		close(iNotify);
+		iNotify = -1;
+	}
+#endif
+
+	bool bChanged = false;
+	auto reloadAt = std::chrono::steady_clock::now();
+
+	while (!m_bStopping)
+	{
+#ifdef __linux__
+		if (iNotify >= 0)
+		{
+			pollfd pollFile = {iNotify, POLLIN, 0};
+
+			// Wakes up now and then to see if it's time to stop
+			if (poll(&pollFile, 1, 250) > 0)
+			{
+				alignas(inotify_event) char buffer[4096];
+				ssize_t nLength;
+
+				while ((nLength = read(iNotify, buffer, sizeof(buffer))) > 0)
+				{
+					for (char *pEvent = buffer; pEvent < buffer + nLength; pEvent += sizeof(inotify_event) + ((inotify_event *)pEvent)->len)
+					{
+						inotify_event *pNotify = (inotify_event *)pEvent;
+
+						if (pNotify->len && path.filename() == pNotify->name)
+						{
+							bChanged = true;
+							reloadAt = std::chrono::steady_clock::now() + std::chrono::milliseconds(250);
+						}
+					}
+				}
+			}
+		}
+		else
+#endif
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+
+			auto writeTime = std::filesystem::last_write_time(path, error);
+
+			if (!error && writeTime != lastWriteTime)
+			{
+				lastWriteTime = writeTime;
+				bChanged = true;
+				reloadAt = std::chrono::steady_clock::now();
+			}
+		}
+
+		// A save often shows up as a few events in a row, so wait for them to settle
+		if (!bChanged || std::chrono::steady_clock::now() < reloadAt)
+			continue;
+
+		bChanged = false;
+
+		// A broken file keeps the current admins
+		if (CAdminTable *pAdmins = CAdminTable::Parse(m_strPath.c_str(), false))
+			Publish(pAdmins);
+	}
+
+#ifdef __linux__
+	if (iNotify >= 0)
+		close(iNotify);
+#endif
+}
+
+// The game thread does the lookups the whole time the reloads run, which holds the server up for a few seconds
+CON_COMMAND_F(cs2f_admins_reload_test, "Reload a 10k admin file from a temp directory over and over on another thread while looking admins up, and check every lookup, stalls the server so only run it offline", FCVAR_SPONLY | FCVAR_LINKED_CONCOMMAND)
+{
+	const int nAdmins = 10000;
+	const int nReloads = 50;
+	const uint64 iFirstSteamID = 76561197960265728ull;
+	std::string strPaths[2];
+
+	std::error_code error;
+	std::filesystem::path testPath = std::filesystem::temp_directory_path(error) / "cs2fixes_admins_test";
+
+	if (!error)
+		std::filesystem::create_directories(testPath, error);
+
+	if (error)
+	{
+		Message("Failed to create a temp directory for the test\n");
+		return;
+	}
+
+	// Two versions of the same admins that only differ in flags and immunity, any mix of them in one table is a torn list
+	for (int iVersion = 0; iVersion < 2; iVersion++)
+	{
+		strPaths[iVersion] = (testPath / ("admins_test_" + std::to_string(iVersion) + ".cfg")).string();
+		FILE *pFile = fopen(strPaths[iVersion].c_str(), "wb");
+
+		if (!pFile)
+		{
+			Message("Failed to open %s for writing\n", strPaths[iVersion].c_str());
+			std::filesystem::remove_all(testPath, error);
+			return;
+		}
+
+		fprintf(pFile, "Admins\n{\n");
+
+		for (int i = 0; i < nAdmins; i++)
+			fprintf(pFile, "\t\"admin%i\"\n\t{\n\t\t\"steamid\" \"%llu\"\n\t\t\"flags\" \"%s\"\n\t\t\"immunity\" \"%i\"\n\t}\n", i, iFirstSteamID + i * 3, iVersion ? "bcd" : "b", iVersion + 1);
+
+		fprintf(pFile, "}\n");
+		fclose(pFile);
+	}
+
+	CAdminWatcher watcher;
+	CAdminTable *pAdmins = CAdminTable::Parse(strPaths[0].c_str(), false);
+	std::atomic<bool> bDone{false};
+	double flParseTime = 0;
+
+	std::thread reloader([&]() {
+		for (int i = 0; i < nReloads; i++)
+		{
+			double flStart = Plat_FloatTime();
+			CAdminTable *pReloaded = CAdminTable::Parse(strPaths[(i + 1) % 2].c_str(), false);
+			flParseTime += Plat_FloatTime() - flStart;
+
+			watcher.Publish(pReloaded);
+		}
+
+		bDone = true;
+	});
+
+	uint64 nLookups = 0, nWrong = 0, iRandom = 1;
+	int nSwaps = 0;
+	double flLookupTime = 0;
+
+	while (true)
+	{
+		// Read before taking, so the last table is always swapped in before stopping
+		bool bFinished = bDone;
+
+		if (CAdminTable *pReloaded = watcher.TakeReloaded())
+		{
+			delete pAdmins;
+			pAdmins = pReloaded;
+			nSwaps++;
+		}
+
+		if (!pAdmins || pAdmins->Count() != nAdmins)
+		{
+			nWrong++;
+			break;
+		}
+
+		// What a frame's worth of lookups might look like, with some misses mixed in
+		uint64 iExpectedFlags = pAdmins->Find(iFirstSteamID)->GetFlags();
+		double flStart = Plat_FloatTime();
+
+		for (int i = 0; i < 1000; i++)
+		{
+			iRandom = iRandom * 6364136223846793005ull + 1442695040888963407ull;
+			uint64 iAccount = (iRandom >> 33) % (nAdmins * 3);
+			CAdmin *pAdmin = pAdmins->Find(iFirstSteamID + iAccount);
+
+			if (iAccount % 3 ? pAdmin != nullptr : !pAdmin || pAdmin->GetFlags() != iExpectedFlags)
+			{
+				nWrong++;
+				continue;
+			}
+
+			// Names are the one part of an admin that lives on the heap, so a table that moved them badly shows up here
+			char szName[32];
+			V_snprintf(szName, sizeof(szName), "admin%llu", iAccount / 3);
+
+			if (pAdmin && V_strcmp(pAdmin->GetName(), szName))
+				nWrong++;
+		}
+
+		flLookupTime += Plat_FloatTime() - flStart;
+		nLookups += 1000;
+
+		if (bFinished)
+			break;
+	}
+
+	reloader.join();
+
+	Message("%i reloads, %i swapped in, %llu lookups, %llu wrong\n", nReloads, nSwaps, nLookups, nWrong);
+	Message("Parse: %.1f ms per %i admins, lookup: %.1f ns\n", flParseTime * 1000 / nReloads, nAdmins, flLookupTime * 1e9 / nLookups);
+
+	delete pAdmins;
+	std::filesystem::remove_all(testPath, error);
+}
@@ -0,0 +1,91 @@
+/**
+ * =============================================================================
+ * CS2Fixes
+ * Copyright (C) 2023-2024 Source2ZE
+ * =============================================================================
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License, version 3.0, as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "platform.h"
+#include "steamidmap.h"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+class CAdmin
+{
+public:
+	CAdmin(const char* pszName, uint64 iSteamID, uint64 iFlags, int iAdminImmunity) : 
+		m_strName(pszName), m_iSteamID(iSteamID), m_iFlags(iFlags), m_iAdminImmunity(iAdminImmunity)
+	{}
+
+	const char* GetName() { return m_strName.c_str(); }
+	uint64 GetSteamID() { return m_iSteamID; }
+	uint64 GetFlags() { return m_iFlags; }
+	int GetImmunity() { return m_iAdminImmunity; }
+
+private:
+	std::string m_strName;
+	uint64 m_iSteamID;
+	uint64 m_iFlags;
+	int m_iAdminImmunity;
+};
+
+// Everything from one read of admins.cfg, it's never changed once built
+// so a new one can be put together on another thread while the game keeps reading the current one
+class CAdminTable
+{
+public:
+	// Safe to call from any thread, returns nullptr if the file can't be used
+	static CAdminTable *Parse(const char *pszPath, bool bVerbose);
+
+	// Only while the table is being built, before anyone else can see it
+	void AddAdmin(const char *pszName, uint64 iSteamID, uint64 iFlags, int iImmunity);
+
+	CAdmin *Find(uint64 iSteamID);
+	CAdmin *Get(int i) { return &m_vecAdmins[i]; }
+	int Count() { return (int)m_vecAdmins.size(); }
+
+private:
+	// Not a CUtlVector, growing one moves the names' std::strings without constructing them
+	std::vector<CAdmin> m_vecAdmins;
+	CSteamIDMap<int> m_mapAdmins; // SteamID64 to index in m_vecAdmins
+};
+
+// Reparses admins.cfg on a thread of its own whenever it changes on disk,
+// with inotify on Linux and by checking the modification time every second elsewhere
+class CAdminWatcher
+{
+public:
+	~CAdminWatcher() { Stop(); }
+
+	void Start(const char *pszPath);
+	void Stop();
+
+	// Hands over a table, replacing one nobody took yet
+	void Publish(CAdminTable *pAdmins) { delete m_pReloaded.exchange(pAdmins); }
+
+	// The newest table since the last call or nullptr, the caller owns it
+	CAdminTable *TakeReloaded() { return m_pReloaded.exchange(nullptr); }
+
+private:
+	void WatcherMain();
+
+	std::string m_strPath;
+	std::thread m_thread;
+	std::atomic<bool> m_bStopping{false};
+	std::atomic<CAdminTable*> m_pReloaded{nullptr};
+};
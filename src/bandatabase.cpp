@@ -0,0 +1,814 @@
+/**
+ * =============================================================================
+ * CS2Fixes
+ * Copyright (C) 2023-2024 Source2ZE
+ * =============================================================================
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License, version 3.0, as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bandatabase.h"
+#include "common.h"
+#include "icvar.h"
+#include "infractionjournal.h"
+#include "tier0/platform.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "tier0/memdbgon.h"
+
+CBanDatabase g_banDatabase;
+
+#define BAN_DATABASE_BLOOM_HASHES 7
+
+static std::string GetDataPath(const char *pszFile)
+{
+	return std::string(Plat_GetGameDirectory()) + "/csgo/addons/cs2fixes/data/" + pszFile;
+}
+
+// splitmix64's finalizer, SteamIDs and addresses are far too regular to index the filter directly
+static inline uint64 MixBloomKey(uint64 iKey)
+{
+	iKey = (iKey ^ (iKey >> 30)) * 0xBF58476D1CE4E5B9ull;
+	iKey = (iKey ^ (iKey >> 27)) * 0x94D049BB133111EBull;
+	return iKey ^ (iKey >> 31);
+}
+
+bool CBanDatabase::Load()
+{
+	std::string strPath = GetDataPath("bans.db");
+
+	Unmap();
+
+	if (!std::filesystem::exists(strPath))
+		return false;
+
+	if (!Map(strPath.c_str()))
+		return false;
+
+	Message("Loaded %llu banned SteamIDs and %llu banned addresses from %s\n", m_pHeader->nSteamIDs, m_pHeader->nAddresses, strPath.c_str());
+
+	return true;
+}
+
+void CBanDatabase::Unload()
+{
+	if (m_buildThread.joinable())
+		m_buildThread.join();
+
+	m_bBuildDone = false;
+	Unmap();
+}
+
+bool CBanDatabase::Map(const char *pszPath)
+{
+	Unmap();
+
+#ifdef _WIN32
+	HANDLE hFile = CreateFileA(pszPath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (hFile == INVALID_HANDLE_VALUE)
+	{
+		Warning("Failed to open %s\n", pszPath);
+		return false;
+	}
+
+	LARGE_INTEGER nSize;
+	HANDLE hMapping = nullptr;
+	void *pMapping = nullptr;
+
+	if (GetFileSizeEx(hFile, &nSize) && nSize.QuadPart > 0)
+		hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if (hMapping)
+		pMapping = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+
+	if (!pMapping)
+	{
+		if (hMapping)
+			CloseHandle(hMapping);
+
+		CloseHandle(hFile);
+		Warning("Failed to map %s\n", pszPath);
+		return false;
+	}
+
+	m_hFile = hFile;
+	m_hMapping = hMapping;
+	m_pMapping = pMapping;
+	m_nMappedSize = (size_t)nSize.QuadPart;
+#else
+	int iFile = open(pszPath, O_RDONLY);
+
+	if (iFile < 0)
+	{
+		Warning("Failed to open %s\n", pszPath);
+		return false;
+	}
+
+	struct stat fileStat;
+	void *pMapping = MAP_FAILED;
+
+	if (fstat(iFile, &fileStat) == 0 && fileStat.st_size > 0)
+		pMapping = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_SHARED, iFile, 0);
+
+	// The mapping keeps the file alive on its own
+	close(iFile);
+
+	if (pMapping == MAP_FAILED)
+	{
+		Warning("Failed to map %s\n", pszPath);
+		return false;
+	}
+
+	// Lookups land on random pages, reading ahead would only waste memory
+	madvise(pMapping, fileStat.st_size, MADV_RANDOM);
+
+	m_pMapping = pMapping;
+	m_nMappedSize = fileStat.st_size;
+#endif
+
+	const BanDatabaseHeader_t *pHeader = (const BanDatabaseHeader_t *)m_pMapping;
+	bool bValid = m_nMappedSize >= sizeof(BanDatabaseHeader_t) && pHeader->iMagic == BAN_DATABASE_MAGIC && pHeader->iVersion == BAN_DATABASE_VERSION;
+
+	if (bValid)
+	{
+		// Compare counts against what fits first so a corrupt header can't overflow the size check
+		uint64 nEntrySpace = (m_nMappedSize - sizeof(BanDatabaseHeader_t)) / sizeof(uint64);
+
+		bValid = pHeader->nBloomWords != 0 && (pHeader->nBloomWords & (pHeader->nBloomWords - 1)) == 0 && pHeader->nBloomWords <= nEntrySpace
+			&& pHeader->nBloomHashes != 0 && pHeader->nBloomHashes <= 32
+			&& pHeader->nSteamIDs <= nEntrySpace / 2 && pHeader->nAddresses <= nEntrySpace / 2
+			&& sizeof(BanDatabaseHeader_t) + pHeader->nBloomWords * sizeof(uint64) + pHeader->nSteamIDs * sizeof(BanDatabaseSteamID_t)
+				+ pHeader->nAddresses * sizeof(BanDatabaseAddress_t) == m_nMappedSize;
+	}
+
+	if (!bValid)
+	{
+		Warning("%s is not a valid ban database\n", pszPath);
+		Unmap();
+		return false;
+	}
+
+	m_pHeader = pHeader;
+	m_pBloom = (const uint64 *)(pHeader + 1);
+	m_pSteamIDs = (const BanDatabaseSteamID_t *)(m_pBloom + pHeader->nBloomWords);
+	m_pAddresses = (const BanDatabaseAddress_t *)(m_pSteamIDs + pHeader->nSteamIDs);
+
+	return true;
+}
+
+void CBanDatabase::Unmap()
+{
+	if (m_pMapping)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(m_pMapping);
+		CloseHandle(m_hMapping);
+		CloseHandle(m_hFile);
+		m_hMapping = nullptr;
+		m_hFile = nullptr;
+#else
+		munmap(m_pMapping, m_nMappedSize);
+#endif
+	}
+
+	m_pMapping = nullptr;
+	m_nMappedSize = 0;
+	m_pHeader = nullptr;
+	m_pBloom = nullptr;
+	m_pSteamIDs = nullptr;
+	m_pAddresses = nullptr;
+}
+
+bool CBanDatabase::TestBloom(uint64 iKey)
+{
+	uint64 iHash = MixBloomKey(iKey);
+	uint64 iStep = (iHash >> 32) | 1;
+	uint64 iBitMask = m_pHeader->nBloomWords * 64 - 1;
+
+	for (uint32 i = 0; i < m_pHeader->nBloomHashes; i++, iHash += iStep)
+	{
+		uint64 iBit = iHash & iBitMask;
+
+		if (!(m_pBloom[iBit >> 6] & (1ull << (iBit & 63))))
+			return false;
+	}
+
+	return true;
+}
+
+// Anything that ran out counts as not banned, the list is only pruned when it's rebuilt
+static inline bool IsBanActive(int64 iEndTime)
+{
+	return iEndTime == 0 || iEndTime > (int64)std::time(0);
+}
+
+bool CBanDatabase::IsSteamIDBanned(uint64 iSteamID)
+{
+	if (!m_pHeader || !TestBloom(iSteamID))
+		return false;
+
+	const BanDatabaseSteamID_t *pEnd = m_pSteamIDs + m_pHeader->nSteamIDs;
+	const BanDatabaseSteamID_t *pEntry = std::lower_bound(m_pSteamIDs, pEnd, iSteamID,
+		[](const BanDatabaseSteamID_t &entry, uint64 iSteamID) { return entry.iSteamID < iSteamID; });
+
+	return pEntry != pEnd && pEntry->iSteamID == iSteamID && IsBanActive(pEntry->iEndTime);
+}
+
+bool CBanDatabase::IsAddressBanned(uint32 iAddress)
+{
+	if (!m_pHeader || !TestBloom(BAN_DATABASE_ADDRESS_KEY | iAddress))
+		return false;
+
+	const BanDatabaseAddress_t *pEnd = m_pAddresses + m_pHeader->nAddresses;
+	const BanDatabaseAddress_t *pEntry = std::lower_bound(m_pAddresses, pEnd, iAddress,
+		[](const BanDatabaseAddress_t &entry, uint32 iAddress) { return entry.iAddress < iAddress; });
+
+	return pEntry != pEnd && pEntry->iAddress == iAddress && IsBanActive(pEntry->iEndTime);
+}
+
+bool CBanDatabase::IsBanned(uint64 iSteamID, const char *pszAddress)
+{
+	if (!m_pHeader)
+		return false;
+
+	if (iSteamID != 0 && IsSteamIDBanned(iSteamID))
+		return true;
+
+	uint32 iAddress;
+	return pszAddress && ParseAddress(pszAddress, iAddress) && IsAddressBanned(iAddress);
+}
+
+// Dotted IPv4 only, anything after the last octet such as a port is ignored
+bool CBanDatabase::ParseAddress(const char *pszAddress, uint32 &iAddress)
+{
+	iAddress = 0;
+
+	for (int i = 0; i < 4; i++)
+	{
+		if (i > 0 && *pszAddress++ != '.')
+			return false;
+
+		if (*pszAddress < '0' || *pszAddress > '9')
+			return false;
+
+		uint32 iOctet = 0;
+
+		for (int nDigits = 0; *pszAddress >= '0' && *pszAddress <= '9'; pszAddress++)
+		{
+			iOctet = iOctet * 10 + (*pszAddress - '0');
+
+			if (++nDigits > 3 || iOctet > 255)
+				return false;
+		}
+
+		iAddress = (iAddress << 8) | iOctet;
+	}
+
+	return *pszAddress == '\0' || *pszAddress == ':';
+}
+
+// A later end time wins, and a permanent ban beats them all
+static inline int64 MergeBanEndTime(int64 iEndTime, int64 iOtherEndTime)
+{
+	if (iEndTime == 0 || iOtherEndTime == 0)
+		return 0;
+
+	return iEndTime > iOtherEndTime ? iEndTime : iOtherEndTime;
+}
+
+static void ParseBanCSV(const std::string &strFile, std::vector<BanDatabaseSteamID_t> &vecSteamIDs, std::vector<BanDatabaseAddress_t> &vecAddresses)
+{
+	size_t iLine = 0;
+
+	while (iLine < strFile.size())
+	{
+		size_t iLineEnd = strFile.find('\n', iLine);
+
+		if (iLineEnd == std::string::npos)
+			iLineEnd = strFile.size();
+
+		std::string strLine = strFile.substr(iLine, iLineEnd - iLine);
+		iLine = iLineEnd + 1;
+
+		if (!strLine.empty() && strLine.back() == '\r')
+			strLine.pop_back();
+
+		if (strLine.empty() || strLine[0] == '#')
+			continue;
+
+		char szFields[3][64] = {};
+		size_t iStart = 0;
+
+		for (int i = 0; i < 3 && iStart <= strLine.size(); i++)
+		{
+			size_t iComma = strLine.find(',', iStart);
+			size_t iEnd = iComma == std::string::npos ? strLine.size() : iComma;
+
+			size_t nLength = iEnd - iStart + 1;
+
+			V_strncpy(szFields[i], strLine.c_str() + iStart, nLength < sizeof(szFields[i]) ? nLength : sizeof(szFields[i]));
+			iStart = iEnd + 1;
+		}
+
+		char *pszEnd;
+		uint64 iSteamID = strtoull(szFields[0], &pszEnd, 10);
+
+		// Also skips a header line
+		if (*pszEnd != '\0')
+			continue;
+
+		int64 iEndTime = strtoll(szFields[2], nullptr, 10);
+		uint32 iAddress;
+
+		if (iSteamID != 0)
+			vecSteamIDs.push_back({iSteamID, iEndTime});
+
+		if (szFields[1][0] && CBanDatabase::ParseAddress(szFields[1], iAddress))
+			vecAddresses.push_back({iAddress, 0, iEndTime});
+	}
+}
+
+// Picks the bans out of infractions.txt without KeyValues, which isn't safe to use away from the main thread
+static void ParseBanInfractions(const std::string &strFile, std::vector<BanDatabaseSteamID_t> &vecSteamIDs)
+{
+	int iDepth = 0;
+	std::string strKey;
+	bool bHasKey = false;
+	uint64 iSteamID = 0;
+	int64 iEndTime = -1;
+	int iType = -1;
+
+	for (size_t i = 0; i < strFile.size(); i++)
+	{
+		char c = strFile[i];
+
+		if (c == '/' && i + 1 < strFile.size() && strFile[i + 1] == '/')
+		{
+			while (i < strFile.size() && strFile[i] != '\n')
+				i++;
+		}
+		else if (c == '{')
+		{
+			if (++iDepth == 2)
+			{
+				iSteamID = 0;
+				iEndTime = -1;
+				iType = -1;
+			}
+
+			bHasKey = false;
+		}
+		else if (c == '}')
+		{
+			if (iDepth == 2 && iType == 0 && iSteamID != 0 && iEndTime != -1)
+				vecSteamIDs.push_back({iSteamID, iEndTime});
+
+			iDepth--;
+			bHasKey = false;
+		}
+		else if (c == '"')
+		{
+			size_t iEnd = strFile.find('"', i + 1);
+
+			if (iEnd == std::string::npos)
+				break;
+
+			std::string strToken = strFile.substr(i + 1, iEnd - i - 1);
+			i = iEnd;
+
+			if (iDepth != 2)
+				continue;
+
+			if (!bHasKey)
+			{
+				strKey = strToken;
+				bHasKey = true;
+				continue;
+			}
+
+			if (strKey == "steamid")
+				iSteamID = strtoull(strToken.c_str(), nullptr, 10);
+			else if (strKey == "endtime")
+				iEndTime = strtoll(strToken.c_str(), nullptr, 10);
+			else if (strKey == "type")
+				iType = atoi(strToken.c_str());
+
+			bHasKey = false;
+		}
+	}
+}
+
+// Since compaction only happens now and then, infractions.txt is missing whatever went into the journal after it
+// Replaying a record either makes its ban present or absent whatever came before, so only the last one of each ban matters
+static void ReplayBanJournal(const char *pszPath, std::vector<BanDatabaseSteamID_t> &vecSteamIDs)
+{
+	std::vector<JournalEntry_t> vecEntries;
+	CInfractionJournal::ReadFile(pszPath, vecEntries);
+
+	vecEntries.erase(std::remove_if(vecEntries.begin(), vecEntries.end(), [](const JournalEntry_t &entry) { return entry.record.iType != 0; }), vecEntries.end());
+
+	if (vecEntries.empty())
+		return;
+
+	auto BanLess = [](const BanDatabaseSteamID_t &a, const BanDatabaseSteamID_t &b) {
+		return a.iSteamID != b.iSteamID ? a.iSteamID < b.iSteamID : a.iEndTime < b.iEndTime;
+	};
+
+	// Stable keeps each ban's records in journal order
+	std::stable_sort(vecEntries.begin(), vecEntries.end(), [&](const JournalEntry_t &a, const JournalEntry_t &b) {
+		return BanLess({a.record.iSteamID, (int64)a.record.iEndTime}, {b.record.iSteamID, (int64)b.record.iEndTime});
+	});
+
+	std::sort(vecSteamIDs.begin(), vecSteamIDs.end(), BanLess);
+
+	size_t nSnapshot = vecSteamIDs.size();
+
+	for (size_t i = 0; i < vecEntries.size(); i++)
+	{
+		const InfractionRecord_t &record = vecEntries[i].record;
+
+		if (i + 1 < vecEntries.size() && vecEntries[i + 1].record.iSteamID == record.iSteamID && vecEntries[i + 1].record.iEndTime == record.iEndTime)
+			continue;
+
+		BanDatabaseSteamID_t ban = {record.iSteamID, (int64)record.iEndTime};
+		auto range = std::equal_range(vecSteamIDs.begin(), vecSteamIDs.begin() + nSnapshot, ban, BanLess);
+
+		// Removed ones are zeroed and dropped all at once after
+		if (vecEntries[i].nOp == EJournalOp::REMOVE)
+		{
+			for (auto it = range.first; it != range.second; ++it)
+				it->iSteamID = 0;
+		}
+		else if (range.first == range.second)
+		{
+			vecSteamIDs.push_back(ban);
+		}
+	}
+
+	vecSteamIDs.erase(std::remove_if(vecSteamIDs.begin(), vecSteamIDs.end(), [](const BanDatabaseSteamID_t &ban) { return ban.iSteamID == 0; }), vecSteamIDs.end());
+}
+
+template <typename T, typename K>
+static void SortAndMergeBans(std::vector<T> &vecBans, K T::*pKey)
+{
+	int64 iNow = std::time(0);
+
+	vecBans.erase(std::remove_if(vecBans.begin(), vecBans.end(), [&](const T &ban) { return ban.iEndTime != 0 && ban.iEndTime <= iNow; }), vecBans.end());
+	std::sort(vecBans.begin(), vecBans.end(), [&](const T &a, const T &b) { return a.*pKey < b.*pKey; });
+
+	size_t nMerged = 0;
+
+	for (size_t i = 0; i < vecBans.size(); i++)
+	{
+		if (nMerged > 0 && vecBans[nMerged - 1].*pKey == vecBans[i].*pKey)
+			vecBans[nMerged - 1].iEndTime = MergeBanEndTime(vecBans[nMerged - 1].iEndTime, vecBans[i].iEndTime);
+		else
+			vecBans[nMerged++] = vecBans[i];
+	}
+
+	vecBans.resize(nMerged);
+}
+
+static void AddBloomKey(std::vector<uint64> &vecBloom, uint64 iKey)
+{
+	uint64 iHash = MixBloomKey(iKey);
+	uint64 iStep = (iHash >> 32) | 1;
+	uint64 iBitMask = vecBloom.size() * 64 - 1;
+
+	for (uint32 i = 0; i < BAN_DATABASE_BLOOM_HASHES; i++, iHash += iStep)
+	{
+		uint64 iBit = iHash & iBitMask;
+		vecBloom[iBit >> 6] |= 1ull << (iBit & 63);
+	}
+}
+
+bool CBanDatabase::Build(const char *pszSource, const char *pszOutput, std::string &strError, uint64 &nEntries)
+{
+	FILE *pSource = fopen(pszSource, "rb");
+
+	if (!pSource)
+	{
+		strError = std::string("Failed to open ") + pszSource;
+		return false;
+	}
+
+	std::string strFile;
+	char szBuffer[65536];
+	size_t nRead;
+
+	while ((nRead = fread(szBuffer, 1, sizeof(szBuffer), pSource)) > 0)
+		strFile.append(szBuffer, nRead);
+
+	fclose(pSource);
+
+	std::vector<BanDatabaseSteamID_t> vecSteamIDs;
+	std::vector<BanDatabaseAddress_t> vecAddresses;
+	size_t nLength = strlen(pszSource);
+
+	if (nLength >= 4 && !V_stricmp(pszSource + nLength - 4, ".csv"))
+	{
+		ParseBanCSV(strFile, vecSteamIDs, vecAddresses);
+	}
+	else
+	{
+		ParseBanInfractions(strFile, vecSteamIDs);
+		ReplayBanJournal(std::filesystem::path(pszSource).replace_extension(".journal").string().c_str(), vecSteamIDs);
+	}
+
+	return Build(vecSteamIDs, vecAddresses, pszOutput, strError, nEntries);
+}
+
+bool CBanDatabase::Build(std::vector<BanDatabaseSteamID_t> &vecSteamIDs, std::vector<BanDatabaseAddress_t> &vecAddresses, const char *pszOutput,
+						 std::string &strError, uint64 &nEntries)
+{
+	SortAndMergeBans(vecSteamIDs, &BanDatabaseSteamID_t::iSteamID);
+	SortAndMergeBans(vecAddresses, &BanDatabaseAddress_t::iAddress);
+
+	nEntries = vecSteamIDs.size() + vecAddresses.size();
+
+	// At least 10 bits per key keeps false positives around 1% with 7 hashes
+	uint64 nBloomWords = 1;
+
+	while (nBloomWords * 64 < nEntries * 10)
+		nBloomWords <<= 1;
+
+	std::vector<uint64> vecBloom(nBloomWords, 0);
+
+	for (const BanDatabaseSteamID_t &ban : vecSteamIDs)
+		AddBloomKey(vecBloom, ban.iSteamID);
+
+	for (const BanDatabaseAddress_t &ban : vecAddresses)
+		AddBloomKey(vecBloom, BAN_DATABASE_ADDRESS_KEY | ban.iAddress);
+
+	BanDatabaseHeader_t header = {};
+	header.iMagic = BAN_DATABASE_MAGIC;
+	header.iVersion = BAN_DATABASE_VERSION;
+	header.nSteamIDs = vecSteamIDs.size();
+	header.nAddresses = vecAddresses.size();
+	header.nBloomWords = nBloomWords;
+	header.nBloomHashes = BAN_DATABASE_BLOOM_HASHES;
+
+	// Written aside and moved into place so nobody ever maps half a file
+	std::string strTempPath = std::string(pszOutput) + ".tmp";
+	FILE *pOutput = fopen(strTempPath.c_str(), "wb");
+
+	if (!pOutput)
+	{
+		strError = "Failed to open " + strTempPath + " for writing";
+		return false;
+	}
+
+	bool bSuccess = fwrite(&header, sizeof(header), 1, pOutput) == 1
+		&& fwrite(vecBloom.data(), sizeof(uint64), vecBloom.size(), pOutput) == vecBloom.size()
+		&& fwrite(vecSteamIDs.data(), sizeof(BanDatabaseSteamID_t), vecSteamIDs.size(), pOutput) == vecSteamIDs.size()
+		&& fwrite(vecAddresses.data(), sizeof(BanDatabaseAddress_t), vecAddresses.size(), pOutput) == vecAddresses.size();
+
+	bSuccess = fclose(pOutput) == 0 && bSuccess;
+
+	std::error_code error;
+
+	if (bSuccess)
+		std::filesystem::rename(strTempPath, pszOutput, error);
+
+	if (!bSuccess || error)
+	{
+		strError = std::string("Failed to write ") + pszOutput;
+		std::filesystem::remove(strTempPath, error);
+		return false;
+	}
+
+	return true;
+}
+
+bool CBanDatabase::StartBuild(const char *pszSource)
+{
+	if (m_buildThread.joinable())
+		return false;
+
+	// Goes next to bans.db rather than over it, a mapped file can't be replaced on Windows
+	std::string strSource = GetDataPath(pszSource);
+	std::string strOutput = GetDataPath("bans.db.new");
+
+	m_buildThread = std::thread([this, strSource, strOutput]() {
+		m_bBuildSucceeded = Build(strSource.c_str(), strOutput.c_str(), m_strBuildError, m_nBuildEntries);
+		m_bBuildDone.store(true, std::memory_order_release);
+	});
+
+	return true;
+}
+
+void CBanDatabase::RunFrame()
+{
+	if (!m_bBuildDone.load(std::memory_order_acquire))
+		return;
+
+	m_buildThread.join();
+	m_bBuildDone = false;
+
+	if (!m_bBuildSucceeded)
+	{
+		Warning("Failed to build the ban database: %s\n", m_strBuildError.c_str());
+		return;
+	}
+
+	Message("Built the ban database with %llu entries\n", m_nBuildEntries);
+
+	std::error_code error;
+
+	Unmap();
+	std::filesystem::rename(GetDataPath("bans.db.new"), GetDataPath("bans.db"), error);
+
+	if (error)
+		Warning("Failed to replace %s\n", GetDataPath("bans.db").c_str());
+
+	Load();
+}
+
+CON_COMMAND_F(cs2f_bandb_build, "<source> - Rebuild bans.db from a file in addons/cs2fixes/data, another server's infractions.txt or a CSV of steamid64,ip,endtime", FCVAR_SPONLY | FCVAR_LINKED_CONCOMMAND)
+{
+	if (args.ArgC() < 2)
+	{
+		Message("Usage: cs2f_bandb_build <source>\n");
+		return;
+	}
+
+	const char *pszSource = args[1];
+
+	if (strstr(pszSource, ".."))
+	{
+		Message("The source has to be inside addons/cs2fixes/data\n");
+		return;
+	}
+
+	// Those are checked on connect already, and an unban couldn't take them back out of bans.db
+	if (!V_stricmp(pszSource, "infractions.txt"))
+	{
+		Message("This server's own infractions are already checked by the admin system, bans.db is only for lists from elsewhere\n");
+		return;
+	}
+
+	if (!g_banDatabase.StartBuild(pszSource))
+	{
+		Message("The ban database is already being built\n");
+		return;
+	}
+
+	Message("Building the ban database from %s\n", pszSource);
+}
+
+CON_COMMAND_F(cs2f_bandb_reload, "Reload bans.db", FCVAR_SPONLY | FCVAR_LINKED_CONCOMMAND)
+{
+	if (!g_banDatabase.Load())
+		Message("No ban database loaded\n");
+}
+
+CON_COMMAND_F(cs2f_bandb_check, "<steamid64|ip> - Check whether a SteamID64 or IPv4 address is in bans.db", FCVAR_SPONLY | FCVAR_LINKED_CONCOMMAND)
+{
+	if (args.ArgC() < 2)
+	{
+		Message("Usage: cs2f_bandb_check <steamid64|ip>\n");
+		return;
+	}
+
+	uint32 iAddress;
+	bool bBanned;
+
+	if (CBanDatabase::ParseAddress(args[1], iAddress))
+		bBanned = g_banDatabase.IsAddressBanned(iAddress);
+	else
+		bBanned = g_banDatabase.IsSteamIDBanned(strtoull(args[1], nullptr, 10));
+
+	Message("%s is %s\n", args[1], bBanned ? "banned" : "not banned");
+}
+
+// Builds on the game thread so the timings are its own, which holds the server up for a few seconds
+CON_COMMAND_F(cs2f_bandb_test, "Build a ban database of a million SteamIDs in a temp directory, check it and benchmark lookups, stalls the server so only run it offline", FCVAR_SPONLY | FCVAR_LINKED_CONCOMMAND)
+{
+	const uint64 nBans = 1000000;
+	const uint64 iFirstSteamID = 76561197960265728ull;
+
+	std::error_code error;
+	std::filesystem::path testPath = std::filesystem::temp_directory_path(error) / "cs2fixes_bandb_test";
+
+	if (!error)
+		std::filesystem::create_directories(testPath, error);
+
+	if (error)
+	{
+		Message("Failed to create a temp directory for the test\n");
+		return;
+	}
+
+	std::string strSource = (testPath / "bans_test.csv").string();
+	std::string strOutput = (testPath / "bans_test.db").string();
+
+	FILE *pFile = fopen(strSource.c_str(), "wb");
+
+	if (!pFile)
+	{
+		Message("Failed to open %s for writing\n", strSource.c_str());
+		std::filesystem::remove_all(testPath, error);
+		return;
+	}
+
+	// Every other account is banned, every 1000th permanently and the rest for a day, along with a /16 of addresses
+	fprintf(pFile, "steamid64,ip,endtime\n");
+	int64 iEndTime = std::time(0) + 86400;
+
+	for (uint64 i = 0; i < nBans; i++)
+	{
+		if (i < 65536)
+			fprintf(pFile, "%llu,10.%llu.%llu.%llu,%lli\n", iFirstSteamID + i * 2, i >> 16, (i >> 8) & 255, i & 255, i % 1000 ? iEndTime : 0);
+		else
+			fprintf(pFile, "%llu,,%lli\n", iFirstSteamID + i * 2, i % 1000 ? iEndTime : 0);
+	}
+
+	// An expired ban that has to be left out
+	fprintf(pFile, "%llu,,1\n", iFirstSteamID + 1);
+	fclose(pFile);
+
+	std::string strError;
+	uint64 nEntries;
+	double flStart = Plat_FloatTime();
+	bool bBuilt = CBanDatabase::Build(strSource.c_str(), strOutput.c_str(), strError, nEntries);
+	double flBuild = Plat_FloatTime() - flStart;
+
+	CBanDatabase database;
+
+	if (!bBuilt || !database.Map(strOutput.c_str()))
+	{
+		Message("Failed to build the test database: %s\n", strError.c_str());
+		std::filesystem::remove_all(testPath, error);
+		return;
+	}
+
+	Message("Built %llu entries in %.0f ms\n", nEntries, flBuild * 1000);
+
+	uint64 nWrong = 0, nFalsePositives = 0;
+
+	for (uint64 i = 0; i < nBans * 2; i++)
+	{
+		bool bExpected = i % 2 == 0;
+
+		if (database.IsSteamIDBanned(iFirstSteamID + i) != bExpected)
+			nWrong++;
+
+		if (!bExpected && database.TestBloom(iFirstSteamID + i))
+			nFalsePositives++;
+	}
+
+	for (uint32 i = 0; i < 65536; i++)
+	{
+		if (!database.IsAddressBanned(0x0A000000 | i) || database.IsAddressBanned(0x0B000000 | i))
+			nWrong++;
+	}
+
+	if (!database.IsBanned(0, "10.0.1.2:27005") || database.IsBanned(iFirstSteamID + 1, "192.168.0.1"))
+		nWrong++;
+
+	Message("%llu wrong lookups, %.2f%% bloom false positives\n", nWrong, nFalsePositives * 100.0 / nBans);
+
+	// Connecting players are nearly never on the list, so that's the case that matters
+	volatile uint64 nSink = 0;
+	flStart = Plat_FloatTime();
+
+	for (uint64 i = 0; i < nBans; i++)
+		nSink = nSink + database.IsSteamIDBanned(iFirstSteamID + i * 2 + 1);
+
+	double flMiss = Plat_FloatTime() - flStart;
+	flStart = Plat_FloatTime();
+
+	for (uint64 i = 0; i < nBans; i++)
+		nSink = nSink + database.IsSteamIDBanned(iFirstSteamID + ((i * 7919) % nBans) * 2);
+
+	double flHit = Plat_FloatTime() - flStart;
+
+	Message("Lookup: %.1f ns when not banned, %.1f ns when banned\n", flMiss * 1e9 / nBans, flHit * 1e9 / nBans);
+
+	database.Unmap();
+	std::filesystem::remove_all(testPath, error);
+}
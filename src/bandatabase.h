@@ -0,0 +1,120 @@
+/**
+ * =============================================================================
+ * CS2Fixes
+ * Copyright (C) 2023-2024 Source2ZE
+ * =============================================================================
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License, version 3.0, as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "platform.h"
+#include <atomic>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+// addons/cs2fixes/data/bans.db, everything is little endian and laid out back to back:
+// BanDatabaseHeader_t, nBloomWords uint64 of bloom filter, nSteamIDs BanDatabaseSteamID_t sorted by SteamID,
+// then nAddresses BanDatabaseAddress_t sorted by address
+#define BAN_DATABASE_MAGIC 0x42443243 // "C2DB"
+#define BAN_DATABASE_VERSION 1
+
+// Addresses get a prefix no SteamID64 has so they can share the bloom filter
+#define BAN_DATABASE_ADDRESS_KEY 0xFFFF000000000000ull
+
+struct BanDatabaseHeader_t
+{
+	uint32 iMagic;
+	uint32 iVersion;
+	uint64 nSteamIDs;
+	uint64 nAddresses;
+	uint64 nBloomWords; // Always a power of 2
+	uint32 nBloomHashes;
+	uint32 iReserved;
+};
+
+struct BanDatabaseSteamID_t
+{
+	uint64 iSteamID;
+	int64 iEndTime; // 0 is permanent
+};
+
+struct BanDatabaseAddress_t
+{
+	uint32 iAddress; // IPv4 in host order, 1.2.3.4 is 0x01020304
+	uint32 iReserved;
+	int64 iEndTime;
+};
+
+// Read-only ban list from elsewhere checked on connect, on top of the infractions the admin system keeps in memory
+// Unbans only ever reach the admin system's own, so this server's infractions are kept out of it
+// It's mapped straight from disk so a list with millions of entries costs next to nothing to load,
+// and the bloom filter in front of it turns away nearly every player that isn't on it without touching the tables
+class CBanDatabase
+{
+public:
+	~CBanDatabase() { Unload(); }
+
+	// Maps addons/cs2fixes/data/bans.db, a missing file just leaves the list empty
+	bool Load();
+	void Unload();
+
+	bool Map(const char *pszPath);
+	void Unmap();
+
+	bool IsLoaded() { return m_pHeader != nullptr; }
+	uint64 GetSteamIDCount() { return m_pHeader ? m_pHeader->nSteamIDs : 0; }
+	uint64 GetAddressCount() { return m_pHeader ? m_pHeader->nAddresses : 0; }
+
+	// Either can be left out with 0 or nullptr
+	bool IsBanned(uint64 iSteamID, const char *pszAddress);
+	bool IsSteamIDBanned(uint64 iSteamID);
+	bool IsAddressBanned(uint32 iAddress);
+
+	// False means the key is in neither table, SteamIDs go in as they are and addresses with BAN_DATABASE_ADDRESS_KEY
+	bool TestBloom(uint64 iKey);
+
+	// Rebuilds bans.db from a file on a thread of its own, RunFrame maps it once it's done
+	bool StartBuild(const char *pszSource);
+	void RunFrame();
+
+	// Everything the build does, kept apart from the game so it can just as well run offline
+	// CSV lines are "steamid64,ip,endtime", any of them can be empty and lines starting with # are skipped
+	// Any other file is read like infractions.txt, with the .journal next to it replayed on top
+	static bool Build(const char *pszSource, const char *pszOutput, std::string &strError, uint64 &nEntries);
+	static bool Build(std::vector<BanDatabaseSteamID_t> &vecSteamIDs, std::vector<BanDatabaseAddress_t> &vecAddresses, const char *pszOutput,
+					  std::string &strError, uint64 &nEntries);
+	static bool ParseAddress(const char *pszAddress, uint32 &iAddress);
+
+private:
+	const BanDatabaseHeader_t *m_pHeader = nullptr;
+	const uint64 *m_pBloom = nullptr;
+	const BanDatabaseSteamID_t *m_pSteamIDs = nullptr;
+	const BanDatabaseAddress_t *m_pAddresses = nullptr;
+	size_t m_nMappedSize = 0;
+	void *m_pMapping = nullptr;
+#ifdef _WIN32
+	void *m_hFile = nullptr;
+	void *m_hMapping = nullptr;
+#endif
+
+	std::thread m_buildThread;
+	std::atomic<bool> m_bBuildDone{false};
+	bool m_bBuildSucceeded = false;
+	uint64 m_nBuildEntries = 0;
+	std::string m_strBuildError;
+};
+
+extern CBanDatabase g_banDatabase;
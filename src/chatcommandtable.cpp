@@ -0,0 +1,204 @@
+/**
+ * =============================================================================
+ * CS2Fixes
+ * Copyright (C) 2023-2024 Source2ZE
+ * =============================================================================
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License, version 3.0, as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "chatcommandtable.h"
+#include "commands.h"
+#include <algorithm>
+#include <vector>
+
+#include "tier0/memdbgon.h"
+
+CChatCommandTable g_chatCommandTable;
+
+// How many hash seeds to go through before giving up, a couple of hundred commands virtually always work on the first
+#define MAX_CHAT_COMMAND_TABLE_SEEDS 64
+
+bool CChatCommandTable::TryBuild(const CUtlVector<CChatCommand *> &vecCommands, uint32 iSeed)
+{
+	int nCommands = vecCommands.Count();
+
+	// Twice as many slots as commands and one bucket per 4 slots keeps the displacement search short
+	uint32 nSlots = 16;
+	while (nSlots < (uint32)nCommands * 2)
+		nSlots <<= 1;
+
+	uint32 nBuckets = nSlots / 4;
+
+	std::vector<uint32> vecHashes(nCommands);
+	std::vector<std::vector<int>> vecBuckets(nBuckets);
+
+	for (int i = 0; i < nCommands; i++)
+	{
+		vecHashes[i] = HashChatCommand(vecCommands[i]->GetName(), iSeed);
+
+		// Names are unique by now, so an equal hash is a real collision and this seed won't do
+		for (int j = 0; j < i; j++)
+		{
+			if (vecHashes[i] == vecHashes[j])
+				return false;
+		}
+
+		vecBuckets[(vecHashes[i] >> 16) & (nBuckets - 1)].push_back(i);
+	}
+
+	std::vector<uint32> vecBucketOrder(nBuckets);
+	for (uint32 i = 0; i < nBuckets; i++)
+		vecBucketOrder[i] = i;
+
+	// Fullest buckets first, while there's still plenty of room
+	std::stable_sort(vecBucketOrder.begin(), vecBucketOrder.end(), [&](uint32 a, uint32 b) {
+		return vecBuckets[a].size() > vecBuckets[b].size();
+	});
+
+	m_vecDisplacements.SetCount(nBuckets);
+	m_vecSlots.SetCount(nSlots);
+
+	for (uint32 i = 0; i < nBuckets; i++)
+		m_vecDisplacements[i] = 0;
+
+	for (uint32 i = 0; i < nSlots; i++)
+		m_vecSlots[i] = { nullptr, 0, 0 };
+
+	for (uint32 iBucket : vecBucketOrder)
+	{
+		std::vector<int> &vecKeys = vecBuckets[iBucket];
+
+		if (vecKeys.empty())
+			break;
+
+		bool bPlaced = false;
+
+		for (uint32 iDisplacement = 0; iDisplacement < nSlots * 4 && !bPlaced; iDisplacement++)
+		{
+			bPlaced = true;
+
+			for (size_t i = 0; i < vecKeys.size() && bPlaced; i++)
+			{
+				uint32 iSlot = GetSlot(vecHashes[vecKeys[i]], iDisplacement, nSlots - 1);
+
+				if (m_vecSlots[iSlot].pCommand)
+					bPlaced = false;
+
+				// Keys of the same bucket can't land on each other either
+				for (size_t j = 0; j < i && bPlaced; j++)
+				{
+					if (GetSlot(vecHashes[vecKeys[j]], iDisplacement, nSlots - 1) == iSlot)
+						bPlaced = false;
+				}
+			}
+
+			if (!bPlaced)
+				continue;
+
+			m_vecDisplacements[iBucket] = iDisplacement;
+
+			for (int iKey : vecKeys)
+			{
+				CChatCommand *pCommand = vecCommands[iKey];
+				m_vecSlots[GetSlot(vecHashes[iKey], iDisplacement, nSlots - 1)] = { pCommand, vecHashes[iKey], (uint32)V_strlen(pCommand->GetName()) };
+			}
+		}
+
+		if (!bPlaced)
+			return false;
+	}
+
+	m_iSeed = iSeed;
+	m_iBucketMask = nBuckets - 1;
+	m_iSlotMask = nSlots - 1;
+	m_nCommands = nCommands;
+
+	return true;
+}
+
+bool CChatCommandTable::Build(const CUtlVector<CChatCommand *> &vecCommands)
+{
+	Clear();
+
+	CUtlVector<CChatCommand *> vecUnique;
+
+	// The first registration of a name wins, which is what players have always gotten
+	FOR_EACH_VEC(vecCommands, i)
+	{
+		bool bDuplicate = false;
+
+		FOR_EACH_VEC(vecUnique, j)
+		{
+			if (!V_stricmp(vecCommands[i]->GetName(), vecUnique[j]->GetName()))
+			{
+				Warning("Chat command %s is registered more than once, only the first one will be used\n", vecCommands[i]->GetName());
+				bDuplicate = true;
+				break;
+			}
+		}
+
+		if (!bDuplicate)
+			vecUnique.AddToTail(vecCommands[i]);
+	}
+
+	for (uint32 i = 0; i < MAX_CHAT_COMMAND_TABLE_SEEDS; i++)
+	{
+		if (!TryBuild(vecUnique, 0x811c9dc5 + i * 0x9e3779b9))
+			continue;
+
+		// Every command has to find itself, anything else means the table is broken
+		FOR_EACH_VEC(vecUnique, j)
+		{
+			if (Find(vecUnique[j]->GetName()) != vecUnique[j])
+			{
+				Warning("Chat command table lookup of %s failed\n", vecUnique[j]->GetName());
+				Clear();
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	Warning("Failed to build the chat command table for %i commands\n", vecUnique.Count());
+	Clear();
+
+	return false;
+}
+
+void CChatCommandTable::Clear()
+{
+	m_vecDisplacements.Purge();
+	m_vecSlots.Purge();
+	m_iBucketMask = 0;
+	m_iSlotMask = 0;
+	m_nCommands = 0;
+}
+
+CChatCommand *CChatCommandTable::Find(std::string_view svName) const
+{
+	if (m_vecSlots.Count() == 0)
+		return nullptr;
+
+	uint32 iHash = HashChatCommand(svName, m_iSeed);
+	const Slot_t &slot = m_vecSlots[GetSlot(iHash, m_vecDisplacements[(iHash >> 16) & m_iBucketMask], m_iSlotMask)];
+
+	if (!slot.pCommand || slot.iHash != iHash || slot.nLength != svName.size())
+		return nullptr;
+
+	if (V_strnicmp(slot.pCommand->GetName(), svName.data(), svName.size()))
+		return nullptr;
+
+	return slot.pCommand;
+}
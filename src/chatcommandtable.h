@@ -0,0 +1,84 @@
+/**
+ * =============================================================================
+ * CS2Fixes
+ * Copyright (C) 2023-2024 Source2ZE
+ * =============================================================================
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License, version 3.0, as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "platform.h"
+#include "utlvector.h"
+#include <string_view>
+
+class CChatCommand;
+
+// FNV-1a with ASCII case folding done per byte, so the typed command never has to be copied and lowercased
+constexpr uint32 HashChatCommand(std::string_view svName, uint32 iSeed = 0x811c9dc5)
+{
+	uint32 iHash = iSeed;
+
+	for (char c : svName)
+	{
+		if (c >= 'A' && c <= 'Z')
+			c += 'a' - 'A';
+
+		iHash = (iHash ^ (uint8)c) * 0x01000193;
+	}
+
+	return iHash;
+}
+
+static_assert(HashChatCommand("Help") == HashChatCommand("help"), "Chat command hashing must ignore case");
+static_assert(HashChatCommand("help") != HashChatCommand("hide"), "Chat command hashing is broken");
+
+// Perfect hash over every registered chat command, built once everything has registered
+// Keys are bucketed by their hash and every bucket gets a displacement that puts its keys in free slots,
+// so a lookup is one hash, two array reads and a single name comparison
+class CChatCommandTable
+{
+public:
+	// Returns false if no collision free layout was found, duplicate names are dropped with a warning
+	bool Build(const CUtlVector<CChatCommand *> &vecCommands);
+	void Clear();
+
+	CChatCommand *Find(std::string_view svName) const;
+
+	int GetCommandCount() const { return m_nCommands; }
+	int GetSlotCount() const { return m_vecSlots.Count(); }
+
+private:
+	struct Slot_t
+	{
+		CChatCommand *pCommand;
+		uint32 iHash;
+		uint32 nLength;
+	};
+
+	static uint32 GetSlot(uint32 iHash, uint32 iDisplacement, uint32 iSlotMask)
+	{
+		return (iHash + iDisplacement * ((iHash >> 7) | 1)) & iSlotMask;
+	}
+
+	bool TryBuild(const CUtlVector<CChatCommand *> &vecCommands, uint32 iSeed);
+
+	CUtlVector<uint32> m_vecDisplacements;
+	CUtlVector<Slot_t> m_vecSlots;
+	uint32 m_iSeed = 0x811c9dc5;
+	uint32 m_iBucketMask = 0;
+	uint32 m_iSlotMask = 0;
+	int m_nCommands = 0;
+};
+
+extern CChatCommandTable g_chatCommandTable;
@@ -23,6 +23,7 @@
 #include "utlstring.h"
 #include "recipientfilters.h"
 #include "commands.h"
+#include "chatcommandtable.h"
 #include "utils/entity.h"
 #include "entity/cbaseentity.h"
 #include "entity/ccsweaponbase.h"
@@ -52,6 +53,7 @@ extern IGameEventSystem *g_gameEventSystem;
 extern CGameEntitySystem *g_pEntitySystem;
 extern IVEngineServer2* g_pEngineServer2;
 extern ISteamHTTP* g_http;
+extern INetworkMessages *g_pNetworkMessages;
 
 bool g_bEnableCommands;
 bool g_bEnableAdminCommands;
@@ -252,17 +254,11 @@ void ParseChatCommand(const char *pMessage, CCSPlayerController *pController)
 
 	CCommand args;
 	args.Tokenize(pMessage);
-	std::string name = args[0];
 
-	for (int i = 0; name[i]; i++)
-		name[i] = tolower(name[i]);
+	CChatCommand *pCommand = g_chatCommandTable.Find(args[0]);
 
-	uint16 index = g_CommandList.Find(hash_32_fnv1a_const(name.c_str()));
-
-	if (g_CommandList.IsValidIndex(index))
-	{
-		(*g_CommandList[index])(args, pController);
-	}
+	if (pCommand)
+		(*pCommand)(args, pController);
 }
 
 bool CChatCommand::CheckCommandAccess(CCSPlayerController *pPlayer, uint64 flags)
@@ -283,6 +279,95 @@ bool CChatCommand::CheckCommandAccess(CCSPlayerController *pPlayer, uint64 flags
 	return true;
 }
 
+// Console lines to the same recipients are joined up to this size, the client splits them back up on newlines
+#define MAX_COALESCED_TEXTMSG_LENGTH 512
+
+struct ClientPrintMessage_t
+{
+	uint64 iRecipients;
+	int iDest;
+	int nLength;
+	char szText[MAX_COALESCED_TEXTMSG_LENGTH];
+};
+
+// Everything printed this frame, posted at the end of it by FlushClientPrintOutbox
+// The vector is only emptied between frames so its memory gets reused
+static CUtlVector<ClientPrintMessage_t> g_vecClientPrintOutbox;
+
+static INetworkMessageInternal *g_pTextMsgNetMessage = nullptr;
+static CUserMessageTextMsg *g_pTextMsgData = nullptr;
+
+static void QueueClientPrint(uint64 iRecipients, int hud_dest, const char *pszText)
+{
+	if (!iRecipients)
+		return;
+
+	int nLength = V_strlen(pszText);
+
+	// Only the console takes multiple lines in one message, chat and HUD text is shown as a single line
+	if (hud_dest == HUD_PRINTCONSOLE && g_vecClientPrintOutbox.Count() > 0)
+	{
+		ClientPrintMessage_t &last = g_vecClientPrintOutbox.Tail();
+
+		if (last.iDest == hud_dest && last.iRecipients == iRecipients && last.nLength + nLength + 2 <= MAX_COALESCED_TEXTMSG_LENGTH)
+		{
+			last.szText[last.nLength++] = '\n';
+			V_strncpy(last.szText + last.nLength, pszText, sizeof(last.szText) - last.nLength);
+			last.nLength += nLength;
+			return;
+		}
+	}
+
+	ClientPrintMessage_t &message = g_vecClientPrintOutbox[g_vecClientPrintOutbox.AddToTail()];
+	message.iRecipients = iRecipients;
+	message.iDest = hud_dest;
+	V_strncpy(message.szText, pszText, sizeof(message.szText));
+	message.nLength = V_strlen(message.szText);
+}
+
+void FlushClientPrintOutbox()
+{
+	if (g_vecClientPrintOutbox.Count() == 0)
+		return;
+
+	VPROF("FlushClientPrintOutbox");
+
+	if (!g_pTextMsgNetMessage)
+	{
+		g_pTextMsgNetMessage = g_pNetworkMessages->FindNetworkMessagePartial("TextMsg");
+		g_pTextMsgData = g_pTextMsgNetMessage->AllocateMessage()->ToPB<CUserMessageTextMsg>();
+	}
+
+	for (int i = 0; i < g_vecClientPrintOutbox.Count(); i++)
+	{
+		ClientPrintMessage_t &message = g_vecClientPrintOutbox[i];
+		CRecipientFilter filter;
+		filter.AddRecipientsFromMask(message.iRecipients);
+
+		if (filter.GetRecipientCount() == 0)
+			continue;
+
+		g_pTextMsgData->Clear();
+		g_pTextMsgData->set_dest(message.iDest);
+		g_pTextMsgData->add_param(message.szText);
+
+		g_gameEventSystem->PostEventAbstract(-1, false, &filter, g_pTextMsgNetMessage, g_pTextMsgData, 0);
+	}
+
+	g_vecClientPrintOutbox.RemoveAll();
+}
+
+void ClearClientPrintOutbox()
+{
+	g_vecClientPrintOutbox.Purge();
+
+	if (g_pTextMsgData)
+		delete g_pTextMsgData;
+
+	g_pTextMsgData = nullptr;
+	g_pTextMsgNetMessage = nullptr;
+}
+
 void ClientPrintAll(int hud_dest, const char *msg, ...)
 {
 	va_list args;
@@ -293,20 +378,30 @@ void ClientPrintAll(int hud_dest, const char *msg, ...)
 
 	va_end(args);
 
-	INetworkMessageInternal *pNetMsg = g_pNetworkMessages->FindNetworkMessagePartial("TextMsg");
-	auto data = pNetMsg->AllocateMessage()->ToPB<CUserMessageTextMsg>();
+	uint64 iRecipients = 0;
 
-	data->set_dest(hud_dest);
-	data->add_param(buf);
+	for (int i = 0; i < MAXPLAYERS; i++)
+	{
+		if (g_playerManager->GetPlayer(i))
+			iRecipients |= 1ull << i;
+	}
 
-	CRecipientFilter filter;
-	filter.AddAllPlayers();
+	QueueClientPrint(iRecipients, hud_dest, buf);
 
-	g_gameEventSystem->PostEventAbstract(-1, false, &filter, pNetMsg, data, 0);
+	ConMsg("%s\n", buf);
+}
 
-	delete data;
+void ClientPrintMask(uint64 iRecipients, int hud_dest, const char *msg, ...)
+{
+	va_list args;
+	va_start(args, msg);
 
-	ConMsg("%s\n", buf);
+	char buf[256];
+	V_vsnprintf(buf, sizeof(buf), msg, args);
+
+	va_end(args);
+
+	QueueClientPrint(iRecipients, hud_dest, buf);
 }
 
 void ClientPrint(CCSPlayerController *player, int hud_dest, const char *msg, ...)
@@ -325,17 +420,7 @@ void ClientPrint(CCSPlayerController *player, int hud_dest, const char *msg, ...
 		return;
 	}
 
-	INetworkMessageInternal *pNetMsg = g_pNetworkMessages->FindNetworkMessagePartial("TextMsg");
-	auto data = pNetMsg->AllocateMessage()->ToPB<CUserMessageTextMsg>();
-
-	data->set_dest(hud_dest);
-	data->add_param(buf);
-
-	CSingleRecipientFilter filter(player->GetPlayerSlot());
-
-	g_gameEventSystem->PostEventAbstract(-1, false, &filter, pNetMsg, data, 0);
-
-	delete data;
+	QueueClientPrint(1ull << player->GetPlayerSlot(), hud_dest, buf);
 }
 
 bool g_bEnableStopSound = false;
@@ -537,7 +622,7 @@ CON_COMMAND_CHAT(spec, "[name] - Spectate another player or join spectators")
 	// 1 frame delay as observer services will be null on same frame as spectator team switch
 	CHandle<CCSPlayerController> hPlayer = player->GetHandle();
 	CHandle<CCSPlayerController> hTarget = pTarget->GetHandle();
-	new CTimer(0.0f, false, false, [hPlayer, hTarget](){
+	new CTimer("spec_target", 0.0f, false, false, [hPlayer, hTarget](){
 		CCSPlayerController* pPlayer = hPlayer.Get();
 		CCSPlayerController* pTargetPlayer = hTarget.Get();
 		if (!pPlayer || !pTargetPlayer)
@@ -594,7 +679,7 @@ CON_COMMAND_CHAT(info, "<name> - Get a player's information")
 		if (zpTarget->IsAuthenticated())
 			ClientPrint(player, HUD_PRINTCONSOLE, "\tSteam64 ID: %llu", zpTarget->GetSteamId64());
 		else
-			ClientPrint(player, HUD_PRINTCONSOLE, "\tSteam64 ID: %llu (Unauthenticated)", zpTarget->GetUnauthenticatedSteamId());
+			ClientPrint(player, HUD_PRINTCONSOLE, "\tSteam64 ID: %llu (Unauthenticated)", zpTarget->GetUnauthenticatedSteamId64());
 
 		if (bIsAdmin)
 			ClientPrint(player, HUD_PRINTCONSOLE, "\tIP Address: %s", zpTarget->GetIpAddress());
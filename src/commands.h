@@ -33,7 +33,7 @@ typedef void (*FnChatCommandCallback_t)(const CCommand &args, CCSPlayerControlle
 
 class CChatCommand;
 
-extern CUtlMap<uint32, CChatCommand*> g_CommandList;
+extern CUtlVector<CChatCommand*> g_CommandList;
 
 extern bool g_bEnableCommands;
 extern bool g_bEnableAdminCommands;
@@ -47,6 +47,13 @@ extern float g_flMaxShakeAmp;
 void ClientPrintAll(int destination, const char *msg, ...);
 void ClientPrint(CCSPlayerController *player, int destination, const char *msg, ...);
 
+// Sends one message to every slot set in iRecipients, instead of a ClientPrint per player
+void ClientPrintMask(uint64 iRecipients, int destination, const char *msg, ...);
+
+// Prints are queued and sent at the end of the frame, consecutive console lines to the same players go out as one message
+void FlushClientPrintOutbox();
+void ClearClientPrintOutbox();
+
 // Just a wrapper class so we're able to insert the callback
 class CChatCommand
 {
@@ -54,7 +61,7 @@ public:
 	CChatCommand(const char *cmd, FnChatCommandCallback_t callback, const char *description, uint64 adminFlags = ADMFLAG_NONE, uint64 cmdFlags = CMDFLAG_NONE) :
 		m_pfnCallback(callback), m_sName(cmd), m_sDescription(description), m_nAdminFlags(adminFlags), m_nCmdFlags(cmdFlags)
 	{
-		g_CommandList.Insert(hash_32_fnv1a_const(cmd), this);
+		g_CommandList.AddToTail(this);
 	}
 
 	void operator()(const CCommand &args, CCSPlayerController *player)
@@ -59,6 +59,13 @@
 #include "cs_gameevents.pb.h"
 #include "gameevents.pb.h"
 #include "leader.h"
+#include "playersnapshot.h"
+#include "workerpool.h"
+#include "playernameindex.h"
+#include "netmessagefilters.h"
+#include "chatcommandtable.h"
+#include "bandatabase.h"
+#include "sharedcache.h"
 #include "usermessages.pb.h"
 
 #include "tier0/memdbgon.h"
@@ -133,6 +140,7 @@ CGameConfig *g_GameConfig = nullptr;
 ISteamHTTP *g_http = nullptr;
 CSteamGameServerAPIContext g_steamAPI;
 CCSGameRules *g_pGameRules = nullptr;
+CWorkerPool g_transmitWorkers;
 int g_iCGamePlayerEquipUseId = -1;
 int g_iCreateWorkshopMapGroupId = -1;
 int g_iOnTakeDamageAliveId = -1;
@@ -198,7 +206,7 @@ bool CS2Fixes::Load(PluginId id, ISmmAPI *ismm, char *error, size_t maxlen, bool
 	SH_ADD_HOOK(IServerGameClients, ClientActive, g_pSource2GameClients, SH_MEMBER(this, &CS2Fixes::Hook_ClientActive), true);
 	SH_ADD_HOOK(IServerGameClients, ClientDisconnect, g_pSource2GameClients, SH_MEMBER(this, &CS2Fixes::Hook_ClientDisconnect), true);
 	SH_ADD_HOOK(IServerGameClients, ClientPutInServer, g_pSource2GameClients, SH_MEMBER(this, &CS2Fixes::Hook_ClientPutInServer), true);
-	SH_ADD_HOOK(IServerGameClients, ClientSettingsChanged, g_pSource2GameClients, SH_MEMBER(this, &CS2Fixes::Hook_ClientSettingsChanged), false);
+	SH_ADD_HOOK(IServerGameClients, ClientSettingsChanged, g_pSource2GameClients, SH_MEMBER(this, &CS2Fixes::Hook_ClientSettingsChanged), true);
 	SH_ADD_HOOK(IServerGameClients, OnClientConnected, g_pSource2GameClients, SH_MEMBER(this, &CS2Fixes::Hook_OnClientConnected), false);
 	SH_ADD_HOOK(IServerGameClients, ClientConnect, g_pSource2GameClients, SH_MEMBER(this, &CS2Fixes::Hook_ClientConnect), false );
 	SH_ADD_HOOK(IServerGameClients, ClientCommand, g_pSource2GameClients, SH_MEMBER(this, &CS2Fixes::Hook_ClientCommand), false);
@@ -303,6 +311,7 @@ bool CS2Fixes::Load(PluginId id, ISmmAPI *ismm, char *error, size_t maxlen, bool
 	}
 
 	g_pAdminSystem = new CAdminSystem();
+	g_banDatabase.Load();
 	g_playerManager = new CPlayerManager(late);
 	g_pDiscordBotManager = new CDiscordBotManager();
 	g_pZRPlayerClassManager = new CZRPlayerClassManager();
@@ -316,22 +325,24 @@ bool CS2Fixes::Load(PluginId id, ISmmAPI *ismm, char *error, size_t maxlen, bool
 
 	RegisterWeaponCommands();
 
-	// Check hide distance
-	new CTimer(0.5f, true, true, []()
+	// Every chat command has registered itself by now, including the weapon ones
+	g_chatCommandTable.Build(g_CommandList);
+	RegisterNetMessageFilters();
+
+	new CTimer("netmsg_stats_dump", 5.0f, true, true, []()
 	{
-		g_playerManager->CheckHideDistances();
-		return 0.5f;
+		return NetMessageStatsDumpThink();
 	});
 
 	// Check for the expiration of infractions like mutes or gags
-	new CTimer(30.0f, true, true, []()
+	new CTimer("check_infractions", 30.0f, true, true, []()
 	{
 		g_playerManager->CheckInfractions();
 		return 30.0f;
 	});
 
 	// Check for idle players and kick them if permitted by cs2f_idle_kick_* 'convars'
-	new CTimer(5.0f, true, true, []()
+	new CTimer("idle_kick", 5.0f, true, true, []()
 	{
 		g_pIdleSystem->CheckForIdleClients();
 		return 5.0f;
@@ -356,7 +367,7 @@ bool CS2Fixes::Unload(char *error, size_t maxlen)
 	SH_REMOVE_HOOK(IServerGameClients, ClientActive, g_pSource2GameClients, SH_MEMBER(this, &CS2Fixes::Hook_ClientActive), true);
 	SH_REMOVE_HOOK(IServerGameClients, ClientDisconnect, g_pSource2GameClients, SH_MEMBER(this, &CS2Fixes::Hook_ClientDisconnect), true);
 	SH_REMOVE_HOOK(IServerGameClients, ClientPutInServer, g_pSource2GameClients, SH_MEMBER(this, &CS2Fixes::Hook_ClientPutInServer), true);
-	SH_REMOVE_HOOK(IServerGameClients, ClientSettingsChanged, g_pSource2GameClients, SH_MEMBER(this, &CS2Fixes::Hook_ClientSettingsChanged), false);
+	SH_REMOVE_HOOK(IServerGameClients, ClientSettingsChanged, g_pSource2GameClients, SH_MEMBER(this, &CS2Fixes::Hook_ClientSettingsChanged), true);
 	SH_REMOVE_HOOK(IServerGameClients, OnClientConnected, g_pSource2GameClients, SH_MEMBER(this, &CS2Fixes::Hook_OnClientConnected), false);
 	SH_REMOVE_HOOK(IServerGameClients, ClientConnect, g_pSource2GameClients, SH_MEMBER(this, &CS2Fixes::Hook_ClientConnect), false );
 	SH_REMOVE_HOOK(IServerGameClients, ClientCommand, g_pSource2GameClients, SH_MEMBER(this, &CS2Fixes::Hook_ClientCommand), false);
@@ -374,11 +385,16 @@ bool CS2Fixes::Unload(char *error, size_t maxlen)
 
 	ConVar_Unregister();
 
+	g_chatCommandTable.Clear();
 	g_CommandList.Purge();
 
 	FlushAllDetours();
 	UndoPatches();
 	RemoveTimers();
+	ClearClientPrintOutbox();
+	g_banDatabase.Unload();
+	g_sharedCache.Close();
+	g_transmitWorkers.SetThreadCount(0);
 	UnregisterEventListeners();
 
 	if (g_playerManager)
@@ -475,18 +491,13 @@ void CS2Fixes::Hook_DispatchConCommand(ConCommandHandle cmdHandle, const CComman
 			char *pszMessage = (char*)(args.ArgS() + 2);
 			pszMessage[V_strlen(pszMessage) - 1] = 0;
 
-			for (int i = 0; i < gpGlobals->maxClients; i++)
-			{
-				ZEPlayer *pPlayer = g_playerManager->GetPlayer(i);
+			uint64 iAdmins = g_playerManager->GetAdminMask(ADMFLAG_GENERIC);
 
-				if (!pPlayer)
-					continue;
+			ClientPrintMask(iAdmins, HUD_PRINTTALK, " \4(ADMINS) %s:\1 %s", pController->GetPlayerName(), pszMessage);
 
-				if (pPlayer->IsAdminFlagSet(ADMFLAG_GENERIC))
-					ClientPrint(CCSPlayerController::FromSlot(i), HUD_PRINTTALK, " \4(ADMINS) %s:\1 %s", pController->GetPlayerName(), pszMessage);
-				else if (i == iCommandPlayerSlot.Get()) // Sender is not an admin
-					ClientPrint(pController, HUD_PRINTTALK, " \4(TO ADMINS) %s:\1 %s", pController->GetPlayerName(), pszMessage);
-			}
+			// Sender is not an admin
+			if (!(iAdmins & (1ull << iCommandPlayerSlot.Get())))
+				ClientPrint(pController, HUD_PRINTTALK, " \4(TO ADMINS) %s:\1 %s", pController->GetPlayerName(), pszMessage);
 		}
 
 		// Finally, run the chat command if it is one, so anything will print after the player's message
@@ -561,68 +572,89 @@ void CS2Fixes::Hook_GameServerSteamAPIDeactivated()
 	RETURN_META(MRES_IGNORED);
 }
 
-void CS2Fixes::Hook_PostEvent(CSplitScreenSlot nSlot, bool bLocalOnly, int nClientCount, const uint64* clients,
-	INetworkMessageInternal* pEvent, const CNetMessage* pData, unsigned long nSize, NetChannelBufType_t bufType)
+// Post the silenced sound to those who use silencesound, stopsound and silencesound users are then dropped by their opt-outs
+static void FilterFireBullets(NetMessageContext_t &context)
 {
-	// Message( "Hook_PostEvent(%d, %d, %d, %lli)\n", nSlot, bLocalOnly, nClientCount, clients );
+	if (!g_bEnableStopSound || !g_playerManager->GetSilenceSoundMask())
+		return;
+
 	// Need to explicitly get a pointer to the right function as it's overloaded and SH_CALL can't resolve that
 	static void (IGameEventSystem::*PostEventAbstract)(CSplitScreenSlot, bool, int, const uint64 *,
 					INetworkMessageInternal *, const CNetMessage *, unsigned long, NetChannelBufType_t) = &IGameEventSystem::PostEventAbstract;
 
-	NetMessageInfo_t *info = pEvent->GetNetMessageInfo();
+	// Creating a new event object requires us to include the protobuf c files which I didn't feel like doing yet
+	// So instead just edit the event in place and reset later
+	auto msg = const_cast<CNetMessage*>(context.pData)->ToPB<CMsgTEFireBullets>();
 
-	if (g_bEnableStopSound && info->m_MessageId == GE_FireBulletsId)
-	{
-		if (g_playerManager->GetSilenceSoundMask())
-		{
-			// Post the silenced sound to those who use silencesound
-			// Creating a new event object requires us to include the protobuf c files which I didn't feel like doing yet
-			// So instead just edit the event in place and reset later
-			auto msg = const_cast<CNetMessage*>(pData)->ToPB<CMsgTEFireBullets>();
+	int32_t weapon_id = msg->weapon_id();
+	int32_t sound_type = msg->sound_type();
+	int32_t item_def_index = msg->item_def_index();
 
-			int32_t weapon_id = msg->weapon_id();
-			int32_t sound_type = msg->sound_type();
-			int32_t item_def_index = msg->item_def_index();
+	// original weapon_id will override new settings if not removed
+	msg->set_weapon_id(0);
+	msg->set_sound_type(9);
+	msg->set_item_def_index(61); // weapon_usp_silencer
 
-			// original weapon_id will override new settings if not removed
-			msg->set_weapon_id(0);
-			msg->set_sound_type(9);
-			msg->set_item_def_index(61); // weapon_usp_silencer
+	uint64 clientMask = *context.pClients & g_playerManager->GetSilenceSoundMask();
 
-			uint64 clientMask = *(uint64 *)clients & g_playerManager->GetSilenceSoundMask();
+	SH_CALL(g_gameEventSystem, PostEventAbstract)
+	(context.nSlot, context.bLocalOnly, context.nClientCount, &clientMask, context.pEvent, msg, context.nSize, context.bufType);
 
-			SH_CALL(g_gameEventSystem, PostEventAbstract)
-			(nSlot, bLocalOnly, nClientCount, &clientMask, pEvent, msg, nSize, bufType);
+	msg->set_weapon_id(weapon_id);
+	msg->set_sound_type(sound_type);
+	msg->set_item_def_index(item_def_index);
+}
 
-			msg->set_weapon_id(weapon_id);
-			msg->set_sound_type(sound_type);
-			msg->set_item_def_index(item_def_index);
-		}
+static void FilterLegacyGameEvent(NetMessageContext_t &context)
+{
+	if (g_bEnableLeader)
+		Leader_PostEventAbstract_Source1LegacyGameEvent(context.pClients, context.pData);
+}
 
-		// Filter out people using stop/silence sound from the original event
-		*(uint64 *)clients &= ~g_playerManager->GetStopSoundMask();
-		*(uint64 *)clients &= ~g_playerManager->GetSilenceSoundMask();
-	}
-	else if (info->m_MessageId == TE_WorldDecalId)
-	{
-		*(uint64 *)clients &= ~g_playerManager->GetStopDecalsMask();
-	}
-	else if (info->m_MessageId == GE_Source1LegacyGameEvent)
+static void FilterShake(NetMessageContext_t &context)
+{
+	auto pPBData = const_cast<CNetMessage*>(context.pData)->ToPB<CUserMessageShake>();
+	if (g_flMaxShakeAmp >= 0 && pPBData->amplitude() > g_flMaxShakeAmp)
+		pPBData->set_amplitude(g_flMaxShakeAmp);
+}
+
+// Hook_PostEvent only does any work for messages registered here, per-player opt-outs should be added the same way
+static void RegisterNetMessageFilters()
+{
+	ClearNetMessageFilters();
+
+	RegisterNetMessageFilter(GE_FireBulletsId, FilterFireBullets);
+	RegisterNetMessageOptOut(GE_FireBulletsId, "stopsound", []() { return g_playerManager->GetStopSoundMask(); }, &g_bEnableStopSound);
+	RegisterNetMessageOptOut(GE_FireBulletsId, "silencesound", []() { return g_playerManager->GetSilenceSoundMask(); }, &g_bEnableStopSound);
+
+	RegisterNetMessageOptOut(TE_WorldDecalId, "stopdecals", []() { return g_playerManager->GetStopDecalsMask(); });
+
+	RegisterNetMessageFilter(GE_Source1LegacyGameEvent, FilterLegacyGameEvent);
+
+	RegisterNetMessageFilter(UM_Shake, FilterShake);
+	RegisterNetMessageOptOut(UM_Shake, "noshake", []() { return g_playerManager->GetNoShakeMask(); }, &g_bEnableNoShake);
+}
+
+void CS2Fixes::Hook_PostEvent(CSplitScreenSlot nSlot, bool bLocalOnly, int nClientCount, const uint64* clients,
+	INetworkMessageInternal* pEvent, const CNetMessage* pData, unsigned long nSize, NetChannelBufType_t bufType)
+{
+	// Message( "Hook_PostEvent(%d, %d, %d, %lli)\n", nSlot, bLocalOnly, nClientCount, clients );
+	int iMessageId = pEvent->GetNetMessageInfo()->m_MessageId;
+	NetMessageFilter_t *pFilter = GetNetMessageFilter(iMessageId);
+
+	if (!pFilter && !g_bNetMessageStats)
+		return;
+
+	uint64 iRecipientsBefore = *clients;
+
+	if (pFilter)
 	{
-		if (g_bEnableLeader)
-			Leader_PostEventAbstract_Source1LegacyGameEvent(clients, pData);
+		NetMessageContext_t context = { nSlot, bLocalOnly, nClientCount, (uint64 *)clients, pEvent, pData, nSize, bufType };
+		RunNetMessageFilter(pFilter, context);
 	}
-	else if (info->m_MessageId == UM_Shake)
-	{
-		auto pPBData = const_cast<CNetMessage*>(pData)->ToPB<CUserMessageShake>();
-		if (g_flMaxShakeAmp >= 0 && pPBData->amplitude() > g_flMaxShakeAmp)
-			pPBData->set_amplitude(g_flMaxShakeAmp);
 
-		// remove client with noshake from the event
-		if (g_bEnableNoShake)
-			*(uint64 *)clients &= ~g_playerManager->GetNoShakeMask();
-	}
-	
+	if (g_bNetMessageStats)
+		RecordNetMessageStats(iMessageId, pEvent, nSize, iRecipientsBefore, *clients);
 }
 
 void CS2Fixes::AllPluginsLoaded()
@@ -706,6 +738,12 @@ void CS2Fixes::Hook_ClientSettingsChanged( CPlayerSlot slot )
 #ifdef _DEBUG
 	Message( "Hook_ClientSettingsChanged(%d)\n", slot );
 #endif
+
+	// Name changes come through here, the controller has the new name by the time the post hook runs
+	CCSPlayerController *pController = CCSPlayerController::FromSlot(slot);
+
+	if (pController && g_playerManager->GetPlayer(slot))
+		g_playerNameIndex.SetName(slot.Get(), pController->GetPlayerName());
 }
 
 void CS2Fixes::Hook_OnClientConnected(CPlayerSlot slot, const char* pszName, uint64 xuid, const char* pszNetworkID, const char* pszAddress, bool bFakePlayer)
@@ -719,7 +757,10 @@ void CS2Fixes::Hook_OnClientConnected(CPlayerSlot slot, const char* pszName, uin
 
 	// Ideally we would use CServerSideClient::IsHLTV().. but it doesn't work :(
 	if (bFakePlayer && V_strcmp(pszName, pszTvName))
+	{
 		g_playerManager->OnBotConnected(slot);
+		g_playerNameIndex.SetName(slot.Get(), pszName);
+	}
 }
 
 bool CS2Fixes::Hook_ClientConnect( CPlayerSlot slot, const char *pszName, uint64 xuid, const char *pszNetworkID, bool unk1, CBufferString *pRejectReason )
@@ -730,6 +771,8 @@ bool CS2Fixes::Hook_ClientConnect( CPlayerSlot slot, const char *pszName, uint64
 	if (!g_playerManager->OnClientConnected(slot, xuid, pszNetworkID))
 		RETURN_META_VALUE(MRES_SUPERCEDE, false);
 
+	g_playerNameIndex.SetName(slot.Get(), pszName);
+
 	RETURN_META_VALUE(MRES_IGNORED, true);
 }
 
@@ -741,6 +784,7 @@ void CS2Fixes::Hook_ClientPutInServer( CPlayerSlot slot, char const *pszName, in
 		return;
 
 	g_playerManager->OnClientPutInServer(slot);
+	g_playerNameIndex.SetName(slot.Get(), pszName);
 
 	if (g_bEnableZR)
 		ZR_Hook_ClientPutInServer(slot, pszName, type, xuid);
@@ -749,6 +793,9 @@ void CS2Fixes::Hook_ClientPutInServer( CPlayerSlot slot, char const *pszName, in
 void CS2Fixes::Hook_ClientDisconnect( CPlayerSlot slot, ENetworkDisconnectionReason reason, const char *pszName, uint64 xuid, const char *pszNetworkID )
 {
 	Message( "Hook_ClientDisconnect(%d, %d, \"%s\", %lli)\n", slot, reason, pszName, xuid );
+	g_playerNameIndex.RemoveName(slot.Get());
+	ResetNetMessageThrottle(slot.Get());
+
 	ZEPlayer* pPlayer = g_playerManager->GetPlayer(slot);
 
 	if (!pPlayer)
@@ -780,107 +827,170 @@ void CS2Fixes::Hook_GameFramePost(bool simulating, bool bFirstTick, bool bLastTi
 	g_flLastTickedTime = gpGlobals->curtime;
 	g_bHasTicked = true;
 
-	for (int i = g_timers.Tail(); i != g_timers.InvalidIndex();)
-	{
-		auto timer = g_timers[i];
+	RunTimers(gpGlobals->tickcount);
 
-		int prevIndex = i;
-		i = g_timers.Previous(i);
+    EntityHandler_OnGameFramePost(simulating, gpGlobals->tickcount);
 
-		if (timer->m_flLastExecute == -1)
-			timer->m_flLastExecute = g_flUniversalTime;
+	g_pAdminSystem->RunFrame();
+	g_sharedCache.RunFrame();
+	g_banDatabase.RunFrame();
+	FlushClientPrintOutbox();
+}
 
-		// Timer execute 
-		if (timer->m_flLastExecute + timer->m_flInterval <= g_flUniversalTime)
-		{
-			if ((!timer->m_bPreserveRoundChange && timer->m_iRoundNum != g_iRoundNum) || !timer->Execute())
-			{
-				delete timer;
-				g_timers.Remove(prevIndex);
-			}
-			else
-			{
-				timer->m_flLastExecute = g_flUniversalTime;
-			}
-		}
+extern bool g_bFlashLightTransmitOthers;
+
+typedef std::remove_pointer_t<decltype(CCheckTransmitInfo::m_pTransmitEntity)> TransmitBits_t;
+
+// Entities to stop transmitting to one player, every input comes from g_playerSnapshot
+// This only reads shared state so it's safe to run for several players at once
+static void FilterTransmitForPlayer(TransmitBits_t *pTransmitEntity, int iPlayerSlot)
+{
+	const CPlayerSnapshot &snapshot = g_playerSnapshot;
+	uint64 iSelfBit = SLOT_BIT(iPlayerSlot);
+	bool bSelfObserver = snapshot.m_iObserverMask & iSelfBit;
+
+	// Always transmit to themselves
+	uint64 iOthers = snapshot.m_iValidMask & ~snapshot.m_iHLTVMask & ~iSelfBit;
+
+	// Don't transmit other players' flashlights, except the one they're watching if in spec
+	uint64 iClearFlashLights = 0;
+
+	if (!g_bFlashLightTransmitOthers)
+	{
+		iClearFlashLights = iOthers & snapshot.m_iFlashLightMask;
+
+		if (bSelfObserver && snapshot.m_iObserverTargetSlot[iPlayerSlot] != -1)
+			iClearFlashLights &= ~SLOT_BIT(snapshot.m_iObserverTargetSlot[iPlayerSlot]);
 	}
 
-	if (g_bEnableZR)
-		CZRRegenTimer::Tick();
+	// Always transmit other players if spectating
+	// Hide players marked as hidden or ANY dead player, it seems that a ragdoll of a previously hidden player can crash?
+	// TODO: Revert this if/when valve fixes the issue?
+	// Also do not hide leaders to other players
+	uint64 iClearPawns = 0;
 
-    EntityHandler_OnGameFramePost(simulating, gpGlobals->tickcount);
+	if (g_bEnableHide && !bSelfObserver)
+		iClearPawns = iOthers & snapshot.m_iPlayerPawnMask & ((snapshot.m_iHideMask[iPlayerSlot] & snapshot.m_iHideableMask) | ~snapshot.m_iTransmitAliveMask);
+
+	for (; iClearFlashLights; iClearFlashLights &= iClearFlashLights - 1)
+		pTransmitEntity->Clear(snapshot.m_iFlashLightEntIndex[std::countr_zero(iClearFlashLights)]);
+
+	for (; iClearPawns; iClearPawns &= iClearPawns - 1)
+		pTransmitEntity->Clear(snapshot.m_iPawnEntIndex[std::countr_zero(iClearPawns)]);
+
+	// Don't transmit glow model to it's owner
+	if (snapshot.m_iGlowModelEntIndex[iPlayerSlot] != -1)
+		pTransmitEntity->Clear(snapshot.m_iGlowModelEntIndex[iPlayerSlot]);
 }
 
-extern bool g_bFlashLightTransmitOthers;
+static int g_iTransmitThreads = 0;
+FAKE_INT_CVAR(cs2f_transmit_threads, "Amount of extra threads to split CheckTransmit across, 0 to run it on the game thread only", g_iTransmitThreads, 0, false)
 
-void CS2Fixes::Hook_CheckTransmit(CCheckTransmitInfo **ppInfoList, int infoCount, CBitVec<16384> &unionTransmitEdicts,
-								const Entity2Networkable_t **pNetworkables, const uint16 *pEntityIndicies, int nEntities, bool bEnablePVSBits)
+#define MAX_TRANSMIT_THREADS 16
+
+static bool g_bTransmitSelfTest = false;
+
+struct TransmitJob_t
 {
-	if (!g_pEntitySystem)
-		return;
+	TransmitBits_t *pTransmitEntity;
+	int iPlayerSlot;
+};
 
-	VPROF("CS2Fixes::Hook_CheckTransmit");
+static void RunTransmitJob(int iJob, void *pContext)
+{
+	TransmitJob_t &job = ((TransmitJob_t *)pContext)[iJob];
+	FilterTransmitForPlayer(job.pTransmitEntity, job.iPlayerSlot);
+}
 
-	for (int i = 0; i < infoCount; i++)
-	{
-		auto &pInfo = ppInfoList[i];
+// Runs the threaded and the serial path on copies of the same input and makes sure they agree
+static void RunTransmitSelfTest(TransmitJob_t *pJobs, int nJobs)
+{
+	std::vector<TransmitBits_t> vecSerial(nJobs);
+	std::vector<TransmitBits_t> vecParallel(nJobs);
+	std::vector<TransmitJob_t> vecJobs(pJobs, pJobs + nJobs);
 
-		// the offset happens to have a player index here,
-		// though this is probably part of the client class that contains the CCheckTransmitInfo
-		static int offset = g_GameConfig->GetOffset("CheckTransmitPlayerSlot");
-		int iPlayerSlot = (int)*((uint8 *)pInfo + offset);
+	for (int i = 0; i < nJobs; i++)
+	{
+		vecSerial[i] = *pJobs[i].pTransmitEntity;
+		vecParallel[i] = *pJobs[i].pTransmitEntity;
+	}
 
-		CCSPlayerController* pSelfController = CCSPlayerController::FromSlot(iPlayerSlot);
+	for (int i = 0; i < nJobs; i++)
+		FilterTransmitForPlayer(&vecSerial[i], pJobs[i].iPlayerSlot);
 
-		if (!pSelfController || !pSelfController->IsConnected())
-			continue;
+	for (int i = 0; i < nJobs; i++)
+		vecJobs[i].pTransmitEntity = &vecParallel[i];
 
-		auto pSelfZEPlayer = g_playerManager->GetPlayer(iPlayerSlot);
+	double flStart = Plat_FloatTime();
+	g_transmitWorkers.Run(nJobs, RunTransmitJob, vecJobs.data());
+	double flParallel = Plat_FloatTime() - flStart;
 
-		if (!pSelfZEPlayer)
-			continue;
+	int nMismatches = 0;
 
-		for (int j = 0; j < gpGlobals->maxClients; j++)
+	for (int i = 0; i < nJobs; i++)
+	{
+		if (V_memcmp(&vecSerial[i], &vecParallel[i], sizeof(TransmitBits_t)))
 		{
-			CCSPlayerController* pController = CCSPlayerController::FromSlot(j);
+			Message("CheckTransmit self-test: results differ for player slot %i\n", pJobs[i].iPlayerSlot);
+			nMismatches++;
+		}
+	}
 
-			// Always transmit to themselves
-			if (!pController || pController->m_bIsHLTV || j == iPlayerSlot)
-				continue;
+	Message("CheckTransmit self-test: %i players on %i extra threads, %i mismatches, threaded pass took %.1f us\n",
+		nJobs, g_transmitWorkers.GetThreadCount(), nMismatches, flParallel * 1000000.0);
+}
 
-			// Don't transmit other players' flashlights, except the one they're watching if in spec
-			CBarnLight *pFlashLight = pController->IsConnected() ? g_playerManager->GetPlayer(j)->GetFlashLight() : nullptr;
+CON_COMMAND_F(cs2f_transmit_selftest, "Compare threaded and serial CheckTransmit results on the next tick", FCVAR_SPONLY | FCVAR_LINKED_CONCOMMAND)
+{
+	if (g_iTransmitThreads <= 0)
+	{
+		Message("cs2f_transmit_threads is 0, set it to the amount of threads to test first\n");
+		return;
+	}
 
-			if (!g_bFlashLightTransmitOthers && pFlashLight &&
-				!(pSelfController->GetPawnState() == STATE_OBSERVER_MODE && pSelfController->GetObserverTarget() == pController->GetPawn()))
-			{
-				pInfo->m_pTransmitEntity->Clear(pFlashLight->entindex());
-			}
+	g_bTransmitSelfTest = true;
+}
 
-			// Always transmit other players if spectating
-			if (!g_bEnableHide || pSelfController->GetPawnState() == STATE_OBSERVER_MODE)
-				continue;
+void CS2Fixes::Hook_CheckTransmit(CCheckTransmitInfo **ppInfoList, int infoCount, CBitVec<16384> &unionTransmitEdicts,
+								const Entity2Networkable_t **pNetworkables, const uint16 *pEntityIndicies, int nEntities, bool bEnablePVSBits)
+{
+	if (!g_pEntitySystem)
+		return;
 
-			// Get the actual pawn as the player could be currently spectating
-			CCSPlayerPawn *pPawn = pController->GetPlayerPawn();
+	VPROF("CS2Fixes::Hook_CheckTransmit");
 
-			if (!pPawn)
-				continue;
+	g_playerSnapshot.UpdateTransmitState(gpGlobals->tickcount);
 
-			// Hide players marked as hidden or ANY dead player, it seems that a ragdoll of a previously hidden player can crash?
-			// TODO: Revert this if/when valve fixes the issue?
-			// Also do not hide leaders to other players
-			ZEPlayer *pOtherZEPlayer = g_playerManager->GetPlayer(j);
-			if ((pSelfZEPlayer->ShouldBlockTransmit(j) && (pOtherZEPlayer && !pOtherZEPlayer->IsLeader())) || !pPawn->IsAlive())
-				pInfo->m_pTransmitEntity->Clear(pPawn->entindex());
-		}
+	// the offset happens to have a player index here,
+	// though this is probably part of the client class that contains the CCheckTransmitInfo
+	static int offset = g_GameConfig->GetOffset("CheckTransmitPlayerSlot");
+
+	uint64 iViewerMask = g_playerSnapshot.m_iConnectedMask & g_playerSnapshot.m_iZEPlayerMask;
+
+	static std::vector<TransmitJob_t> vecJobs;
+	vecJobs.clear();
+
+	for (int i = 0; i < infoCount; i++)
+	{
+		auto &pInfo = ppInfoList[i];
+		int iPlayerSlot = (int)*((uint8 *)pInfo + offset);
 
-		// Don't transmit glow model to it's owner
-		CBaseModelEntity *pGlowModel = pSelfZEPlayer->GetGlowModel();
+		if (iPlayerSlot >= MAXPLAYERS || !(iViewerMask & SLOT_BIT(iPlayerSlot)))
+			continue;
 
-		if (pGlowModel)
-			pInfo->m_pTransmitEntity->Clear(pGlowModel->entindex());
+		vecJobs.push_back({pInfo->m_pTransmitEntity, iPlayerSlot});
 	}
+
+	g_transmitWorkers.SetThreadCount(clamp(g_iTransmitThreads, 0, MAX_TRANSMIT_THREADS));
+
+	if (g_bTransmitSelfTest)
+	{
+		g_bTransmitSelfTest = false;
+		RunTransmitSelfTest(vecJobs.data(), (int)vecJobs.size());
+	}
+
+	// Every player has their own transmit bits, so the result is the same whichever thread handles them
+	g_transmitWorkers.Run((int)vecJobs.size(), RunTransmitJob, vecJobs.data());
 }
 
 void CS2Fixes::Hook_ApplyGameSettings(KeyValues* pKV)
@@ -18,25 +18,626 @@
  */
 
 #include "ctimer.h"
+#include "common.h"
+#include "edict.h"
+#include "icvar.h"
+#include "tier0/platform.h"
+#include <algorithm>
+#include <vector>
 
-CUtlLinkedList<CTimerBase*> g_timers;
+#ifdef _WIN32
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
 
-void RemoveTimers()
+extern double g_flUniversalTime;
+extern CGlobalVars *gpGlobals;
+
+float GetTimerTickInterval()
 {
-	g_timers.PurgeAndDeleteElements();
+    if (gpGlobals && gpGlobals->interval_per_tick > 0)
+        return gpGlobals->interval_per_tick;
+
+    return TIMER_DEFAULT_TICK_INTERVAL;
 }
 
-void RemoveMapTimers()
+int TimerSecondsToTicks(float flSeconds)
+{
+    if (flSeconds <= 0)
+        return 0;
+
+    int iTicks = (int)(flSeconds / GetTimerTickInterval() + 0.5f);
+    return iTicks > 0 ? iTicks : 1;
+}
+
+float TimerTicksToSeconds(int iTicks)
+{
+    return iTicks * GetTimerTickInterval();
+}
+
+CTimerPool *CTimerPool::s_pFirst = nullptr;
+CTimerPool g_timerPool("CTimer", sizeof(CTimer));
+
+CTimerPool::CTimerPool(const char *pszName, size_t nObjectSize, int nObjectsPerSlab) :
+    m_pszName(pszName), m_nObjectsPerSlab(nObjectsPerSlab)
+{
+    // Keep every slot aligned the same way operator new would
+    const size_t nAlign = alignof(std::max_align_t);
+    m_nObjectSize = ((nObjectSize > sizeof(FreeSlot) ? nObjectSize : sizeof(FreeSlot)) + nAlign - 1) & ~(nAlign - 1);
+
+    m_pNext = s_pFirst;
+    s_pFirst = this;
+}
+
+CTimerPool::~CTimerPool()
+{
+    FOR_EACH_VEC(m_vecSlabs, i)
+        ::operator delete(m_vecSlabs[i], std::align_val_t(alignof(std::max_align_t)));
+
+    for (CTimerPool **ppPool = &s_pFirst; *ppPool; ppPool = &(*ppPool)->m_pNext)
+    {
+        if (*ppPool == this)
+        {
+            *ppPool = m_pNext;
+            break;
+        }
+    }
+}
+
+void CTimerPool::AllocSlab()
+{
+    unsigned char *pSlab = (unsigned char *)::operator new(m_nObjectSize * m_nObjectsPerSlab, std::align_val_t(alignof(std::max_align_t)));
+    m_vecSlabs.AddToTail(pSlab);
+
+    // Thread the new slots onto the free list back to front so they get handed out in address order
+    for (int i = m_nObjectsPerSlab - 1; i >= 0; i--)
+    {
+        FreeSlot *pSlot = (FreeSlot *)(pSlab + i * m_nObjectSize);
+        pSlot->pNext = m_pFreeList;
+        m_pFreeList = pSlot;
+    }
+}
+
+void *CTimerPool::Alloc()
+{
+    if (!m_pFreeList)
+        AllocSlab();
+
+    FreeSlot *pSlot = m_pFreeList;
+    m_pFreeList = pSlot->pNext;
+
+    m_iAllocs++;
+    m_iLive++;
+
+    if (m_iLive > m_iPeak)
+        m_iPeak = m_iLive;
+
+    return pSlot;
+}
+
+void CTimerPool::Free(void *pMem)
+{
+    if (!pMem)
+        return;
+
+    FreeSlot *pSlot = (FreeSlot *)pMem;
+    pSlot->pNext = m_pFreeList;
+    m_pFreeList = pSlot;
+
+    m_iFrees++;
+    m_iLive--;
+}
+
+void *CTimer::operator new(size_t nSize)
+{
+    // Anything deriving from CTimer with extra members doesn't fit in the pool
+    if (nSize > g_timerPool.GetObjectSize())
+        return ::operator new(nSize);
+
+    return g_timerPool.Alloc();
+}
+
+void CTimer::operator delete(void *pMem, size_t nSize)
+{
+    if (nSize > g_timerPool.GetObjectSize())
+        ::operator delete(pMem);
+    else
+        g_timerPool.Free(pMem);
+}
+
+CON_COMMAND_F(cs2f_timer_pool_stats, "Print timer allocator statistics", FCVAR_SPONLY | FCVAR_LINKED_CONCOMMAND)
+{
+    for (CTimerPool *pPool = CTimerPool::GetFirst(); pPool; pPool = pPool->GetNext())
+    {
+        Message("%s: %d live (peak %d), %d slots in %d slabs of %d bytes, %llu allocs, %llu frees\n",
+            pPool->GetName(), pPool->GetLiveCount(), pPool->GetPeakCount(), pPool->GetCapacity(), pPool->GetSlabCount(),
+            (int)pPool->GetObjectSize(), pPool->GetAllocCount(), pPool->GetFreeCount());
+    }
+
+    Message("Timer functions too large to be stored inline: %llu\n", CTimerFunc::s_iHeapAllocations);
+}
+
+// Timers created since the last RunTimers() pass, they get anchored to the current time on the next one
+static CUtlVector<CTimerBase*> g_vecPendingTimers;
+
+// Binary min-heaps ordered by next execution time, so a frame only looks at timers that are actually due
+// Tick timers live in their own heap since their schedule is in server ticks rather than seconds
+static CUtlVector<CTimerBase*> g_vecTimerHeap;
+static CUtlVector<CTimerBase*> g_vecTickTimerHeap;
+
+static uint64 g_iTimerSequence = 0;
+
+// Server tick of the current RunTimers() pass
+static int g_iTimerTick = 0;
+
+static inline bool TimerLess(const CTimerBase *a, const CTimerBase *b)
+{
+    if (a->m_flNextExecute != b->m_flNextExecute)
+        return a->m_flNextExecute < b->m_flNextExecute;
+
+    // Timers due at the same time run in the order they were scheduled
+    return a->m_iSequence < b->m_iSequence;
+}
+
+static inline CUtlVector<CTimerBase*> &GetTimerHeap(const CTimerBase *pTimer)
+{
+    return pTimer->m_bTickMode ? g_vecTickTimerHeap : g_vecTimerHeap;
+}
+
+static inline void HeapSet(CUtlVector<CTimerBase*> &vecHeap, int i, CTimerBase *pTimer)
+{
+    vecHeap[i] = pTimer;
+    pTimer->m_iHeapIndex = i;
+}
+
+static void HeapSiftUp(CUtlVector<CTimerBase*> &vecHeap, int i)
+{
+    CTimerBase *pTimer = vecHeap[i];
+
+    while (i > 0)
+    {
+        int parent = (i - 1) / 2;
+
+        if (!TimerLess(pTimer, vecHeap[parent]))
+            break;
+
+        HeapSet(vecHeap, i, vecHeap[parent]);
+        i = parent;
+    }
+
+    HeapSet(vecHeap, i, pTimer);
+}
+
+static void HeapSiftDown(CUtlVector<CTimerBase*> &vecHeap, int i)
+{
+    CTimerBase *pTimer = vecHeap[i];
+    int count = vecHeap.Count();
+
+    while (true)
+    {
+        int child = 2 * i + 1;
+
+        if (child >= count)
+            break;
+
+        if (child + 1 < count && TimerLess(vecHeap[child + 1], vecHeap[child]))
+            child++;
+
+        if (!TimerLess(vecHeap[child], pTimer))
+            break;
+
+        HeapSet(vecHeap, i, vecHeap[child]);
+        i = child;
+    }
+
+    HeapSet(vecHeap, i, pTimer);
+}
+
+static void HeapPush(CUtlVector<CTimerBase*> &vecHeap, CTimerBase *pTimer)
+{
+    pTimer->m_iSequence = g_iTimerSequence++;
+    HeapSet(vecHeap, vecHeap.AddToTail(), pTimer);
+    HeapSiftUp(vecHeap, pTimer->m_iHeapIndex);
+}
+
+static CTimerBase *HeapPop(CUtlVector<CTimerBase*> &vecHeap)
+{
+    CTimerBase *pTimer = vecHeap[0];
+    CTimerBase *pLast = vecHeap.Tail();
+
+    vecHeap.RemoveMultipleFromTail(1);
+
+    if (pLast != pTimer)
+    {
+        HeapSet(vecHeap, 0, pLast);
+        HeapSiftDown(vecHeap, 0);
+    }
+
+    pTimer->m_iHeapIndex = -1;
+    return pTimer;
+}
+
+static void HeapRebuild(CUtlVector<CTimerBase*> &vecHeap)
+{
+    FOR_EACH_VEC(vecHeap, i)
+        vecHeap[i]->m_iHeapIndex = i;
+
+    for (int i = vecHeap.Count() / 2 - 1; i >= 0; i--)
+        HeapSiftDown(vecHeap, i);
+}
+
+static double GetTimerNextExecute(const CTimerBase *pTimer)
+{
+    if (!pTimer->m_bTickMode)
+        return g_flUniversalTime + pTimer->m_flInterval;
+
+    int iInterval = TimerSecondsToTicks(pTimer->m_flInterval);
+
+    if (iInterval <= 0)
+        return g_iTimerTick;
+
+    // Round up to the next multiple of the interval, so tick timers sharing an interval always come due on the same tick
+    return (double)(g_iTimerTick / iInterval + 1) * iInterval;
+}
+
+static void ScheduleTimer(CTimerBase *pTimer)
+{
+    pTimer->m_flLastExecute = g_flUniversalTime;
+    pTimer->m_flNextExecute = GetTimerNextExecute(pTimer);
+    HeapPush(GetTimerHeap(pTimer), pTimer);
+}
+
+struct TimerHandleSlot
+{
+    CTimerBase *pTimer;
+    uint32 iSerial;
+    int iNextFree;
+};
+
+// Handles index into this table rather than pointing at timers directly, so a stale handle
+// only ever sees a serial mismatch instead of a freed timer
+static CUtlVector<TimerHandleSlot> g_vecTimerHandleSlots;
+static int g_iFirstFreeHandleSlot = -1;
+static uint32 g_iTimerHandleSerial = 0;
+
+CTimerBase::CTimerBase(float flInitialInterval, bool bPreserveMapChange, bool bPreserveRoundChange, const char *pszName) :
+    m_flInterval(flInitialInterval), m_bPreserveMapChange(bPreserveMapChange), m_bPreserveRoundChange(bPreserveRoundChange), m_pszName(pszName)
+{
+    m_iRoundNum = g_iRoundNum;
+
+    // Serial 0 is reserved for empty handles
+    if (++g_iTimerHandleSerial == 0)
+        g_iTimerHandleSerial = 1;
+
+    int index = g_iFirstFreeHandleSlot;
+
+    if (index == -1)
+        index = g_vecTimerHandleSlots.AddToTail();
+    else
+        g_iFirstFreeHandleSlot = g_vecTimerHandleSlots[index].iNextFree;
+
+    g_vecTimerHandleSlots[index].pTimer = this;
+    g_vecTimerHandleSlots[index].iSerial = g_iTimerHandleSerial;
+
+    m_iHandleIndex = index;
+    m_iHandleSerial = g_iTimerHandleSerial;
+}
+
+CTimerBase::~CTimerBase()
+{
+    TimerHandleSlot &slot = g_vecTimerHandleSlots[m_iHandleIndex];
+
+    slot.pTimer = nullptr;
+    slot.iSerial = 0;
+    slot.iNextFree = g_iFirstFreeHandleSlot;
+    g_iFirstFreeHandleSlot = m_iHandleIndex;
+}
+
+CTimerHandle::CTimerHandle(CTimerBase *pTimer)
+{
+    m_iIndex = pTimer ? pTimer->m_iHandleIndex : 0;
+    m_iSerial = pTimer ? pTimer->m_iHandleSerial : 0;
+}
+
+CTimerBase *CTimerHandle::Get() const
+{
+    if (!m_iSerial || m_iIndex >= (uint32)g_vecTimerHandleSlots.Count())
+        return nullptr;
+
+    const TimerHandleSlot &slot = g_vecTimerHandleSlots[m_iIndex];
+
+    if (slot.iSerial != m_iSerial || slot.pTimer->m_bCancelled)
+        return nullptr;
+
+    return slot.pTimer;
+}
+
+void CTimerHandle::Cancel()
+{
+    CTimerBase *pTimer = Get();
+
+    // The scheduler frees cancelled timers the next time it comes across them
+    if (pTimer)
+        pTimer->m_bCancelled = true;
+}
+
+bool CTimerHandle::Reschedule(float flInterval)
+{
+    CTimerBase *pTimer = Get();
+
+    if (!pTimer)
+        return false;
+
+    pTimer->m_flInterval = flInterval;
+
+    // Not anchored yet, the new interval gets picked up on the next pass
+    if (pTimer->m_flNextExecute == -1)
+        return true;
+
+    double flOldNextExecute = pTimer->m_flNextExecute;
+    pTimer->m_flNextExecute = GetTimerNextExecute(pTimer);
+
+    // Timers outside the heap are waiting to run this pass, RunTimers() puts them back if they are no longer due
+    if (pTimer->m_iHeapIndex == -1)
+        return true;
+
+    if (pTimer->m_flNextExecute < flOldNextExecute)
+        HeapSiftUp(GetTimerHeap(pTimer), pTimer->m_iHeapIndex);
+    else
+        HeapSiftDown(GetTimerHeap(pTimer), pTimer->m_iHeapIndex);
+
+    return true;
+}
+
+static bool g_bTimerProfiling = false;
+
+FAKE_BOOL_CVAR(cs2f_timer_profiling, "Whether to record per-timer execution statistics, see cs2f_timer_stats", g_bTimerProfiling, false, false)
+
+#define TIMER_HISTOGRAM_BUCKETS 40
+
+struct TimerStats_t
+{
+    const char *pszName;
+    uint64 iCalls;
+    uint64 iTotalCycles;
+    uint64 iMaxCycles;
+
+    // Bucket i counts executions that took [2^i, 2^(i+1)) TSC cycles
+    uint64 rgHistogram[TIMER_HISTOGRAM_BUCKETS];
+};
+
+// Entries are never freed so timers can keep pointing at theirs, resetting only clears the counters
+static CUtlVector<TimerStats_t*> g_vecTimerStats;
+
+// TSC and wall time at the last reset, to convert cycles to time without assuming a TSC frequency
+static uint64 g_iTimerStatsStartCycles = 0;
+static double g_flTimerStatsStartTime = 0;
+
+static TimerStats_t *FindTimerStats(const char *pszName)
+{
+    FOR_EACH_VEC(g_vecTimerStats, i)
+    {
+        // Names are literals, but the same one can still have several addresses across translation units
+        if (g_vecTimerStats[i]->pszName == pszName || !V_strcmp(g_vecTimerStats[i]->pszName, pszName))
+            return g_vecTimerStats[i];
+    }
+
+    if (g_vecTimerStats.Count() == 0)
+    {
+        g_iTimerStatsStartCycles = __rdtsc();
+        g_flTimerStatsStartTime = Plat_FloatTime();
+    }
+
+    TimerStats_t *pStats = new TimerStats_t();
+    pStats->pszName = pszName;
+    g_vecTimerStats.AddToTail(pStats);
+
+    return pStats;
+}
+
+static bool ExecuteTimerProfiled(CTimerBase *pTimer)
+{
+    if (!pTimer->m_pStats)
+        pTimer->m_pStats = FindTimerStats(pTimer->m_pszName);
+
+    TimerStats_t *pStats = pTimer->m_pStats;
+
+    uint64 iStart = __rdtsc();
+    bool bResult = pTimer->Execute();
+    uint64 iCycles = __rdtsc() - iStart;
+
+    pStats->iCalls++;
+    pStats->iTotalCycles += iCycles;
+    pStats->iMaxCycles = std::max(pStats->iMaxCycles, iCycles);
+
+    int iBucket = 0;
+    while (iBucket < TIMER_HISTOGRAM_BUCKETS - 1 && (iCycles >> (iBucket + 1)))
+        iBucket++;
+
+    pStats->rgHistogram[iBucket]++;
+
+    return bResult;
+}
+
+CON_COMMAND_F(cs2f_timer_stats, "Print per-timer execution statistics, use \"cs2f_timer_stats reset\" to clear them", FCVAR_SPONLY | FCVAR_LINKED_CONCOMMAND)
+{
+    if (args.ArgC() > 1 && !V_stricmp(args[1], "reset"))
+    {
+        FOR_EACH_VEC(g_vecTimerStats, i)
+        {
+            const char *pszName = g_vecTimerStats[i]->pszName;
+            *g_vecTimerStats[i] = {};
+            g_vecTimerStats[i]->pszName = pszName;
+        }
+
+        g_iTimerStatsStartCycles = __rdtsc();
+        g_flTimerStatsStartTime = Plat_FloatTime();
+
+        Message("Timer statistics reset\n");
+        return;
+    }
+
+    if (!g_bTimerProfiling)
+        Message("Timer profiling is disabled, enable it with cs2f_timer_profiling 1\n");
+
+    double flElapsed = Plat_FloatTime() - g_flTimerStatsStartTime;
+
+    if (g_vecTimerStats.Count() == 0 || flElapsed <= 0)
+    {
+        Message("No timer statistics recorded yet\n");
+        return;
+    }
+
+    double flCyclesPerUs = (__rdtsc() - g_iTimerStatsStartCycles) / (flElapsed * 1000000.0);
+
+    std::vector<TimerStats_t*> vecSorted(g_vecTimerStats.Base(), g_vecTimerStats.Base() + g_vecTimerStats.Count());
+    std::sort(vecSorted.begin(), vecSorted.end(), [](TimerStats_t *a, TimerStats_t *b) { return a->iTotalCycles > b->iTotalCycles; });
+
+    Message("%-24s %10s %12s %10s %10s\n", "name", "calls", "total ms", "avg us", "max us");
+
+    for (TimerStats_t *pStats : vecSorted)
+    {
+        if (!pStats->iCalls)
+            continue;
+
+        Message("%-24s %10llu %12.3f %10.2f %10.2f\n", pStats->pszName, pStats->iCalls,
+            pStats->iTotalCycles / flCyclesPerUs / 1000.0,
+            pStats->iTotalCycles / flCyclesPerUs / pStats->iCalls,
+            pStats->iMaxCycles / flCyclesPerUs);
+    }
+
+    Message("Execution time histograms (us):\n");
+
+    for (TimerStats_t *pStats : vecSorted)
+    {
+        if (!pStats->iCalls)
+            continue;
+
+        char szLine[1024];
+        int iLength = V_snprintf(szLine, sizeof(szLine), "%-24s", pStats->pszName);
+
+        for (int j = 0; j < TIMER_HISTOGRAM_BUCKETS && iLength < (int)sizeof(szLine) - 1; j++)
+        {
+            if (pStats->rgHistogram[j])
+                iLength += V_snprintf(szLine + iLength, sizeof(szLine) - iLength, " <%.2f:%llu", (2ull << j) / flCyclesPerUs, pStats->rgHistogram[j]);
+        }
+
+        Message("%s\n", szLine);
+    }
+}
+
+void AddTimer(CTimerBase *pTimer)
+{
+    g_vecPendingTimers.AddToTail(pTimer);
+}
+
+static void RunDueTimers(CUtlVector<CTimerBase*> &vecHeap, double flNow)
+{
+    // Take every due timer off the heap before running any of them,
+    // otherwise a timer returning 0 would be run again within the same frame
+    static CUtlVector<CTimerBase*> vecDueTimers;
+
+    while (vecHeap.Count() && vecHeap[0]->m_flNextExecute <= flNow)
+        vecDueTimers.AddToTail(HeapPop(vecHeap));
+
+    FOR_EACH_VEC(vecDueTimers, i)
+    {
+        CTimerBase *pTimer = vecDueTimers[i];
+
+        if (pTimer->m_bCancelled)
+        {
+            delete pTimer;
+            continue;
+        }
+
+        // Rescheduled by an earlier timer in this pass
+        if (pTimer->m_flNextExecute > flNow)
+        {
+            HeapPush(vecHeap, pTimer);
+            continue;
+        }
+
+        if (!pTimer->m_bPreserveRoundChange && pTimer->m_iRoundNum != g_iRoundNum)
+        {
+            delete pTimer;
+            continue;
+        }
+
+        bool bContinue = g_bTimerProfiling ? ExecuteTimerProfiled(pTimer) : pTimer->Execute();
+
+        if (!bContinue || pTimer->m_bCancelled)
+        {
+            delete pTimer;
+            continue;
+        }
+
+        ScheduleTimer(pTimer);
+    }
+
+    vecDueTimers.RemoveAll();
+}
+
+void RunTimers(int iTick)
 {
-    for (int i = g_timers.Tail(); i != g_timers.InvalidIndex();)
+    // tickcount starts over with every map, tick timers surviving that have to be anchored again
+    if (iTick < g_iTimerTick)
     {
-        int prevIndex = i;
-        i = g_timers.Previous(i);
+        FOR_EACH_VEC(g_vecTickTimerHeap, i)
+        {
+            g_vecTickTimerHeap[i]->m_iHeapIndex = -1;
+            g_vecTickTimerHeap[i]->m_flNextExecute = -1;
+            g_vecPendingTimers.AddToTail(g_vecTickTimerHeap[i]);
+        }
 
-        if(g_timers[prevIndex]->m_bPreserveMapChange)
+        g_vecTickTimerHeap.RemoveAll();
+    }
+
+    g_iTimerTick = iTick;
+
+    FOR_EACH_VEC(g_vecPendingTimers, i)
+    {
+        CTimerBase *pTimer = g_vecPendingTimers[i];
+
+        if (pTimer->m_bCancelled)
+        {
+            delete pTimer;
             continue;
+        }
 
-        delete g_timers[prevIndex];
-        g_timers.Remove(prevIndex);
+        ScheduleTimer(pTimer);
     }
-}
\ No newline at end of file
+
+    g_vecPendingTimers.RemoveAll();
+
+    RunDueTimers(g_vecTimerHeap, g_flUniversalTime);
+    RunDueTimers(g_vecTickTimerHeap, g_iTimerTick);
+}
+
+void RemoveTimers()
+{
+    g_vecPendingTimers.PurgeAndDeleteElements();
+    g_vecTimerHeap.PurgeAndDeleteElements();
+    g_vecTickTimerHeap.PurgeAndDeleteElements();
+}
+
+static void RemoveMapTimersFrom(CUtlVector<CTimerBase*> &vecTimers)
+{
+    for (int i = vecTimers.Count() - 1; i >= 0; i--)
+    {
+        if (vecTimers[i]->m_bPreserveMapChange)
+            continue;
+
+        delete vecTimers[i];
+        vecTimers.Remove(i);
+    }
+}
+
+void RemoveMapTimers()
+{
+    RemoveMapTimersFrom(g_vecPendingTimers);
+    RemoveMapTimersFrom(g_vecTimerHeap);
+    RemoveMapTimersFrom(g_vecTickTimerHeap);
+    HeapRebuild(g_vecTimerHeap);
+    HeapRebuild(g_vecTickTimerHeap);
+}
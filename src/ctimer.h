@@ -18,18 +18,56 @@
  */
 
 #pragma once
-#include <functional>
-#include "utllinkedlist.h"
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "utlvector.h"
 
 extern int g_iRoundNum;
 
+// Only used until the engine's globals exist, after that the server's own tick interval is
+#define TIMER_DEFAULT_TICK_INTERVAL (1.0f / 64)
+
+float GetTimerTickInterval();
+
+// Rounds to the nearest tick, any positive duration is at least one tick
+int TimerSecondsToTicks(float flSeconds);
+float TimerTicksToSeconds(int iTicks);
+
+class CTimerBase;
+struct TimerStats_t;
+
+// Weak reference to a timer, becomes inactive once the timer stops, is cancelled or gets removed
+class CTimerHandle
+{
+public:
+    CTimerHandle() : m_iIndex(0), m_iSerial(0) {}
+    CTimerHandle(CTimerBase *pTimer);
+
+    CTimerBase *Get() const;
+    bool IsActive() const { return Get() != nullptr; }
+
+    // Stops the timer without running it again, it is safe to call this from inside any timer function
+    void Cancel();
+
+    // Runs the timer flInterval seconds from now instead of its current schedule
+    // Timer functions rescheduling themselves should just return the new interval instead
+    bool Reschedule(float flInterval);
+
+    bool operator==(const CTimerHandle &other) const { return m_iIndex == other.m_iIndex && m_iSerial == other.m_iSerial; }
+    bool operator!=(const CTimerHandle &other) const { return !(*this == other); }
+
+private:
+    uint32 m_iIndex;
+    uint32 m_iSerial;
+};
+
 class CTimerBase {
 public:
-    CTimerBase(float flInitialInterval, bool bPreserveMapChange, bool bPreserveRoundChange) :
-        m_flInterval(flInitialInterval), m_bPreserveMapChange(bPreserveMapChange), m_bPreserveRoundChange(bPreserveRoundChange)
-    {
-        m_iRoundNum = g_iRoundNum;
-    }
+    // pszName should be a string literal, it's used to group timers in cs2f_timer_stats
+    CTimerBase(float flInitialInterval, bool bPreserveMapChange, bool bPreserveRoundChange, const char *pszName = "unnamed");
+    virtual ~CTimerBase();
 
     virtual bool Execute() = 0;
 
@@ -38,19 +76,131 @@ public:
     bool m_bPreserveMapChange;
     bool m_bPreserveRoundChange;
     int m_iRoundNum;
+    const char *m_pszName;
+
+    // Resolved on the first profiled run
+    TimerStats_t *m_pStats = nullptr;
+
+    // Scheduled on server ticks instead of g_flUniversalTime, see CTickTimer
+    bool m_bTickMode = false;
+
+    // Scheduler bookkeeping, see ctimer.cpp, m_flNextExecute is a tick number for tick timers
+    double m_flNextExecute = -1;
+    int m_iHeapIndex = -1;
+    uint64 m_iSequence = 0;
+    bool m_bCancelled = false;
+    uint32 m_iHandleIndex;
+    uint32 m_iHandleSerial;
 };
 
-extern CUtlLinkedList<CTimerBase*> g_timers;
+// Fixed size allocator for timer objects, slabs are kept for the lifetime of the plugin
+// so freed slots get reused instead of going through malloc on the game thread
+class CTimerPool
+{
+public:
+    CTimerPool(const char *pszName, size_t nObjectSize, int nObjectsPerSlab = 256);
+    ~CTimerPool();
+
+    void *Alloc();
+    void Free(void *pMem);
+
+    const char *GetName() { return m_pszName; }
+    size_t GetObjectSize() { return m_nObjectSize; }
+    int GetSlabCount() { return m_vecSlabs.Count(); }
+    int GetCapacity() { return m_vecSlabs.Count() * m_nObjectsPerSlab; }
+    int GetLiveCount() { return m_iLive; }
+    int GetPeakCount() { return m_iPeak; }
+    uint64 GetAllocCount() { return m_iAllocs; }
+    uint64 GetFreeCount() { return m_iFrees; }
+
+    static CTimerPool *GetFirst() { return s_pFirst; }
+    CTimerPool *GetNext() { return m_pNext; }
+
+private:
+    struct FreeSlot
+    {
+        FreeSlot *pNext;
+    };
+
+    void AllocSlab();
+
+    const char *m_pszName;
+    size_t m_nObjectSize;
+    int m_nObjectsPerSlab;
+    CUtlVector<void*> m_vecSlabs;
+    FreeSlot *m_pFreeList = nullptr;
+    int m_iLive = 0;
+    int m_iPeak = 0;
+    uint64 m_iAllocs = 0;
+    uint64 m_iFrees = 0;
+
+    CTimerPool *m_pNext;
+    static CTimerPool *s_pFirst;
+};
+
+// Timer function storage, callables up to TIMER_FUNC_INLINE_SIZE bytes (so any lambda capturing a few handles)
+// are stored inside the timer itself, larger ones fall back to the heap
+#define TIMER_FUNC_INLINE_SIZE 64
+
+class CTimerFunc
+{
+public:
+    template <typename F>
+    CTimerFunc(F &&func)
+    {
+        using Fn = std::decay_t<F>;
+
+        if constexpr (sizeof(Fn) <= TIMER_FUNC_INLINE_SIZE && alignof(Fn) <= alignof(std::max_align_t))
+        {
+            m_pCallable = new (m_Storage) Fn(std::forward<F>(func));
+            m_pfnDestroy = [](void *pCallable) { static_cast<Fn*>(pCallable)->~Fn(); };
+        }
+        else
+        {
+            s_iHeapAllocations++;
+            m_pCallable = new Fn(std::forward<F>(func));
+            m_pfnDestroy = [](void *pCallable) { delete static_cast<Fn*>(pCallable); };
+        }
+
+        m_pfnInvoke = [](void *pCallable) -> float { return (*static_cast<Fn*>(pCallable))(); };
+    }
+
+    ~CTimerFunc() { m_pfnDestroy(m_pCallable); }
+
+    CTimerFunc(const CTimerFunc&) = delete;
+    CTimerFunc& operator=(const CTimerFunc&) = delete;
+
+    float operator()() { return m_pfnInvoke(m_pCallable); }
+
+    static inline uint64 s_iHeapAllocations = 0;
+
+private:
+    alignas(std::max_align_t) unsigned char m_Storage[TIMER_FUNC_INLINE_SIZE];
+    void *m_pCallable;
+    float (*m_pfnInvoke)(void *);
+    void (*m_pfnDestroy)(void *);
+};
+
+// Queues a timer to be scheduled on the next RunTimers() pass, the scheduler takes ownership
+void AddTimer(CTimerBase *pTimer);
 
 // Timer functions should return the time until next execution, or a negative value like -1.0f to stop
 // Having an interval of 0 is fine, in this case it will run on every game frame
 class CTimer : public CTimerBase
 {
 public:
-    CTimer(float flInitialInterval, bool bPreserveMapChange, bool bPreserveRoundChange, std::function<float()> func) :
-		CTimerBase(flInitialInterval, bPreserveMapChange, bPreserveRoundChange), m_func(func)
+    template <typename F>
+    CTimer(float flInitialInterval, bool bPreserveMapChange, bool bPreserveRoundChange, F &&func) :
+		CTimerBase(flInitialInterval, bPreserveMapChange, bPreserveRoundChange), m_func(std::forward<F>(func))
     {
-        g_timers.AddToTail(this);
+        AddTimer(this);
+    };
+
+    template <typename F>
+    CTimer(const char *pszName, float flInitialInterval, bool bPreserveMapChange, bool bPreserveRoundChange, F &&func) :
+		CTimerBase(flInitialInterval, bPreserveMapChange, bPreserveRoundChange, pszName), m_func(std::forward<F>(func))
+    {
+        AddTimer(this);
     };
 
     inline bool Execute() override
@@ -60,9 +210,33 @@ public:
         return m_flInterval >= 0;
 	}
 
-    std::function<float()> m_func;
+    // Timers are allocated from g_timerPool
+    static void *operator new(size_t nSize);
+    static void operator delete(void *pMem, size_t nSize);
+
+    // memdbgon.h redefines new as new(__FILE__, __LINE__) in some debug builds
+    static void *operator new(size_t nSize, const char *pszFile, int nLine) { return operator new(nSize); }
+
+    CTimerFunc m_func;
 };
 
+// Same as CTimer, but scheduled on whole server ticks from gpGlobals->tickcount so it doesn't drift with frame timing
+// Intervals are still in seconds and get rounded to ticks, tick timers sharing an interval are aligned to the same
+// ticks so they all run in one batch, which means the first run can come sooner than a full interval
+class CTickTimer : public CTimer
+{
+public:
+    template <typename F>
+    CTickTimer(const char *pszName, float flInitialInterval, bool bPreserveMapChange, bool bPreserveRoundChange, F &&func) :
+		CTimer(pszName, flInitialInterval, bPreserveMapChange, bPreserveRoundChange, std::forward<F>(func))
+    {
+        m_bTickMode = true;
+    };
+};
+
+extern CTimerPool g_timerPool;
+
 
+void RunTimers(int iTick);
 void RemoveTimers();
 void RemoveMapTimers();
\ No newline at end of file
@@ -409,6 +409,9 @@ FAKE_FLOAT_CVAR(cs2f_burn_slowdown, "The slowdown of each burn damage tick as a
 float g_flBurnInterval = 0.3f;
 FAKE_FLOAT_CVAR(cs2f_burn_interval, "The interval between burn damage ticks", g_flBurnInterval, 0.3f, false);
 
+// One burn timer per player, so a pawn reignited after something else removed its fire doesn't take double damage
+static CTimerHandle g_hBurnTimers[MAXPLAYERS];
+
 bool IgnitePawn(CCSPlayerPawn* pPawn, float flDuration, CBaseEntity* pInflictor, CBaseEntity* pAttacker, CBaseEntity* pAbility, DamageTypes_t nDamageType)
 {
     auto pParticleEnt = reinterpret_cast<CParticleSystem*>(pPawn->m_hEffectEntity().Get());
@@ -442,7 +445,8 @@ bool IgnitePawn(CCSPlayerPawn* pPawn, float flDuration, CBaseEntity* pInflictor,
     CHandle<CBaseEntity> hAttacker(pAttacker);
     CHandle<CBaseEntity> hAbility(pAbility);
 
-    new CTimer(0.f, false, false, [hPawn, hInflictor, hAttacker, hAbility, nDamageType]() {
+    CCSPlayerController* pController = pPawn->GetOriginalController();
+    CTimerHandle hBurnTimer = new CTickTimer("ignite", 0.f, false, false, [hPawn, hInflictor, hAttacker, hAbility, nDamageType]() {
         CCSPlayerPawn* pPawn = hPawn.Get();
 
         if (!pPawn)
@@ -481,5 +485,13 @@ bool IgnitePawn(CCSPlayerPawn* pPawn, float flDuration, CBaseEntity* pInflictor,
         return g_flBurnInterval;
     });
 
+    if (pController)
+    {
+        int iSlot = pController->GetPlayerSlot();
+
+        g_hBurnTimers[iSlot].Cancel();
+        g_hBurnTimers[iSlot] = hBurnTimer;
+    }
+
     return true;
 }
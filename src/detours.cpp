@@ -48,6 +48,7 @@
 #include "networksystem/inetworkserializer.h"
 #include "map_votes.h"
 #include "tier0/vprof.h"
+#include "triggertimer.h"
 
 #include "tier0/memdbgon.h"
 
@@ -239,71 +240,7 @@ void SayChatMessageWithTimer(IRecipientFilter &filter, const char *pText, CCSPla
 
 	char buf[256];
 
-	// Filter console message - remove non-alphanumeric chars and convert to lowercase
-	uint32 uiTextLength = strlen(pText);
-	uint32 uiFilteredTextLength = 0;
-	char filteredText[256];
-
-	for (uint32 i = 0; i < uiTextLength; i++)
-	{
-		if (pText[i] >= 'A' && pText[i] <= 'Z')
-			filteredText[uiFilteredTextLength++] = pText[i] + 32;
-		if (pText[i] == ' ' || (pText[i] >= '0' && pText[i] <= '9') || (pText[i] >= 'a' && pText[i] <= 'z'))
-			filteredText[uiFilteredTextLength++] = pText[i];
-	}
-	filteredText[uiFilteredTextLength] = '\0';
-
-	// Split console message into words seperated by the space character
-	CSplitString words(filteredText, " ");
-
-	//Word count includes the first word "Console:" at index 0, first relevant word is at index 1
-	int iWordCount = words.Count();
-	uint32 uiTriggerTimerLength = 0;
-
-	if (iWordCount == 2)
-		uiTriggerTimerLength = V_StringToUint32(words.Element(1), 0, NULL, NULL, PARSING_FLAG_SKIP_WARNING);
-
-	for (int i = 1; i < iWordCount && uiTriggerTimerLength == 0; i++)
-	{
-		uint32 uiCurrentValue = V_StringToUint32(words.Element(i), 0, NULL, NULL, PARSING_FLAG_SKIP_WARNING);
-		uint32 uiNextWordLength = 0;
-		char* pNextWord = NULL;
-
-		if (i + 1 < iWordCount)
-		{
-			pNextWord = words.Element(i + 1);
-			uiNextWordLength = strlen(pNextWord);
-		}
-
-		// Case: ... X sec(onds) ... or ... X min(utes) ...
-		if (pNextWord != NULL && uiNextWordLength > 2 && uiCurrentValue > 0)
-		{
-			if (pNextWord[0] == 's' && pNextWord[1] == 'e' && pNextWord[2] == 'c')
-				uiTriggerTimerLength = uiCurrentValue;
-			if (pNextWord[0] == 'm' && pNextWord[1] == 'i' && pNextWord[2] == 'n')
-				uiTriggerTimerLength = uiCurrentValue * 60;
-		}
-
-		// Case: ... Xs - only support up to 3 digit numbers (in seconds) for this timer parse method
-		if (uiCurrentValue == 0)
-		{
-			char* pCurrentWord = words.Element(i);
-			uint32 uiCurrentScanLength = MIN(strlen(pCurrentWord), 4);
-
-			for (uint32 j = 0; j < uiCurrentScanLength; j++)
-			{
-				if (pCurrentWord[j] >= '0' && pCurrentWord[j] <= '9')
-					continue;
-				
-				if (pCurrentWord[j] == 's')
-				{
-					pCurrentWord[j] = '\0';
-					uiTriggerTimerLength = V_StringToUint32(pCurrentWord, 0, NULL, NULL, PARSING_FLAG_SKIP_WARNING);
-				}
-				break;
-			}
-		}
-	}
+	uint32 uiTriggerTimerLength = GetTriggerTimerLength(pText);
 
 	float fCurrentRoundClock = g_pGameRules->m_iRoundTime - (gpGlobals->curtime - g_pGameRules->m_fRoundStartTime.Get().GetTime());
 
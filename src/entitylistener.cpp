@@ -24,6 +24,7 @@
 #include "cs2_sdk/entity/cbaseentity.h"
 #include "plat.h"
 #include "entity/cgamerules.h"
+#include "playersnapshot.h"
 
 extern CGameConfig *g_GameConfig;
 extern CCSGameRules* g_pGameRules;
@@ -64,6 +65,7 @@ void CEntityListener::OnEntityCreated(CEntityInstance* pEntity)
 
 void CEntityListener::OnEntityDeleted(CEntityInstance* pEntity)
 {
+	g_playerSnapshot.OnEntityDeleted(pEntity);
 }
 
 void CEntityListener::OnEntityParentChanged(CEntityInstance* pEntity, CEntityInstance* pNewParent)
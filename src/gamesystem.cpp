@@ -28,6 +28,7 @@
 #include "entities.h"
 #include "tier0/vprof.h"
 #include "idlemanager.h"
+#include "playersnapshot.h"
 
 #include "tier0/memdbgon.h"
 
@@ -89,6 +90,8 @@ GS_EVENT_MEMBER(CGameSystem, BuildGameSessionManifest)
 GS_EVENT_MEMBER(CGameSystem, ServerPreEntityThink)
 {
 	VPROF_BUDGET("CGameSystem::ServerPreEntityThink", "CS2FixesPerFrame")
+	g_playerSnapshot.Update();
+	g_playerManager->CheckHideDistances();
 	g_playerManager->FlashLightThink();
 	g_pIdleSystem->UpdateIdleTimes();
 	EntityHandler_OnGameFramePre(gpGlobals->m_bInSimulation, gpGlobals->tickcount);
@@ -98,5 +101,6 @@ GS_EVENT_MEMBER(CGameSystem, ServerPreEntityThink)
 GS_EVENT_MEMBER(CGameSystem, ServerPostEntityThink)
 {
 	VPROF_BUDGET("CGameSystem::ServerPostEntityThink", "CS2FixesPerFrame")
+	g_playerSnapshot.UpdatePawnStates();
 	g_playerManager->UpdatePlayerStates();
 }
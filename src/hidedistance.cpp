@@ -0,0 +1,134 @@
+/**
+ * =============================================================================
+ * CS2Fixes
+ * Copyright (C) 2023-2024 Source2ZE
+ * =============================================================================
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License, version 3.0, as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hidedistance.h"
+#include <bit>
+#include <immintrin.h>
+
+#ifdef _WIN32
+#include <intrin.h>
+#define TARGET_AVX2
+#define TARGET_SSE2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#endif
+
+#include "tier0/memdbgon.h"
+
+static_assert(MAXPLAYERS % 8 == 0, "Hide kernels process players in blocks of 8");
+
+TARGET_AVX2 static void ComputeHideMasksAVX2(const float *pX, const float *pY, const float *pZ, const float *pRangeSqr,
+	const uint64 *pTargetMasks, uint64 iViewerMask, uint64 *pHideMasks)
+{
+	for (uint64 iViewers = iViewerMask; iViewers; iViewers &= iViewers - 1)
+	{
+		int i = std::countr_zero(iViewers);
+
+		__m256 vx = _mm256_set1_ps(pX[i]);
+		__m256 vy = _mm256_set1_ps(pY[i]);
+		__m256 vz = _mm256_set1_ps(pZ[i]);
+		__m256 vRangeSqr = _mm256_set1_ps(pRangeSqr[i]);
+
+		uint64 iInRange = 0;
+
+		for (int j = 0; j < MAXPLAYERS; j += 8)
+		{
+			__m256 dx = _mm256_sub_ps(_mm256_loadu_ps(pX + j), vx);
+			__m256 dy = _mm256_sub_ps(_mm256_loadu_ps(pY + j), vy);
+			__m256 dz = _mm256_sub_ps(_mm256_loadu_ps(pZ + j), vz);
+
+			// Same operation order as Vector::DistToSqr so both agree right at the edge
+			__m256 vDistSqr = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+
+			iInRange |= (uint64)_mm256_movemask_ps(_mm256_cmp_ps(vDistSqr, vRangeSqr, _CMP_LE_OQ)) << j;
+		}
+
+		pHideMasks[i] = iInRange & pTargetMasks[i];
+	}
+}
+
+TARGET_SSE2 static void ComputeHideMasksSSE2(const float *pX, const float *pY, const float *pZ, const float *pRangeSqr,
+	const uint64 *pTargetMasks, uint64 iViewerMask, uint64 *pHideMasks)
+{
+	for (uint64 iViewers = iViewerMask; iViewers; iViewers &= iViewers - 1)
+	{
+		int i = std::countr_zero(iViewers);
+
+		__m128 vx = _mm_set1_ps(pX[i]);
+		__m128 vy = _mm_set1_ps(pY[i]);
+		__m128 vz = _mm_set1_ps(pZ[i]);
+		__m128 vRangeSqr = _mm_set1_ps(pRangeSqr[i]);
+
+		uint64 iInRange = 0;
+
+		for (int j = 0; j < MAXPLAYERS; j += 4)
+		{
+			__m128 dx = _mm_sub_ps(_mm_loadu_ps(pX + j), vx);
+			__m128 dy = _mm_sub_ps(_mm_loadu_ps(pY + j), vy);
+			__m128 dz = _mm_sub_ps(_mm_loadu_ps(pZ + j), vz);
+			__m128 vDistSqr = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+			iInRange |= (uint64)_mm_movemask_ps(_mm_cmple_ps(vDistSqr, vRangeSqr)) << j;
+		}
+
+		pHideMasks[i] = iInRange & pTargetMasks[i];
+	}
+}
+
+typedef void (*ComputeHideMasksFn)(const float *, const float *, const float *, const float *, const uint64 *, uint64, uint64 *);
+
+static bool CPUSupportsAVX2()
+{
+#ifdef _WIN32
+	int info[4];
+	__cpuid(info, 0);
+
+	if (info[0] < 7)
+		return false;
+
+	// The OS also has to save the upper halves of the ymm registers
+	__cpuid(info, 1);
+	if (!(info[2] & (1 << 27)) || !(info[2] & (1 << 28)) || (_xgetbv(0) & 6) != 6)
+		return false;
+
+	__cpuidex(info, 7, 0);
+	return info[1] & (1 << 5);
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+static ComputeHideMasksFn GetHideMasksImpl()
+{
+	static ComputeHideMasksFn pfnImpl = CPUSupportsAVX2() ? ComputeHideMasksAVX2 : ComputeHideMasksSSE2;
+	return pfnImpl;
+}
+
+void ComputeHideMasks(const float *pX, const float *pY, const float *pZ, const float *pRangeSqr,
+	const uint64 *pTargetMasks, uint64 iViewerMask, uint64 *pHideMasks)
+{
+	for (int i = 0; i < MAXPLAYERS; i++)
+	{
+		if (!(iViewerMask & ((uint64)1 << i)))
+			pHideMasks[i] = 0;
+	}
+
+	GetHideMasksImpl()(pX, pY, pZ, pRangeSqr, pTargetMasks, iViewerMask, pHideMasks);
+}
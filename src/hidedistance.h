@@ -0,0 +1,27 @@
+/**
+ * =============================================================================
+ * CS2Fixes
+ * Copyright (C) 2023-2024 Source2ZE
+ * =============================================================================
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License, version 3.0, as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "common.h"
+
+// For every viewer in iViewerMask, sets bit j of pHideMasks[viewer] if slot j is one of pTargetMasks[viewer]
+// and within sqrt(pRangeSqr[viewer]) units of the viewer. Viewers outside iViewerMask get an empty mask
+// Position arrays hold MAXPLAYERS entries, entries for slots outside the target masks are ignored
+void ComputeHideMasks(const float *pX, const float *pY, const float *pZ, const float *pRangeSqr,
+	const uint64 *pTargetMasks, uint64 iViewerMask, uint64 *pHideMasks);
@@ -19,6 +19,7 @@
 
 #include "idlemanager.h"
 #include "commands.h"
+#include "playersnapshot.h"
 #include <vprof.h>
 
 extern IVEngineServer2 *g_pEngineServer2;
@@ -97,24 +98,10 @@ void CIdleSystem::UpdateIdleTimes()
 	{
 		ZEPlayer* pPlayer = g_playerManager->GetPlayer(i);
 
-		if (!pPlayer)
+		if (!pPlayer || !(g_playerSnapshot.m_iPawnMask & SLOT_BIT(i)))
 			continue;
 
-		CBasePlayerController* pTarget = (CBasePlayerController*)g_pEntitySystem->GetEntityInstance((CEntityIndex)(pPlayer->GetPlayerSlot().Get() + 1));
-		if (!pTarget)
-			continue;
-
-		const auto pPawn = pTarget->m_hPawn();
-		if (!pPawn)
-			continue;
-
-		const auto pMovement = pPawn->m_pMovementServices();
-		uint64 iCurrentMovement = IN_NONE;
-		if (pMovement)
-		{
-			const auto buttonStates = pMovement->m_nButtons().m_pButtonStates();
-			iCurrentMovement = buttonStates[0];
-		}
+		uint64 iCurrentMovement = g_playerSnapshot.m_iButtons[0][i];
 		const auto buttonsChanged = pPlayer->GetLastInputs() ^ iCurrentMovement;
 
 		if (!buttonsChanged)
@@ -0,0 +1,277 @@
+/**
+ * =============================================================================
+ * CS2Fixes
+ * Copyright (C) 2023-2024 Source2ZE
+ * =============================================================================
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License, version 3.0, as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "infractionjournal.h"
+#include "common.h"
+#include "icvar.h"
+#include "tier0/platform.h"
+#include <cstdio>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <io.h>
+#define fsync _commit
+#define fileno _fileno
+#else
+#include <unistd.h>
+#endif
+
+#include "tier0/memdbgon.h"
+
+static int g_iInfractionJournalSize = 65536;
+FAKE_INT_CVAR(cs2f_infraction_journal_size, "How many bytes the infraction journal can grow to before it's folded into infractions.txt", g_iInfractionJournalSize, 65536, false)
+
+void CInfractionJournal::Start()
+{
+	if (m_thread.joinable())
+		return;
+
+	m_strJournalPath = std::string(Plat_GetGameDirectory()) + "/csgo/addons/cs2fixes/data/infractions.journal";
+	m_strSnapshotPath = std::string(Plat_GetGameDirectory()) + "/csgo/addons/cs2fixes/data/infractions.txt";
+
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(m_strJournalPath).parent_path(), error);
+
+	uint64 nSize = std::filesystem::file_size(m_strJournalPath, error);
+	m_nJournalBytes = error ? 0 : nSize;
+
+	m_bStopping = false;
+	m_thread = std::thread(&CInfractionJournal::WriterMain, this);
+}
+
+void CInfractionJournal::Stop()
+{
+	if (!m_thread.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStopping = true;
+	}
+
+	m_cvWork.notify_all();
+	m_thread.join();
+
+	if (m_pJournalFile)
+	{
+		fclose(m_pJournalFile);
+		m_pJournalFile = nullptr;
+	}
+}
+
+void CInfractionJournal::Flush()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	if (!m_thread.joinable())
+		return;
+
+	uint64 nTarget = m_nQueued;
+	m_cvDone.wait(lock, [&] { return m_nWritten >= nTarget; });
+}
+
+void CInfractionJournal::Queue(JournalJob_t &&job)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (!m_thread.joinable())
+		{
+			Warning("Infraction journal isn't running, a change was lost\n");
+			return;
+		}
+
+		m_vecQueue.push_back(std::move(job));
+		m_nQueued++;
+	}
+
+	m_cvWork.notify_one();
+}
+
+void CInfractionJournal::Append(EJournalOp nOp, const InfractionRecord_t &record)
+{
+	Queue({nOp, record, {}});
+}
+
+void CInfractionJournal::Compact(std::vector<InfractionRecord_t> &&vecInfractions)
+{
+	m_bCompactPending = true;
+	Queue({EJournalOp::COMPACT, {}, std::move(vecInfractions)});
+}
+
+bool CInfractionJournal::ShouldCompact()
+{
+	return !m_bCompactPending && (int64)m_nJournalBytes.load() >= g_iInfractionJournalSize;
+}
+
+void CInfractionJournal::WriterMain()
+{
+	std::vector<JournalJob_t> vecJobs;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cvWork.wait(lock, [&] { return m_bStopping || !m_vecQueue.empty(); });
+
+			// Only stop once everything has been written
+			if (m_vecQueue.empty())
+				return;
+
+			vecJobs.swap(m_vecQueue);
+		}
+
+		WriteJobs(vecJobs);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_nWritten += vecJobs.size();
+		}
+
+		vecJobs.clear();
+		m_cvDone.notify_all();
+	}
+}
+
+// Everything queued while the previous batch was being synced goes out with a single fsync
+void CInfractionJournal::WriteJobs(std::vector<JournalJob_t> &vecJobs)
+{
+	bool bDirty = false;
+
+	for (JournalJob_t &job : vecJobs)
+	{
+		if (job.nOp == EJournalOp::COMPACT)
+		{
+			// The snapshot holds everything journaled so far, so the journal only goes once it's safely replaced
+			if (WriteSnapshot(job.vecSnapshot))
+			{
+				if (m_pJournalFile)
+					fclose(m_pJournalFile);
+
+				m_pJournalFile = fopen(m_strJournalPath.c_str(), "wb");
+				m_nJournalBytes = 0;
+				bDirty = false;
+			}
+
+			m_bCompactPending = false;
+			continue;
+		}
+
+		if (!m_pJournalFile)
+			m_pJournalFile = fopen(m_strJournalPath.c_str(), "ab");
+
+		if (!m_pJournalFile)
+		{
+			Warning("Failed to open %s for writing\n", m_strJournalPath.c_str());
+			continue;
+		}
+
+		int nWritten = fprintf(m_pJournalFile, "%c %llu %llu %i\n", job.nOp == EJournalOp::ADD ? '+' : '-',
+							   job.record.iSteamID, (uint64)job.record.iEndTime, job.record.iType);
+
+		if (nWritten > 0)
+			m_nJournalBytes += nWritten;
+
+		bDirty = true;
+	}
+
+	if (bDirty && m_pJournalFile)
+	{
+		fflush(m_pJournalFile);
+		fsync(fileno(m_pJournalFile));
+	}
+}
+
+// Same layout KeyValues writes, so LoadInfractions and anyone editing the file by hand see no difference
+bool CInfractionJournal::WriteSnapshot(const std::vector<InfractionRecord_t> &vecInfractions)
+{
+	std::string strTempPath = m_strSnapshotPath + ".tmp";
+	FILE *pFile = fopen(strTempPath.c_str(), "wb");
+
+	if (!pFile)
+	{
+		Warning("Failed to save infractions to %s\n", strTempPath.c_str());
+		return false;
+	}
+
+	fprintf(pFile, "\"infractions\"\n{\n");
+
+	for (size_t i = 0; i < vecInfractions.size(); i++)
+	{
+		const InfractionRecord_t &record = vecInfractions[i];
+
+		fprintf(pFile, "\t\"%u\"\n\t{\n\t\t\"steamid\"\t\t\"%llu\"\n\t\t\"endtime\"\t\t\"%llu\"\n\t\t\"type\"\t\t\"%i\"\n\t}\n",
+				(uint32)i, record.iSteamID, (uint64)record.iEndTime, record.iType);
+	}
+
+	bool bSuccess = fprintf(pFile, "}\n") > 0;
+
+	bSuccess = fflush(pFile) == 0 && bSuccess;
+	fsync(fileno(pFile));
+	fclose(pFile);
+
+	std::error_code error;
+
+	if (bSuccess)
+		std::filesystem::rename(strTempPath, m_strSnapshotPath, error);
+
+	if (!bSuccess || error)
+	{
+		Warning("Failed to save infractions to %s\n", m_strSnapshotPath.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+bool CInfractionJournal::Read(std::vector<JournalEntry_t> &vecEntries)
+{
+	return ReadFile(m_strJournalPath.c_str(), vecEntries);
+}
+
+bool CInfractionJournal::ReadFile(const char *pszPath, std::vector<JournalEntry_t> &vecEntries)
+{
+	FILE *pFile = fopen(pszPath, "rb");
+
+	// No journal just means nothing changed since the last snapshot
+	if (!pFile)
+		return true;
+
+	char szLine[128];
+
+	while (fgets(szLine, sizeof(szLine), pFile))
+	{
+		char cOp;
+		uint64 iSteamID, iEndTime;
+		int iType, nLength;
+
+		// A crash can leave the last record half written, which is simply dropped
+		if (sscanf(szLine, "%c %llu %llu %i%n", &cOp, &iSteamID, &iEndTime, &iType, &nLength) != 4 || szLine[nLength] != '\n')
+			continue;
+
+		if (cOp != '+' && cOp != '-')
+			continue;
+
+		vecEntries.push_back({cOp == '+' ? EJournalOp::ADD : EJournalOp::REMOVE, {iSteamID, (time_t)iEndTime, iType}});
+	}
+
+	fclose(pFile);
+
+	return true;
+}
@@ -0,0 +1,115 @@
+/**
+ * =============================================================================
+ * CS2Fixes
+ * Copyright (C) 2023-2024 Source2ZE
+ * =============================================================================
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License, version 3.0, as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "platform.h"
+#include <atomic>
+#include <condition_variable>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct InfractionRecord_t
+{
+	uint64 iSteamID;
+	time_t iEndTime;
+	int iType;
+};
+
+enum class EJournalOp
+{
+	ADD,
+	REMOVE,
+	COMPACT,
+};
+
+struct JournalEntry_t
+{
+	EJournalOp nOp;
+	InfractionRecord_t record;
+};
+
+// Infraction changes get appended to data/infractions.journal by a writer thread instead of the whole of
+// data/infractions.txt being rewritten on the game thread, every batch of appends costs a single fsync
+// Once the journal passes cs2f_infraction_journal_size the writer replaces infractions.txt with a snapshot and empties it
+// Replaying a journal on top of a snapshot it was already folded into changes nothing, so a crash mid compaction is harmless
+class CInfractionJournal
+{
+public:
+	CInfractionJournal() {}
+	~CInfractionJournal() { Stop(); }
+
+	CInfractionJournal(const CInfractionJournal&) = delete;
+	CInfractionJournal& operator=(const CInfractionJournal&) = delete;
+
+	void Start();
+
+	// Writes out everything still queued first
+	void Stop();
+
+	// Blocks until everything queued so far is on disk
+	void Flush();
+
+	void Append(EJournalOp nOp, const InfractionRecord_t &record);
+
+	// The writer turns these into the new infractions.txt once everything queued before is written
+	void Compact(std::vector<InfractionRecord_t> &&vecInfractions);
+	bool ShouldCompact();
+
+	// Every complete record in the journal in order, only meant to be called after Flush()
+	bool Read(std::vector<JournalEntry_t> &vecEntries);
+
+	// Same as Read for any journal file, a missing file has no records
+	static bool ReadFile(const char *pszPath, std::vector<JournalEntry_t> &vecEntries);
+
+private:
+	struct JournalJob_t
+	{
+		EJournalOp nOp;
+		InfractionRecord_t record;
+		std::vector<InfractionRecord_t> vecSnapshot;
+	};
+
+	void Queue(JournalJob_t &&job);
+	void WriterMain();
+	void WriteJobs(std::vector<JournalJob_t> &vecJobs);
+	bool WriteSnapshot(const std::vector<InfractionRecord_t> &vecInfractions);
+
+	std::string m_strJournalPath;
+	std::string m_strSnapshotPath;
+
+	std::thread m_thread;
+	std::mutex m_mutex;
+	std::condition_variable m_cvWork;
+	std::condition_variable m_cvDone;
+
+	// Guarded by m_mutex
+	std::vector<JournalJob_t> m_vecQueue;
+	bool m_bStopping = false;
+	uint64 m_nQueued = 0;
+	uint64 m_nWritten = 0;
+
+	// Only touched by the writer thread once it's running
+	FILE *m_pJournalFile = nullptr;
+
+	std::atomic<uint64> m_nJournalBytes{0};
+	std::atomic<bool> m_bCompactPending{false};
+};
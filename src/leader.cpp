@@ -140,7 +140,7 @@ bool Leader_CreateDefendMarker(ZEPlayer *pPlayer, Color clrTint, int iDuration)
 
 	g_iMarkerCount++;
 
-	new CTimer(iDuration, false, false, []()
+	new CTimer("defend_marker", iDuration, false, false, []()
 	{
 		if (g_iMarkerCount > 0)
 			g_iMarkerCount--;
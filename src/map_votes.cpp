@@ -244,7 +244,7 @@ void CMapVoteSystem::OnLevelInit(const char* pMapName)
 	m_bIntermissionStarted = false;
 
 	// Delay one tick to override any .cfg's
-	new CTimer(0.02f, false, true, []()
+	new CTimer("map_vote_init", 0.02f, false, true, []()
 	{
 		g_pEngineServer2->ServerCommand("mp_match_end_changelevel 0");
 
@@ -325,7 +325,7 @@ void CMapVoteSystem::StartVote()
 	// Start the end-of-vote timer to finish the vote
 	ConVar* cvar = g_pCVar->GetConVar(g_pCVar->FindConVar("mp_endmatch_votenextleveltime"));
 	float flVoteTime = *(float *)&cvar->values;
-	new CTimer(flVoteTime, false, true, []() {
+	new CTimer("map_vote_end", flVoteTime, false, true, []() {
 		g_pMapVoteSystem->FinishVote();
 		return -1.0;
 	});
@@ -404,7 +404,7 @@ void CMapVoteSystem::FinishVote()
 		ClearPlayerInfo(i);
 
 	// Wait a second and force-change the map
-	new CTimer(1.0, false, true, [iWinningMap]() {
+	new CTimer("map_vote_change", 1.0, false, true, [iWinningMap]() {
 		char sChangeMapCmd[128];
 		uint64 workshopId = g_pMapVoteSystem->GetMapWorkshopId(iWinningMap);
 
@@ -666,7 +666,7 @@ bool CMapVoteSystem::LoadMapList()
 		m_vecMapList.AddToTail(CMapInfo(pszName, iWorkshopId, bIsEnabled));
 	}
 
-	new CTimer(0.f, true, true, []()
+	new CTimer("workshop_map_list", 0.f, true, true, []()
 	{
 		if (g_pMapVoteSystem->m_DownloadQueue.Count() == 0)
 			return -1.f;
@@ -0,0 +1,468 @@
+/**
+ * =============================================================================
+ * CS2Fixes
+ * Copyright (C) 2023-2024 Source2ZE
+ * =============================================================================
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License, version 3.0, as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "netmessagefilters.h"
+#include "playernameindex.h"
+#include "icvar.h"
+#include "gameevents.pb.h"
+#include "usermessages.pb.h"
+#include "cstrike15_usermessages.pb.h"
+#include "tier0/platform.h"
+#include <bit>
+#include <ctime>
+#include <fstream>
+#include <algorithm>
+#include <vector>
+
+#include "tier0/memdbgon.h"
+
+NetMessageFilter_t *g_rgpNetMessageFilters[MAX_FILTERED_NETMESSAGE_ID];
+
+// Only a handful of messages ever get filtered, so entries come from a small fixed pool instead of the heap
+#define MAX_FILTERED_NETMESSAGES 32
+
+static NetMessageFilter_t g_rgNetMessageFilterPool[MAX_FILTERED_NETMESSAGES];
+static int g_nNetMessageFilterPoolUsed = 0;
+
+static NetMessageFilter_t *GetOrCreateNetMessageFilter(int iMessageId)
+{
+	if (iMessageId < 0 || iMessageId >= MAX_FILTERED_NETMESSAGE_ID)
+	{
+		Warning("Net message %i is out of range for filtering\n", iMessageId);
+		return nullptr;
+	}
+
+	if (g_rgpNetMessageFilters[iMessageId])
+		return g_rgpNetMessageFilters[iMessageId];
+
+	if (g_nNetMessageFilterPoolUsed == MAX_FILTERED_NETMESSAGES)
+	{
+		Warning("Too many filtered net messages, can't add %i\n", iMessageId);
+		return nullptr;
+	}
+
+	NetMessageFilter_t *pFilter = &g_rgNetMessageFilterPool[g_nNetMessageFilterPoolUsed++];
+	pFilter->nFilters = 0;
+	pFilter->nOptOuts = 0;
+	pFilter->pThrottle = nullptr;
+	g_rgpNetMessageFilters[iMessageId] = pFilter;
+
+	return pFilter;
+}
+
+void RegisterNetMessageFilter(int iMessageId, NetMessageFilterFn pfnFilter)
+{
+	NetMessageFilter_t *pFilter = GetOrCreateNetMessageFilter(iMessageId);
+
+	if (!pFilter)
+		return;
+
+	if (pFilter->nFilters == MAX_NETMESSAGE_FILTERS)
+	{
+		Warning("Too many filters for net message %i\n", iMessageId);
+		return;
+	}
+
+	pFilter->rgpfnFilters[pFilter->nFilters++] = pfnFilter;
+}
+
+void RegisterNetMessageOptOut(int iMessageId, const char *pszName, NetMessageOptOutFn pfnGetMask, bool *pbEnabled)
+{
+	NetMessageFilter_t *pFilter = GetOrCreateNetMessageFilter(iMessageId);
+
+	if (!pFilter)
+		return;
+
+	if (pFilter->nOptOuts == MAX_NETMESSAGE_OPTOUTS)
+	{
+		Warning("Too many opt-outs for net message %i\n", iMessageId);
+		return;
+	}
+
+	NetMessageOptOut_t &optOut = pFilter->rgOptOuts[pFilter->nOptOuts++];
+	optOut.pszName = pszName;
+	optOut.pfnGetMask = pfnGetMask;
+	optOut.pbEnabled = pbEnabled;
+	optOut.iRemoved.store(0, std::memory_order_relaxed);
+}
+
+static bool g_bNetMessageThrottle = false;
+FAKE_BOOL_CVAR(cs2f_netmsg_throttle_enable, "Whether to drop cosmetic net messages to clients who are being sent more of them than their throttle allows", g_bNetMessageThrottle, false, false)
+
+// Gameplay relies on these arriving, or in the case of particles a dropped destroy leaves the effect stuck on the client
+static constexpr int g_rgiNeverThrottledNetMessages[] = {
+	GE_Source1LegacyGameEvent,
+	GE_FireBulletsId,
+	GE_SosStartSoundEvent,
+	UM_ParticleManager,
+	UM_Fade,
+	UM_HudMsg,
+	UM_SayText,
+	UM_SayText2,
+	UM_TextMsg,
+	CS_UM_SayText,
+	CS_UM_SayText2,
+	CS_UM_TextMsg,
+};
+
+static NetMessageThrottle_t g_rgNetMessageThrottlePool[MAX_THROTTLED_NETMESSAGES];
+static int g_nNetMessageThrottlePoolUsed = 0;
+
+static void ResetNetMessageThrottle(NetMessageThrottle_t &throttle, int iSlot)
+{
+	throttle.rgflTokens[iSlot] = throttle.flBurst;
+	throttle.rgflLastRefill[iSlot] = Plat_FloatTime();
+	throttle.rgiDropped[iSlot] = 0;
+}
+
+bool RegisterNetMessageThrottle(int iMessageId, float flRate, float flBurst)
+{
+	for (int iNeverThrottled : g_rgiNeverThrottledNetMessages)
+	{
+		if (iMessageId == iNeverThrottled)
+		{
+			Warning("Net message %i can't be throttled\n", iMessageId);
+			return false;
+		}
+	}
+
+	if (flRate <= 0.0f || flBurst < 1.0f)
+	{
+		Warning("Invalid throttle for net message %i, the rate must be above 0 and the burst at least 1\n", iMessageId);
+		return false;
+	}
+
+	NetMessageFilter_t *pFilter = GetOrCreateNetMessageFilter(iMessageId);
+
+	if (!pFilter)
+		return false;
+
+	NetMessageThrottle_t *pThrottle = pFilter->pThrottle;
+
+	if (!pThrottle)
+	{
+		if (g_nNetMessageThrottlePoolUsed == MAX_THROTTLED_NETMESSAGES)
+		{
+			Warning("Too many throttled net messages, can't add %i\n", iMessageId);
+			return false;
+		}
+
+		pThrottle = &g_rgNetMessageThrottlePool[g_nNetMessageThrottlePoolUsed++];
+		pThrottle->iMessageId = iMessageId;
+		pFilter->pThrottle = pThrottle;
+	}
+
+	pThrottle->flRate = flRate;
+	pThrottle->flBurst = flBurst;
+
+	for (int i = 0; i < MAXPLAYERS; i++)
+		ResetNetMessageThrottle(*pThrottle, i);
+
+	return true;
+}
+
+void ResetNetMessageThrottle(int iSlot)
+{
+	if (iSlot < 0 || iSlot >= MAXPLAYERS)
+		return;
+
+	for (int i = 0; i < g_nNetMessageThrottlePoolUsed; i++)
+		ResetNetMessageThrottle(g_rgNetMessageThrottlePool[i], iSlot);
+}
+
+void ClearNetMessageFilters()
+{
+	V_memset(g_rgpNetMessageFilters, 0, sizeof(g_rgpNetMessageFilters));
+	g_nNetMessageFilterPoolUsed = 0;
+	g_nNetMessageThrottlePoolUsed = 0;
+}
+
+// Returns the clients who are out of tokens, buckets are only refilled when something is sent to them
+static uint64 ApplyNetMessageThrottle(NetMessageThrottle_t &throttle, uint64 iClients)
+{
+	double flNow = Plat_FloatTime();
+	uint64 iDropped = 0;
+
+	for (uint64 m = iClients; m; m &= m - 1)
+	{
+		int i = std::countr_zero(m);
+
+		float flTokens = throttle.rgflTokens[i] + (float)(flNow - throttle.rgflLastRefill[i]) * throttle.flRate;
+		throttle.rgflLastRefill[i] = flNow;
+
+		if (flTokens > throttle.flBurst)
+			flTokens = throttle.flBurst;
+
+		if (flTokens >= 1.0f)
+		{
+			throttle.rgflTokens[i] = flTokens - 1.0f;
+			continue;
+		}
+
+		throttle.rgflTokens[i] = flTokens;
+		throttle.rgiDropped[i]++;
+		iDropped |= 1ull << i;
+	}
+
+	return iDropped;
+}
+
+void RunNetMessageFilter(NetMessageFilter_t *pFilter, NetMessageContext_t &context)
+{
+	for (int i = 0; i < pFilter->nFilters; i++)
+		pFilter->rgpfnFilters[i](context);
+
+	uint64 iClients = *context.pClients;
+
+	for (int i = 0; i < pFilter->nOptOuts; i++)
+	{
+		NetMessageOptOut_t &optOut = pFilter->rgOptOuts[i];
+
+		if (optOut.pbEnabled && !*optOut.pbEnabled)
+			continue;
+
+		uint64 iRemoved = iClients & optOut.pfnGetMask();
+
+		// Whoever was already removed by an earlier opt-out doesn't count towards this one
+		if (g_bNetMessageStats && iRemoved)
+			optOut.iRemoved.fetch_add(std::popcount(iRemoved), std::memory_order_relaxed);
+
+		iClients &= ~iRemoved;
+	}
+
+	if (pFilter->pThrottle && g_bNetMessageThrottle)
+		iClients &= ~ApplyNetMessageThrottle(*pFilter->pThrottle, iClients);
+
+	*context.pClients = iClients;
+}
+
+CON_COMMAND_F(cs2f_netmsg_throttle, "Set the throttle of a cosmetic net message, usage: cs2f_netmsg_throttle <message id> <tokens per second> <burst>", FCVAR_SPONLY | FCVAR_LINKED_CONCOMMAND)
+{
+	if (args.ArgC() < 4)
+	{
+		Message("Usage: cs2f_netmsg_throttle <message id> <tokens per second> <burst>\n");
+
+		for (int i = 0; i < g_nNetMessageThrottlePoolUsed; i++)
+		{
+			NetMessageThrottle_t &throttle = g_rgNetMessageThrottlePool[i];
+			Message("  %i: %.1f per second, burst of %.0f\n", throttle.iMessageId, throttle.flRate, throttle.flBurst);
+		}
+
+		return;
+	}
+
+	int iMessageId = V_StringToInt32(args[1], -1);
+
+	if (RegisterNetMessageThrottle(iMessageId, V_StringToFloat32(args[2], 0.0f), V_StringToFloat32(args[3], 0.0f)))
+		Message("Net message %i is now throttled to %s per second with a burst of %s\n", iMessageId, args[2], args[3]);
+}
+
+CON_COMMAND_F(cs2f_netmsg_throttle_stats, "Print how many throttled net messages were dropped for each client", FCVAR_SPONLY | FCVAR_LINKED_CONCOMMAND)
+{
+	if (!g_bNetMessageThrottle)
+		Message("cs2f_netmsg_throttle_enable is off, nothing is being dropped\n");
+
+	Message("%-4s %-32s %10s  %s\n", "Slot", "Name", "Dropped", "By message");
+
+	for (int i = 0; i < MAXPLAYERS; i++)
+	{
+		uint64 iTotal = 0;
+
+		for (int j = 0; j < g_nNetMessageThrottlePoolUsed; j++)
+			iTotal += g_rgNetMessageThrottlePool[j].rgiDropped[i];
+
+		if (!iTotal)
+			continue;
+
+		char szByMessage[256] = "";
+
+		for (int j = 0; j < g_nNetMessageThrottlePoolUsed; j++)
+		{
+			NetMessageThrottle_t &throttle = g_rgNetMessageThrottlePool[j];
+
+			if (throttle.rgiDropped[i])
+				V_snprintf(szByMessage + V_strlen(szByMessage), sizeof(szByMessage) - V_strlen(szByMessage), "%s%i=%llu", szByMessage[0] ? " " : "", throttle.iMessageId, throttle.rgiDropped[i]);
+		}
+
+		Message("%-4i %-32s %10llu  %s\n", i, g_playerNameIndex.GetName(i), iTotal, szByMessage);
+	}
+}
+
+bool g_bNetMessageStats = false;
+FAKE_BOOL_CVAR(cs2f_netmsg_stats_enable, "Whether to count posts, bytes and recipients of every outgoing net message for cs2f_netmsg_stats", g_bNetMessageStats, false, false)
+
+static int g_iNetMessageStatsDumpInterval = 0;
+FAKE_INT_CVAR(cs2f_netmsg_stats_dump_interval, "How often in seconds to append net message stats to addons/cs2fixes/data/netmsg_stats.csv, 0 to disable", g_iNetMessageStatsDumpInterval, 0, false)
+
+// Bytes are counted once per post, sent bytes once per recipient since that's what actually goes out over the wire
+struct NetMessageStats_t
+{
+	std::atomic<INetworkMessageInternal *> pEvent;
+	std::atomic<uint64> iPosts;
+	std::atomic<uint64> iBytes;
+	std::atomic<uint64> iRecipientsBefore;
+	std::atomic<uint64> iRecipientsAfter;
+	std::atomic<uint64> iSentBytesBefore;
+	std::atomic<uint64> iSentBytesAfter;
+};
+
+static NetMessageStats_t g_rgNetMessageStats[MAX_FILTERED_NETMESSAGE_ID];
+
+void RecordNetMessageStats(int iMessageId, INetworkMessageInternal *pEvent, unsigned long nSize, uint64 iRecipientsBefore, uint64 iRecipientsAfter)
+{
+	if ((unsigned int)iMessageId >= MAX_FILTERED_NETMESSAGE_ID)
+		return;
+
+	NetMessageStats_t &stats = g_rgNetMessageStats[iMessageId];
+	uint64 nBefore = std::popcount(iRecipientsBefore);
+	uint64 nAfter = std::popcount(iRecipientsAfter);
+
+	stats.pEvent.store(pEvent, std::memory_order_relaxed);
+	stats.iPosts.fetch_add(1, std::memory_order_relaxed);
+	stats.iBytes.fetch_add(nSize, std::memory_order_relaxed);
+	stats.iRecipientsBefore.fetch_add(nBefore, std::memory_order_relaxed);
+	stats.iRecipientsAfter.fetch_add(nAfter, std::memory_order_relaxed);
+	stats.iSentBytesBefore.fetch_add(nSize * nBefore, std::memory_order_relaxed);
+	stats.iSentBytesAfter.fetch_add(nSize * nAfter, std::memory_order_relaxed);
+}
+
+static const char *GetNetMessageStatsName(NetMessageStats_t &stats)
+{
+	INetworkMessageInternal *pEvent = stats.pEvent.load(std::memory_order_relaxed);
+	return pEvent ? pEvent->GetUnscopedName() : "unknown";
+}
+
+static void ResetNetMessageStats()
+{
+	for (NetMessageStats_t &stats : g_rgNetMessageStats)
+	{
+		stats.iPosts.store(0, std::memory_order_relaxed);
+		stats.iBytes.store(0, std::memory_order_relaxed);
+		stats.iRecipientsBefore.store(0, std::memory_order_relaxed);
+		stats.iRecipientsAfter.store(0, std::memory_order_relaxed);
+		stats.iSentBytesBefore.store(0, std::memory_order_relaxed);
+		stats.iSentBytesAfter.store(0, std::memory_order_relaxed);
+	}
+
+	for (int i = 0; i < g_nNetMessageFilterPoolUsed; i++)
+	{
+		for (int j = 0; j < g_rgNetMessageFilterPool[i].nOptOuts; j++)
+			g_rgNetMessageFilterPool[i].rgOptOuts[j].iRemoved.store(0, std::memory_order_relaxed);
+	}
+}
+
+// Every message posted at least once, most bytes sent first
+static std::vector<int> GetPostedNetMessages()
+{
+	std::vector<int> vecIds;
+
+	for (int i = 0; i < MAX_FILTERED_NETMESSAGE_ID; i++)
+	{
+		if (g_rgNetMessageStats[i].iPosts.load(std::memory_order_relaxed))
+			vecIds.push_back(i);
+	}
+
+	std::sort(vecIds.begin(), vecIds.end(), [](int a, int b) {
+		return g_rgNetMessageStats[a].iSentBytesBefore.load(std::memory_order_relaxed) > g_rgNetMessageStats[b].iSentBytesBefore.load(std::memory_order_relaxed);
+	});
+
+	return vecIds;
+}
+
+CON_COMMAND_F(cs2f_netmsg_stats, "Print outgoing net message stats, use \"cs2f_netmsg_stats reset\" to clear them", FCVAR_SPONLY | FCVAR_LINKED_CONCOMMAND)
+{
+	if (args.ArgC() > 1 && !V_stricmp(args[1], "reset"))
+	{
+		ResetNetMessageStats();
+		Message("Net message stats reset\n");
+		return;
+	}
+
+	if (!g_bNetMessageStats)
+		Message("cs2f_netmsg_stats_enable is off, these won't be updating\n");
+
+	Message("%-6s %-32s %10s %12s %10s %10s %14s %14s\n", "ID", "Message", "Posts", "Bytes", "Recv in", "Recv out", "Sent bytes in", "Sent bytes out");
+
+	for (int iMessageId : GetPostedNetMessages())
+	{
+		NetMessageStats_t &stats = g_rgNetMessageStats[iMessageId];
+
+		Message("%-6i %-32s %10llu %12llu %10llu %10llu %14llu %14llu\n", iMessageId, GetNetMessageStatsName(stats),
+				stats.iPosts.load(std::memory_order_relaxed), stats.iBytes.load(std::memory_order_relaxed),
+				stats.iRecipientsBefore.load(std::memory_order_relaxed), stats.iRecipientsAfter.load(std::memory_order_relaxed),
+				stats.iSentBytesBefore.load(std::memory_order_relaxed), stats.iSentBytesAfter.load(std::memory_order_relaxed));
+
+		NetMessageFilter_t *pFilter = GetNetMessageFilter(iMessageId);
+
+		for (int i = 0; pFilter && i < pFilter->nOptOuts; i++)
+			Message("       removed by %s: %llu\n", pFilter->rgOptOuts[i].pszName, pFilter->rgOptOuts[i].iRemoved.load(std::memory_order_relaxed));
+	}
+}
+
+static void DumpNetMessageStats()
+{
+	char szPath[MAX_PATH];
+	V_snprintf(szPath, sizeof(szPath), "%s%s", Plat_GetGameDirectory(), "/csgo/addons/cs2fixes/data/netmsg_stats.csv");
+
+	std::ifstream existingFile(szPath);
+	bool bNewFile = !existingFile.good() || existingFile.peek() == std::ifstream::traits_type::eof();
+	existingFile.close();
+
+	std::ofstream csvFile(szPath, std::ios::app);
+
+	if (!csvFile.is_open())
+	{
+		Warning("Failed to open %s for writing\n", szPath);
+		return;
+	}
+
+	if (bNewFile)
+		csvFile << "time,message_id,message,posts,bytes,recipients_before,recipients_after,sent_bytes_before,sent_bytes_after,removed_by\n";
+
+	std::time_t iTime = std::time(0);
+
+	// Totals are cumulative since the last reset, diffing consecutive dumps gives rates
+	for (int iMessageId : GetPostedNetMessages())
+	{
+		NetMessageStats_t &stats = g_rgNetMessageStats[iMessageId];
+
+		csvFile << iTime << ',' << iMessageId << ',' << GetNetMessageStatsName(stats) << ','
+				<< stats.iPosts.load(std::memory_order_relaxed) << ',' << stats.iBytes.load(std::memory_order_relaxed) << ','
+				<< stats.iRecipientsBefore.load(std::memory_order_relaxed) << ',' << stats.iRecipientsAfter.load(std::memory_order_relaxed) << ','
+				<< stats.iSentBytesBefore.load(std::memory_order_relaxed) << ',' << stats.iSentBytesAfter.load(std::memory_order_relaxed) << ',';
+
+		NetMessageFilter_t *pFilter = GetNetMessageFilter(iMessageId);
+
+		for (int i = 0; pFilter && i < pFilter->nOptOuts; i++)
+			csvFile << (i ? ";" : "") << pFilter->rgOptOuts[i].pszName << '=' << pFilter->rgOptOuts[i].iRemoved.load(std::memory_order_relaxed);
+
+		csvFile << '\n';
+	}
+}
+
+float NetMessageStatsDumpThink()
+{
+	// Check back every few seconds while disabled so turning it on doesn't take a map change
+	if (!g_bNetMessageStats || g_iNetMessageStatsDumpInterval <= 0)
+		return 5.0f;
+
+	DumpNetMessageStats();
+
+	return (float)g_iNetMessageStatsDumpInterval;
+}
@@ -0,0 +1,105 @@
+/**
+ * =============================================================================
+ * CS2Fixes
+ * Copyright (C) 2023-2024 Source2ZE
+ * =============================================================================
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License, version 3.0, as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "common.h"
+#include <atomic>
+#include "networksystem/inetworkserializer.h"
+#include "engine/igameeventsystem.h"
+
+// Net message IDs are protobuf enum values, which all sit well under this
+#define MAX_FILTERED_NETMESSAGE_ID	1024
+#define MAX_NETMESSAGE_FILTERS		4
+#define MAX_NETMESSAGE_OPTOUTS		4
+#define MAX_THROTTLED_NETMESSAGES	16
+
+// Everything PostEventAbstract was called with, filters can edit the message in place and narrow down *pClients
+struct NetMessageContext_t
+{
+	CSplitScreenSlot nSlot;
+	bool bLocalOnly;
+	int nClientCount;
+	uint64 *pClients;
+	INetworkMessageInternal *pEvent;
+	const CNetMessage *pData;
+	unsigned long nSize;
+	NetChannelBufType_t bufType;
+};
+
+typedef void (*NetMessageFilterFn)(NetMessageContext_t &context);
+typedef uint64 (*NetMessageOptOutFn)();
+
+struct NetMessageOptOut_t
+{
+	const char *pszName;
+	NetMessageOptOutFn pfnGetMask;	// Players who shouldn't receive the message
+	bool *pbEnabled;				// Optional feature toggle, the opt-out is skipped while it's false
+	std::atomic<uint64> iRemoved;	// Recipients this opt-out took away, only counted with cs2f_netmsg_stats_enable
+};
+
+// A token bucket per client, every message sent to a client takes a token and it's dropped for them if there's none left
+struct NetMessageThrottle_t
+{
+	int iMessageId;
+	float flRate;		// Tokens regained per second
+	float flBurst;		// Bucket size, how many can go out back to back
+	float rgflTokens[MAXPLAYERS];
+	double rgflLastRefill[MAXPLAYERS];
+	uint64 rgiDropped[MAXPLAYERS];
+};
+
+// Filters run in the order they were registered, then every opt-out mask is removed from the recipients
+struct NetMessageFilter_t
+{
+	NetMessageFilterFn rgpfnFilters[MAX_NETMESSAGE_FILTERS];
+	int nFilters;
+	NetMessageOptOut_t rgOptOuts[MAX_NETMESSAGE_OPTOUTS];
+	int nOptOuts;
+	NetMessageThrottle_t *pThrottle;	// Applied last to whoever is left, nullptr if the message isn't throttled
+};
+
+void RegisterNetMessageFilter(int iMessageId, NetMessageFilterFn pfnFilter);
+void RegisterNetMessageOptOut(int iMessageId, const char *pszName, NetMessageOptOutFn pfnGetMask, bool *pbEnabled = nullptr);
+// Only meant for cosmetic messages, anything on the never throttle list in netmessagefilters.cpp is refused
+bool RegisterNetMessageThrottle(int iMessageId, float flRate, float flBurst);
+void ClearNetMessageFilters();
+
+// Refills a slot's buckets and clears its drop counters, so whoever gets the slot next starts fresh
+void ResetNetMessageThrottle(int iSlot);
+
+extern NetMessageFilter_t *g_rgpNetMessageFilters[MAX_FILTERED_NETMESSAGE_ID];
+
+// nullptr for every message nothing is registered for, which is the vast majority of them
+inline NetMessageFilter_t *GetNetMessageFilter(int iMessageId)
+{
+	if ((unsigned int)iMessageId >= MAX_FILTERED_NETMESSAGE_ID)
+		return nullptr;
+
+	return g_rgpNetMessageFilters[iMessageId];
+}
+
+void RunNetMessageFilter(NetMessageFilter_t *pFilter, NetMessageContext_t &context);
+
+extern bool g_bNetMessageStats;
+
+// Counts one post of a message, iRecipientsBefore is the recipient mask before any filtering
+void RecordNetMessageStats(int iMessageId, INetworkMessageInternal *pEvent, unsigned long nSize, uint64 iRecipientsBefore, uint64 iRecipientsAfter);
+
+// Appends the current totals to the stats CSV when it's time to, returns the delay until it should be called again
+float NetMessageStatsDumpThink();
@@ -207,7 +207,7 @@ bool CPanoramaVoteHandler::SendYesNoVote(float flDuration, int iCaller, const ch
 	}
 	
 	int voteNum = m_iVoteCount;
-	new CTimer(flDuration, false, true, [voteNum]() 
+	new CTimer("panorama_vote_end", flDuration, false, true, [voteNum]() 
 		{
 			// Ensure we dont end the wrong vote
 			if(voteNum == g_pPanoramaVoteHandler->m_iVoteCount)
@@ -278,7 +278,7 @@ void CPanoramaVoteHandler::CheckForEarlyVoteClose()
 	if (votes >= m_iVoterCount)
 	{
 		// Do this next frame to prevent a crash
-		new CTimer(0.0, false, true, []() 
+		new CTimer("panorama_vote_end", 0.0, false, true, []() 
 			{
 				g_pPanoramaVoteHandler->EndVote(YesNoVoteEndReason::VoteEnd_AllVotes);
 				return -1.0;
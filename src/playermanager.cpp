@@ -32,6 +32,11 @@
 #include "ctimer.h"
 #include "ctime"
 #include "leader.h"
+#include "playersnapshot.h"
+#include "hidedistance.h"
+#include "targetselector.h"
+#include "playernameindex.h"
+#include "bandatabase.h"
 #include "tier0/vprof.h"
 #include "networksystem/inetworkmessages.h"
 
@@ -95,6 +100,15 @@ ZEPlayer *ZEPlayerHandle::Get() const
 	return pZEPlayer;
 }
 
+void ZEPlayer::SetIpAddress(const char *pszNetworkID)
+{
+	V_strncpy(m_szIp, pszNetworkID, sizeof(m_szIp));
+
+	// Remove port
+	if (char *pszPort = strchr(m_szIp, ':'))
+		*pszPort = '\0';
+}
+
 void ZEPlayer::OnSpawn()
 {
 	SetSpeedMod(1.f);
@@ -102,8 +116,8 @@ void ZEPlayer::OnSpawn()
 
 void ZEPlayer::OnAuthenticated()
 {
-	m_bAuthenticated = true;
-	m_SteamID = m_UnauthenticatedSteamID;
+	m_pHot->m_bAuthenticated = true;
+	m_SteamID = &m_UnauthenticatedSteamID;
 
 	Message("%lli authenticated\n", GetSteamId64());
 
@@ -141,13 +155,10 @@ bool ZEPlayer::IsAdminFlagSet(uint64 iFlag)
 	return !iFlag || (m_iAdminFlags & iFlag);
 }
 
-int ZEPlayer::GetHideDistance()
-{
-	return g_pUserPreferencesSystem->GetPreferenceInt(m_slot.Get(), HIDE_DISTANCE_PREF_KEY_NAME, 0);
-}
-
 void ZEPlayer::SetHideDistance(int distance)
 {
+	// Cached since hide distances are checked every tick
+	m_pHot->m_iHideDistance = distance;
 	g_pUserPreferencesSystem->SetPreferenceInt(m_slot.Get(), HIDE_DISTANCE_PREF_KEY_NAME, distance);
 }
 
@@ -292,6 +303,7 @@ void ZEPlayer::StartBeacon(Color color, ZEPlayerHandle hGiver/* = 0*/)
 	particle->SetParent(pPlayer->GetPawn());
 
 	m_hBeaconParticle.Set(particle);
+	m_hBeaconTimer.Cancel();
 
 	CHandle<CParticleSystem> hParticle = particle->GetHandle();
 	ZEPlayerHandle hPlayer = m_Handle;
@@ -302,11 +314,12 @@ void ZEPlayer::StartBeacon(Color color, ZEPlayerHandle hGiver/* = 0*/)
 	if (pGiver && pGiver->IsLeader())
 		bLeaderBeacon = true;
 
-	new CTimer(1.0f, false, false, [hPlayer, hParticle, hGiver, iTeamNum, bLeaderBeacon]()
+	// Cancelled by EndBeacon or when the player disconnects
+	m_hBeaconTimer = new CTimer("beacon", 1.0f, false, false, [hPlayer, hParticle, hGiver, iTeamNum, bLeaderBeacon]()
 	{
 		CParticleSystem *pParticle = hParticle.Get();
 
-		if (!hPlayer.IsValid() || !pParticle)
+		if (!pParticle)
 			return -1.0f;
 
 		CCSPlayerController *pPlayer = CCSPlayerController::FromSlot((CPlayerSlot) hPlayer.GetPlayerSlot());
@@ -339,6 +352,8 @@ void ZEPlayer::StartBeacon(Color color, ZEPlayerHandle hGiver/* = 0*/)
 
 void ZEPlayer::EndBeacon()
 {
+	m_hBeaconTimer.Cancel();
+
 	CParticleSystem *pParticle = m_hBeaconParticle.Get();
 
 	if (pParticle)
@@ -349,11 +364,11 @@ void ZEPlayer::SetLeader(int leaderIndex)
 {
 	if (leaderIndex >= g_nLeaderColorMapSize)
 	{
-		m_iLeaderIndex = g_iLeaderIndex = 1;
+		m_pHot->m_iLeaderIndex = g_iLeaderIndex = 1;
 		return;
 	}
 
-	m_iLeaderIndex = leaderIndex;
+	m_pHot->m_iLeaderIndex = leaderIndex;
 }
 
 int ZEPlayer::GetLeaderVoteCount()
@@ -421,14 +436,17 @@ void ZEPlayer::StartGlow(Color color, int duration)
 	pModelRelay->AcceptInput("FollowEntity", "!activator", pPawn);
 	pModelGlow->AcceptInput("FollowEntity", "!activator", pModelRelay);
 
-	m_hGlowModel.Set(pModelGlow);
+	m_pHot->m_hGlowModel.Set(pModelGlow);
 	
-	CHandle<CBaseModelEntity> hGlowModel = m_hGlowModel;
+	CHandle<CBaseModelEntity> hGlowModel = m_pHot->m_hGlowModel;
 	CHandle<CCSPlayerPawn> hPawn = pPawn->GetHandle();
 	int iTeamNum = hPawn->m_iTeamNum();
 
+	m_hGlowTimer.Cancel();
+	m_hGlowDurationTimer.Cancel();
+
 	// check if player's team or model changed
-	new CTimer(0.5f, false, false, [hGlowModel, hPawn, iTeamNum]()
+	m_hGlowTimer = new CTimer("glow", 0.5f, false, false, [hGlowModel, hPawn, iTeamNum]()
 	{
 		CBaseModelEntity *pModel = hGlowModel.Get();
 		CCSPlayerPawn *pawn = hPawn.Get();
@@ -458,7 +476,7 @@ void ZEPlayer::StartGlow(Color color, int duration)
 	if (duration < 1)
 		return;
 	
-	new CTimer((float)duration, false, false, [hGlowModel]()
+	m_hGlowDurationTimer = new CTimer("glow_duration", (float)duration, false, false, [hGlowModel]()
 	{
 		CBaseModelEntity *pModel = hGlowModel.Get();
 
@@ -481,7 +499,10 @@ void ZEPlayer::StartGlow(Color color, int duration)
 
 void ZEPlayer::EndGlow()
 {
-	CBaseModelEntity *pGlowModel = m_hGlowModel.Get();
+	m_hGlowTimer.Cancel();
+	m_hGlowDurationTimer.Cancel();
+
+	CBaseModelEntity *pGlowModel = m_pHot->m_hGlowModel.Get();
 
 	if (!pGlowModel)
 		return;
@@ -512,7 +533,7 @@ void ZEPlayer::ReplicateConVar(const char* pszName, const char* pszValue)
 
 void CPlayerManager::OnBotConnected(CPlayerSlot slot)
 {
-	m_vecPlayers[slot.Get()] = new ZEPlayer(slot, true);
+	m_vecPlayers[slot.Get()] = CreatePlayer(slot, true);
 }
 
 bool CPlayerManager::OnClientConnected(CPlayerSlot slot, uint64 xuid, const char* pszNetworkID)
@@ -521,27 +542,22 @@ bool CPlayerManager::OnClientConnected(CPlayerSlot slot, uint64 xuid, const char
 
 	Message("%d connected\n", slot.Get());
 
-	ZEPlayer *pPlayer = new ZEPlayer(slot);
-	pPlayer->SetUnauthenticatedSteamId(new CSteamID(xuid));
-
-	std::string ip(pszNetworkID);
+	ZEPlayer *pPlayer = CreatePlayer(slot, false);
+	pPlayer->SetUnauthenticatedSteamId(xuid);
+	pPlayer->SetIpAddress(pszNetworkID);
 
-	// Remove port
-	for (int i = 0; i < ip.length(); i++)
+	// Nearly everyone connecting is turned away by the bloom filter alone, only a hit searches the list
+	if (g_banDatabase.IsBanned(xuid, pPlayer->GetIpAddress()))
 	{
-		if (ip[i] == ':')
-		{
-			ip = ip.substr(0, i);
-			break;
-		}
+		Message("%d is in the ban database\n", slot.Get());
+		DestroyPlayer(pPlayer);
+		return false;
 	}
 
-	pPlayer->SetIpAddress(ip);
-
 	if (!g_pAdminSystem->ApplyInfractions(pPlayer))
 	{
 		// Player is banned
-		delete pPlayer;
+		DestroyPlayer(pPlayer);
 		return false;
 	}
 
@@ -551,6 +567,7 @@ bool CPlayerManager::OnClientConnected(CPlayerSlot slot, uint64 xuid, const char
 
 	pPlayer->SetConnected();
 	m_vecPlayers[slot.Get()] = pPlayer;
+	m_mapSteamIDToSlot.Set(xuid, slot.Get());
 
 	ResetPlayerFlags(slot.Get());
 
@@ -566,7 +583,9 @@ void CPlayerManager::OnClientDisconnect(CPlayerSlot slot)
 	g_pUserPreferencesSystem->PushPreferences(slot.Get());
 	g_pUserPreferencesSystem->ClearPreferences(slot.Get());
 
-	delete m_vecPlayers[slot.Get()];
+	UnmapSteamID(slot.Get());
+
+	DestroyPlayer(m_vecPlayers[slot.Get()]);
 	m_vecPlayers[slot.Get()] = nullptr;
 
 	ResetPlayerFlags(slot.Get());
@@ -576,6 +595,35 @@ void CPlayerManager::OnClientDisconnect(CPlayerSlot slot)
 	g_pPanoramaVoteHandler->RemovePlayerFromVote(slot.Get());
 }
 
+// The same SteamID can briefly be on two slots (e.g. reconnecting before the old connection timed out),
+// hand the entry over to whoever else still has it rather than losing track of them
+void CPlayerManager::UnmapSteamID(int iSlot)
+{
+	ZEPlayer* pPlayer = m_vecPlayers[iSlot];
+
+	if (!pPlayer || pPlayer->IsFakeClient() || !pPlayer->GetUnauthenticatedSteamId())
+		return;
+
+	uint64 iSteamId = pPlayer->GetUnauthenticatedSteamId64();
+	int *pSlot = m_mapSteamIDToSlot.Find(iSteamId);
+
+	if (!pSlot || *pSlot != iSlot)
+		return;
+
+	m_mapSteamIDToSlot.Remove(iSteamId);
+
+	for (int i = 0; i < MAXPLAYERS; i++)
+	{
+		ZEPlayer* pOther = m_vecPlayers[i];
+
+		if (i != iSlot && pOther && !pOther->IsFakeClient() && pOther->GetUnauthenticatedSteamId() && pOther->GetUnauthenticatedSteamId64() == iSteamId)
+		{
+			m_mapSteamIDToSlot.Insert(iSteamId, i);
+			break;
+		}
+	}
+}
+
 void CPlayerManager::OnClientPutInServer(CPlayerSlot slot)
 {
 	ZEPlayer* pPlayer = m_vecPlayers[slot.Get()];
@@ -592,7 +640,8 @@ void CPlayerManager::OnLateLoad()
 		if (!pController || !pController->IsController() || !pController->IsConnected())
 			continue;
 
-		OnClientConnected(i, pController->m_steamID(), "0.0.0.0:0");
+		if (OnClientConnected(i, pController->m_steamID(), "0.0.0.0:0"))
+			g_playerNameIndex.SetName(i, pController->GetPlayerName());
 	}
 }
 
@@ -610,66 +659,58 @@ void CPlayerManager::OnValidateAuthTicket(ValidateAuthTicketResponse_t *pRespons
 
 	Message("%s: SteamID=%llu Response=%d\n", __func__, iSteamId, pResponse->m_eAuthSessionResponse);
 
-	ZEPlayer *pPlayer = nullptr;
+	int *pSlot = m_mapSteamIDToSlot.Find(iSteamId);
+	ZEPlayer *pPlayer = pSlot ? m_vecPlayers[*pSlot] : nullptr;
 
-	for (ZEPlayer *pPlayer : m_vecPlayers)
-	{
-		if (!pPlayer || pPlayer->IsFakeClient() || !(pPlayer->GetUnauthenticatedSteamId64() == iSteamId))
-			continue;
+	if (!pPlayer || pPlayer->IsFakeClient() || !(pPlayer->GetUnauthenticatedSteamId64() == iSteamId))
+		return;
 
-		CCSPlayerController *pController = CCSPlayerController::FromSlot(pPlayer->GetPlayerSlot());
+	CCSPlayerController *pController = CCSPlayerController::FromSlot(pPlayer->GetPlayerSlot());
 
-		switch (pResponse->m_eAuthSessionResponse)
+	switch (pResponse->m_eAuthSessionResponse)
+	{
+		case k_EAuthSessionResponseOK:
 		{
-			case k_EAuthSessionResponseOK:
-			{
-				pPlayer->OnAuthenticated();
-				return;
-			}
-
-			case k_EAuthSessionResponseAuthTicketInvalid:
-			case k_EAuthSessionResponseAuthTicketInvalidAlreadyUsed:
-			{
-				if (!g_iDelayAuthFailKick)
-					return;
+			pPlayer->OnAuthenticated();
+			return;
+		}
 
-				ClientPrint(pController, HUD_PRINTTALK, " \7Your Steam authentication failed due to an invalid or used ticket.");
-				ClientPrint(pController, HUD_PRINTTALK, " \7You may have to restart your Steam client in order to fix this.\n");
-				[[fallthrough]];
-			}
+		case k_EAuthSessionResponseAuthTicketInvalid:
+		case k_EAuthSessionResponseAuthTicketInvalidAlreadyUsed:
+		{
+			if (!g_iDelayAuthFailKick)
+				return;
 
-			default:
-			{
-				if (!g_iDelayAuthFailKick)
-					return;
+			ClientPrint(pController, HUD_PRINTTALK, " \7Your Steam authentication failed due to an invalid or used ticket.");
+			ClientPrint(pController, HUD_PRINTTALK, " \7You may have to restart your Steam client in order to fix this.\n");
+			[[fallthrough]];
+		}
 
-				ClientPrint(pController, HUD_PRINTTALK, " \7WARNING: You will be kicked in %i seconds due to failed Steam authentication.\n", g_iDelayAuthFailKick);
+		default:
+		{
+			if (!g_iDelayAuthFailKick)
+				return;
 
-				ZEPlayerHandle hPlayer = pPlayer->GetHandle();
-				new CTimer(g_iDelayAuthFailKick, true, true, [hPlayer]()
-				{
-					if (!hPlayer.IsValid())
-						return -1.f;
+			ClientPrint(pController, HUD_PRINTTALK, " \7WARNING: You will be kicked in %i seconds due to failed Steam authentication.\n", g_iDelayAuthFailKick);
 
-					g_pEngineServer2->DisconnectClient(hPlayer.GetPlayerSlot(), NETWORK_DISCONNECT_KICKED_NOSTEAMLOGIN);
+			ZEPlayerHandle hPlayer = pPlayer->GetHandle();
+			new CTimer("auth_fail_kick", g_iDelayAuthFailKick, true, true, [hPlayer]()
+			{
+				if (!hPlayer.IsValid())
 					return -1.f;
-				});
-			}
+
+				g_pEngineServer2->DisconnectClient(hPlayer.GetPlayerSlot(), NETWORK_DISCONNECT_KICKED_NOSTEAMLOGIN);
+				return -1.f;
+			});
 		}
 	}
 }
 
 void CPlayerManager::CheckInfractions()
 {
-	for (int i = 0; i < gpGlobals->maxClients; i++)
-	{
-		if (m_vecPlayers[i] == nullptr || m_vecPlayers[i]->IsFakeClient())
-			continue;
-
-		m_vecPlayers[i]->CheckInfractions();
-	}
-
-	g_pAdminSystem->SaveInfractions();
+	// Only the infractions that ran out are looked at, along with whoever they were on
+	// They aren't journaled, the next snapshot simply leaves them out
+	g_pAdminSystem->ExpireInfractions();
 }
 
 static bool g_bFlashLightEnable = false;
@@ -683,18 +724,13 @@ void CPlayerManager::FlashLightThink()
 
 	VPROF("CPlayerManager::FlashLightThink");
 
-	for (int i = 0; i < gpGlobals->maxClients; i++)
+	// Check both to make sure flashlight is only toggled when the player presses the key
+	for (uint64 iMask = g_playerSnapshot.m_iAliveMask; iMask; iMask &= iMask - 1)
 	{
-		CCSPlayerController *pPlayer = CCSPlayerController::FromSlot(i);
-
-		if (!pPlayer || !pPlayer->m_bPawnIsAlive())
-			continue;
-
-		uint64 *pButtons = pPlayer->GetPawn()->m_pMovementServices->m_nButtons().m_pButtonStates();
+		int i = std::countr_zero(iMask);
 
-		// Check both to make sure flashlight is only toggled when the player presses the key
-		if ((pButtons[0] & IN_LOOK_AT_WEAPON) && (pButtons[1] & IN_LOOK_AT_WEAPON))
-			pPlayer->GetZEPlayer()->ToggleFlashLight();
+		if ((g_playerSnapshot.m_iButtons[0][i] & IN_LOOK_AT_WEAPON) && (g_playerSnapshot.m_iButtons[1][i] & IN_LOOK_AT_WEAPON))
+			g_playerSnapshot.m_pController[i]->GetZEPlayer()->ToggleFlashLight();
 	}
 }
 
@@ -702,57 +738,49 @@ static bool g_bHideTeammatesOnly = false;
 
 FAKE_BOOL_CVAR(cs2f_hide_teammates_only, "Whether to hide teammates only", g_bHideTeammatesOnly, false, false)
 
+extern bool g_bEnableHide;
+
 void CPlayerManager::CheckHideDistances()
 {
-	if (!g_pEntitySystem)
+	if (!g_pEntitySystem || !g_bEnableHide)
 		return;
 
 	VPROF("CPlayerManager::CheckHideDistances");
 
-	for (int i = 0; i < gpGlobals->maxClients; i++)
-	{
-		auto player = GetPlayer(i);
-
-		if (!player)
-			continue;
-
-		player->ClearTransmit();
-		auto hideDistance = player->GetHideDistance();
-
-		if (!hideDistance)
-			continue;
+	float rgRangeSqr[MAXPLAYERS];
+	uint64 rgTargetMasks[MAXPLAYERS];
+	uint64 rgHideMasks[MAXPLAYERS];
+	uint64 iViewerMask = 0;
 
-		CCSPlayerController* pController = CCSPlayerController::FromSlot(i);
+	for (uint64 iMask = g_playerSnapshot.m_iAliveMask; iMask; iMask &= iMask - 1)
+	{
+		int i = std::countr_zero(iMask);
+		ZEPlayer *player = GetPlayer(i);
 
-		if (!pController)
+		if (!player || !player->GetHideDistance())
 			continue;
 
-		auto pPawn = pController->GetPawn();
+		float flHideDistance = player->GetHideDistance();
+		rgRangeSqr[i] = flHideDistance * flHideDistance;
 
-		if (!pPawn || !pPawn->IsAlive())
-			continue;
+		// TODO: Unhide dead pawns if/when valve fixes the crash
+		rgTargetMasks[i] = g_playerSnapshot.m_iPawnMask & ~SLOT_BIT(i);
 
-		auto vecPosition = pPawn->GetAbsOrigin();
-		int team = pController->m_iTeamNum;
+		if (g_bHideTeammatesOnly)
+			rgTargetMasks[i] &= g_playerSnapshot.GetTeamMask(g_playerSnapshot.m_iTeam[i]);
 
-		for (int j = 0; j < gpGlobals->maxClients; j++)
-		{
-			if (j == i)
-				continue;
+		iViewerMask |= SLOT_BIT(i);
+	}
 
-			CCSPlayerController* pTargetController = CCSPlayerController::FromSlot(j);
+	ComputeHideMasks(g_playerSnapshot.m_flOriginX, g_playerSnapshot.m_flOriginY, g_playerSnapshot.m_flOriginZ,
+		rgRangeSqr, rgTargetMasks, iViewerMask, rgHideMasks);
 
-			if (pTargetController)
-			{
-				auto pTargetPawn = pTargetController->GetPawn();
+	for (int i = 0; i < gpGlobals->maxClients; i++)
+	{
+		ZEPlayer *player = GetPlayer(i);
 
-				// TODO: Unhide dead pawns if/when valve fixes the crash
-				if (pTargetPawn && (!g_bHideTeammatesOnly || pTargetController->m_iTeamNum == team))
-				{
-					player->SetTransmit(j, pTargetPawn->GetAbsOrigin().DistToSqr(vecPosition) <= hideDistance * hideDistance);
-				}
-			}
-		}
+		if (player)
+			player->SetHideMask(rgHideMasks[i]);
 	}
 }
 
@@ -769,24 +797,18 @@ static const char *g_szPlayerStates[] =
 	"STATE_DORMANT"
 };
 
-extern bool g_bEnableHide;
-
 void CPlayerManager::UpdatePlayerStates()
 {
 	for (int i = 0; i < gpGlobals->maxClients; i++)
 	{
 		ZEPlayer *pPlayer = GetPlayer(i);
 
-		if (!pPlayer)
-			continue;
-
-		CCSPlayerController *pController = CCSPlayerController::FromSlot(i);
-
-		if (!pController)
+		if (!pPlayer || !(g_playerSnapshot.m_iValidMask & SLOT_BIT(i)))
 			continue;
 
+		CCSPlayerController *pController = g_playerSnapshot.m_pController[i];
 		uint32 iPreviousPlayerState = pPlayer->GetPlayerState();
-		uint32 iCurrentPlayerState = pController->GetPawnState();
+		uint32 iCurrentPlayerState = g_playerSnapshot.m_iPawnState[i];
 
 		if (iCurrentPlayerState != iPreviousPlayerState)
 		{
@@ -812,25 +834,16 @@ FAKE_BOOL_CVAR(cs2f_infinite_reserve_ammo, "Whether to enable infinite reserve a
 
 void CPlayerManager::SetupInfiniteAmmo()
 {
-	new CTimer(5.0f, false, true, []()
+	new CTimer("infinite_ammo", 5.0f, false, true, []()
 	{
 		if (!g_bInfiniteAmmo)
 			return 5.0f;
 
 		VPROF("CPlayerManager::InfiniteAmmoTimer");
 
-		for (int i = 0; i < gpGlobals->maxClients; i++)
+		for (uint64 iMask = g_playerSnapshot.m_iPawnMask; iMask; iMask &= iMask - 1)
 		{
-			CCSPlayerController* pController = CCSPlayerController::FromSlot(i);
-
-			if (!pController)
-				continue;
-
-			auto pPawn = pController->GetPawn();
-
-			if (!pPawn)
-				continue;
-
+			CBasePlayerPawn* pPawn = g_playerSnapshot.m_pPawn[std::countr_zero(iMask)];
 			CCSPlayer_WeaponServices* pWeaponServices = pPawn->m_pWeaponServices;
 
 			// it can sometimes be null when player joined on the very first round? 
@@ -898,249 +911,72 @@ ETargetError GetTargetError(CCSPlayerController* pPlayer, CCSPlayerController* p
 	return ETargetError::NO_ERRORS;
 }
 
-ETargetError CPlayerManager::GetPlayersFromString(CCSPlayerController* pPlayer, const char* pszTarget,
-												  int& iNumClients, int* rgiClients, uint64 iBlockedFlags,
-												  ETargetType& nType)
+// Everything GetTargetError needs to know about each slot, gathered once so group selectors can be evaluated as masks
+static void BuildTargetTable(ZEPlayer** rgpPlayers, TargetTable_t& table)
 {
-	nType = ETargetType::NONE;
-	ZEPlayer* zpPlayer = pPlayer ? pPlayer->GetZEPlayer() : nullptr;
-	bool bTargetMultiple = false;
-	bool bTargetRandom = false;
-	uint64 iInverseFlags = NO_TARGET_BLOCKS;
-	
-	if (!V_stricmp(pszTarget, "@me"))
-	{
-		nType = ETargetType::SELF;
-
-		if (iBlockedFlags & NO_SELF || !pPlayer)
-			return ETargetError::SELF;
-	}
-	else if (!V_stricmp(pszTarget, "@!me"))
-	{
-		nType = ETargetType::ALL_BUT_SELF;
-
-		if (iBlockedFlags & NO_MULTIPLE)
-			return ETargetError::MULTIPLE;
-
-		iBlockedFlags |= NO_SELF;
-		bTargetMultiple = true;
-	}
-	else if (!V_stricmp(pszTarget, "@all"))
-	{
-		nType = ETargetType::ALL;
-
-		if (iBlockedFlags & NO_MULTIPLE)
-			return ETargetError::MULTIPLE;
+	V_memset(&table, 0, sizeof(table));
 
-		bTargetMultiple = true;
-	}
-	else if (!V_stricmp(pszTarget, "@!all"))
-		return ETargetError::INVALID;
-	else if (!V_stricmp(pszTarget, "@t"))
-	{
-		nType = ETargetType::T;
-
-		if (iBlockedFlags & NO_TERRORIST)
-			return ETargetError::TERRORIST;
-		else if (iBlockedFlags & NO_MULTIPLE)
-			return ETargetError::MULTIPLE;
-
-		bTargetMultiple = true;
-		iBlockedFlags |= NO_COUNTER_TERRORIST | NO_SPECTATOR;
-
-	}
-	else if (!V_stricmp(pszTarget, "@!t"))
-	{
-		nType = ETargetType::ALL_BUT_T;
-
-		if (iBlockedFlags & NO_MULTIPLE)
-			return ETargetError::MULTIPLE;
-
-		bTargetMultiple = true;
-		iBlockedFlags |= NO_TERRORIST;
-	}
-	else if (!V_stricmp(pszTarget, "@ct"))
-	{
-		nType = ETargetType::CT;
-
-		if (iBlockedFlags & NO_COUNTER_TERRORIST)
-			return ETargetError::COUNTER_TERRORIST;
-		else if (iBlockedFlags & NO_MULTIPLE)
-			return ETargetError::MULTIPLE;
-
-		bTargetMultiple = true;
-		iBlockedFlags |= NO_TERRORIST | NO_SPECTATOR;
-	}
-	else if (!V_stricmp(pszTarget, "@!ct"))
-	{
-		nType = ETargetType::ALL_BUT_CT;
-
-		if (iBlockedFlags & NO_MULTIPLE)
-			return ETargetError::MULTIPLE;
-
-		bTargetMultiple = true;
-		iBlockedFlags |= NO_COUNTER_TERRORIST;
-
-	}
-	else if (!V_stricmp(pszTarget, "@spec"))
-	{
-		nType = ETargetType::SPECTATOR;
-
-		if (iBlockedFlags & NO_SPECTATOR)
-			return ETargetError::SPECTATOR;
-		else if (iBlockedFlags & NO_DEAD)
-			return ETargetError::DEAD;
-		else if (iBlockedFlags & NO_MULTIPLE)
-			return ETargetError::MULTIPLE;
-
-		bTargetMultiple = true;
-		iBlockedFlags |= NO_TERRORIST | NO_COUNTER_TERRORIST;
-	}
-	else if (!V_stricmp(pszTarget, "@!spec"))
-	{
-		nType = ETargetType::ALL_BUT_SPECTATOR;
-
-		if (iBlockedFlags & NO_MULTIPLE)
-			return ETargetError::MULTIPLE;
-
-		bTargetMultiple = true;
-		iBlockedFlags |= NO_SPECTATOR;
-	}
-	else if (!V_stricmp(pszTarget, "@random"))
-	{
-		nType = ETargetType::RANDOM;
-
-		if (iBlockedFlags & NO_RANDOM)
-			return ETargetError::RANDOM;
-
-		bTargetRandom = true;
-	}
-	else if (!V_stricmp(pszTarget, "@!random"))
-	{
-		nType = ETargetType::ALL_BUT_RANDOM;
-
-		if (iBlockedFlags & NO_RANDOM)
-			return ETargetError::RANDOM;
-
-		iInverseFlags = NO_RANDOM;
-	}
-	else if (!V_stricmp(pszTarget, "@randomt"))
-	{
-		nType = ETargetType::RANDOM_T;
-		
-		if (iBlockedFlags & NO_TERRORIST)
-			return ETargetError::TERRORIST;
-		else if (iBlockedFlags & NO_RANDOM)
-			return ETargetError::RANDOM;
-
-		bTargetRandom = true;
-		iBlockedFlags |= NO_COUNTER_TERRORIST;
-	}
-	else if (!V_stricmp(pszTarget, "@!randomt"))
-	{
-		nType = ETargetType::ALL_BUT_RANDOM_T;
-		
-		if (iBlockedFlags & NO_RANDOM)
-			return ETargetError::RANDOM;
-
-		iInverseFlags = NO_RANDOM | NO_COUNTER_TERRORIST | NO_SPECTATOR;
-	}
-	else if (!V_stricmp(pszTarget, "@randomct"))
-	{
-		nType = ETargetType::RANDOM_CT;
-		
-		if (iBlockedFlags & NO_COUNTER_TERRORIST)
-			return ETargetError::COUNTER_TERRORIST;
-		else if (iBlockedFlags & NO_RANDOM)
-			return ETargetError::RANDOM;
-
-		bTargetRandom = true;
-		iBlockedFlags |= NO_TERRORIST;
-	}
-	else if (!V_stricmp(pszTarget, "@!randomct"))
-	{
-		nType = ETargetType::RANDOM_CT;
-		
-		if (iBlockedFlags & NO_RANDOM)
-			return ETargetError::RANDOM;
-
-		iInverseFlags = NO_RANDOM | NO_TERRORIST | NO_SPECTATOR;
-	}
-	else if (!V_stricmp(pszTarget, "@randomspec"))
+	for (int i = 0; i < gpGlobals->maxClients; i++)
 	{
-		nType = ETargetType::RANDOM_SPEC;
-
-		if (iBlockedFlags & NO_SPECTATOR)
-			return ETargetError::SPECTATOR;
-		else if (iBlockedFlags & NO_DEAD)
-			return ETargetError::DEAD;
-		else if (iBlockedFlags & NO_RANDOM)
-			return ETargetError::RANDOM;
+		if (rgpPlayers[i] == nullptr)
+			continue;
 
-		bTargetRandom = true;
-		iBlockedFlags |= NO_TERRORIST | NO_COUNTER_TERRORIST;
-	}
-	else if (!V_stricmp(pszTarget, "@!randomspec"))
-	{
-		nType = ETargetType::ALL_BUT_RANDOM_SPEC;
+		CCSPlayerController* pTarget = CCSPlayerController::FromSlot(i);
 
-		if (iBlockedFlags & NO_RANDOM)
-			return ETargetError::RANDOM;
+		if (!pTarget || !pTarget->IsController() || !pTarget->IsConnected() || pTarget->m_bIsHLTV || !pTarget->GetZEPlayer())
+			continue;
 
-		iInverseFlags = NO_RANDOM | NO_TERRORIST | NO_COUNTER_TERRORIST;
+		ZEPlayer* zpTarget = pTarget->GetZEPlayer();
+		uint64 iBit = 1ull << i;
+		int iTeam = pTarget->m_iTeamNum();
+
+		table.iValidMask |= iBit;
+		table.rgiImmunity[i] = zpTarget->GetAdminImmunity();
+
+		if (iTeam == CS_TEAM_T)
+			table.iTerroristMask |= iBit;
+		else if (iTeam == CS_TEAM_CT)
+			table.iCounterTerroristMask |= iBit;
+		else if (iTeam <= CS_TEAM_SPECTATOR)
+			table.iSpectatorMask |= iBit;
+
+		if (pTarget->m_bPawnIsAlive())
+			table.iAliveMask |= iBit;
+		if (zpTarget->IsFakeClient())
+			table.iBotMask |= iBit;
+		if (zpTarget->IsAuthenticated())
+			table.iAuthenticatedMask |= iBit;
 	}
-	else if (!V_stricmp(pszTarget, "@dead") || !V_stricmp(pszTarget, "@!alive"))
-	{
-		nType = ETargetType::DEAD;
-
-		if (iBlockedFlags & NO_DEAD)
-			return ETargetError::DEAD;
-		if (iBlockedFlags & NO_MULTIPLE)
-			return ETargetError::MULTIPLE;
+}
 
-		bTargetMultiple = true;
-		iBlockedFlags |= NO_ALIVE;
-	}		
-	else if (!V_stricmp(pszTarget, "@alive") || !V_stricmp(pszTarget, "@!dead"))
-	{
-		nType = ETargetType::ALIVE;
+static void AddTargetsFromMask(uint64 iMask, int& iNumClients, int* rgiClients)
+{
+	for (; iMask; iMask &= iMask - 1)
+		rgiClients[iNumClients++] = std::countr_zero(iMask);
+}
 
-		if (iBlockedFlags & NO_ALIVE)
-			return ETargetError::ALIVE;
-		if (iBlockedFlags & NO_MULTIPLE)
-			return ETargetError::MULTIPLE;
+ETargetError CPlayerManager::GetPlayersFromString(CCSPlayerController* pPlayer, const char* pszTarget,
+												  int& iNumClients, int* rgiClients, uint64 iBlockedFlags,
+												  ETargetType& nType)
+{
+	nType = ETargetType::NONE;
+	ZEPlayer* zpPlayer = pPlayer ? pPlayer->GetZEPlayer() : nullptr;
+	const TargetSelector_t* pSelector = FindTargetSelector(pszTarget);
 
-		bTargetMultiple = true;
-		iBlockedFlags |= NO_DEAD;
-	}
-	else if (!V_stricmp(pszTarget, "@bot") || !V_stricmp(pszTarget, "@!human"))
+	if (pSelector)
 	{
-		nType = ETargetType::BOT;
+		// @aim and @!aim only report their type once something was actually aimed at
+		if (pSelector->nMode != ETargetSelectorMode::AIM && pSelector->nMode != ETargetSelectorMode::ALL_BUT_AIM)
+			nType = pSelector->nType;
 
-		if (iBlockedFlags & NO_BOT)
-			return ETargetError::BOT;
-		if (iBlockedFlags & NO_MULTIPLE)
-			return ETargetError::MULTIPLE;
-
-		bTargetMultiple = true;
-		iBlockedFlags |= NO_HUMAN;
+		ETargetError eError = ApplyTargetSelector(pSelector, pPlayer != nullptr, iBlockedFlags);
+		if (eError != ETargetError::NO_ERRORS)
+			return eError;
 	}
-	else if (!V_stricmp(pszTarget, "@human") || !V_stricmp(pszTarget, "@!bot"))
-	{
-		nType = ETargetType::HUMAN;
 
-		if (iBlockedFlags & NO_HUMAN)
-			return ETargetError::HUMAN;
-		if (iBlockedFlags & NO_MULTIPLE)
-			return ETargetError::MULTIPLE;
-
-		bTargetMultiple = true;
-		iBlockedFlags |= NO_BOT;
-	}
-	
 	// We have setup what we need and given custom errors if needed for group targetting.
 	// Now we actually get the target(s).
-	if (nType == ETargetType::SELF)
+	if (pSelector && pSelector->nMode == ETargetSelectorMode::SELF)
 	{
 		ETargetError eType = GetTargetError(pPlayer, pPlayer, iBlockedFlags);
 		if (eType != ETargetError::NO_ERRORS)
@@ -1149,88 +985,62 @@ ETargetError CPlayerManager::GetPlayersFromString(CCSPlayerController* pPlayer,
 		rgiClients[iNumClients++] = zpPlayer->GetPlayerSlot().Get();
 		return ETargetError::NO_ERRORS;
 	}
-	else if (bTargetMultiple)
+	else if (pSelector && pSelector->nMode != ETargetSelectorMode::AIM)
 	{
-		for (int i = 0; i < gpGlobals->maxClients; i++)
-		{
-			if (m_vecPlayers[i] == nullptr)
-				continue;
+		TargetTable_t table;
+		BuildTargetTable(m_vecPlayers, table);
 
-			CCSPlayerController* pTarget = CCSPlayerController::FromSlot(i);
+		TargetQuery_t query;
+		query.iSelfSlot = pPlayer ? pPlayer->GetPlayerSlot() : -1;
+		query.iSelfImmunity = zpPlayer ? zpPlayer->GetAdminImmunity() : -1;
+		query.iImmunityMode = g_iAdminImmunityTargetting;
 
-			if (GetTargetError(pPlayer, pTarget, iBlockedFlags) == ETargetError::NO_ERRORS)
-				rgiClients[iNumClients++] = i;
-		}
-	}
-	else if (bTargetRandom)
-	{
-		int iAttempts = 0;
+		// Slot left out by the "all but" selectors
+		int iExcludedSlot = -1;
 
-		while (iNumClients == 0 && iAttempts < 10000)
+		if (pSelector->nMode == ETargetSelectorMode::ALL_BUT_RANDOM)
 		{
-			int iSlot = rand() % (gpGlobals->maxClients - 1);
-
-			// Prevent infinite loop
-			iAttempts++;
-
-			if (m_vecPlayers[iSlot] == nullptr)
-				continue;
+			// Can ignore immunity and blocked flags here, since we are NOT targetting them
+			iExcludedSlot = PickRandomSlot(GetTargetableMask(table, query, pSelector->iInverseFlags | NO_IMMUNITY));
 
-			CCSPlayerController* pTarget = CCSPlayerController::FromSlot(iSlot);
-			if (GetTargetError(pPlayer, pTarget, iBlockedFlags) == ETargetError::NO_ERRORS)
-			{
-				rgiClients[iNumClients++] = iSlot;
-				break;
-			}
+			if (iExcludedSlot == -1)
+				return ETargetError::INVALID;
 		}
-	}
-	else if (iInverseFlags > NO_TARGET_BLOCKS)
-	{
-		CCSPlayerController* pRandomPlayer = nullptr;
-		int iAttempts = 0;
-
-		while (iNumClients == 0 && iAttempts < 10000)
+		else if (pSelector->nMode == ETargetSelectorMode::ALL_BUT_AIM)
 		{
-			int iSlot = rand() % (gpGlobals->maxClients - 1);
-
-			// Prevent infinite loop
-			iAttempts++;
+			CBaseEntity* entTarget = UTIL_FindPickerEntity(pPlayer);
 
-			if (m_vecPlayers[iSlot] == nullptr)
-				continue;
+			if (!entTarget || !entTarget->IsPawn())
+				return ETargetError::INVALID;
 
-			CCSPlayerController* pTarget = CCSPlayerController::FromSlot(iSlot);
+			CCSPlayerController* pAimed = CCSPlayerController::FromPawn(static_cast<CCSPlayerPawn*>(entTarget));
 
 			// Can ignore immunity and blocked flags here, since we are NOT targetting them
-			if (GetTargetError(pPlayer, pTarget, iInverseFlags | NO_IMMUNITY) == ETargetError::NO_ERRORS)
-			{
-				pRandomPlayer = pTarget;
-				break;
-			}
-		}
+			if (GetTargetError(pPlayer, pAimed, NO_IMMUNITY) != ETargetError::NO_ERRORS)
+				return ETargetError::INVALID;
 
-		if (pRandomPlayer == nullptr)
-			return ETargetError::INVALID;
+			nType = ETargetType::ALL_BUT_AIM;
+			iExcludedSlot = pAimed->GetPlayerSlot();
+		}
 
-		for (int i = 0; i < gpGlobals->maxClients; i++)
-		{
-			if (m_vecPlayers[i] == nullptr)
-				continue;
+		uint64 iTargets = GetTargetableMask(table, query, iBlockedFlags);
 
-			CCSPlayerController* pTarget = CCSPlayerController::FromSlot(i);
-			if (pRandomPlayer == pTarget)
-				continue;
+		if (iExcludedSlot != -1)
+			iTargets &= ~(1ull << iExcludedSlot);
 
-			if (GetTargetError(pPlayer, pTarget, iBlockedFlags) == ETargetError::NO_ERRORS)
-				rgiClients[iNumClients++] = i;
+		if (pSelector->nMode == ETargetSelectorMode::RANDOM)
+		{
+			int iSlot = PickRandomSlot(iTargets);
+			iTargets = iSlot == -1 ? 0 : 1ull << iSlot;
 		}
+
+		AddTargetsFromMask(iTargets, iNumClients, rgiClients);
 	}
-	else if (!V_stricmp(pszTarget, "@aim"))
+	else if (pSelector)
 	{
-		CBaseEntity* entTarget = nullptr;
-		entTarget = UTIL_FindPickerEntity(pPlayer);
+		CBaseEntity* entTarget = UTIL_FindPickerEntity(pPlayer);
 
-		if (!entTarget->IsPawn())
+		if (!entTarget || !entTarget->IsPawn())
 			return ETargetError::INVALID;
 
 		CCSPlayerController* pTarget = CCSPlayerController::FromPawn(static_cast<CCSPlayerPawn*>(entTarget));
@@ -1243,35 +1053,6 @@ ETargetError CPlayerManager::GetPlayersFromString(CCSPlayerController* pPlayer,
 
 		rgiClients[iNumClients++] = pTarget->GetPlayerSlot();
 	}
-	else if (!V_stricmp(pszTarget, "@!aim"))
-	{
-		CBaseEntity* entTarget = nullptr;
-		entTarget = UTIL_FindPickerEntity(pPlayer);
-
-		if (!entTarget->IsPawn())
-			return ETargetError::INVALID;
-
-		CCSPlayerController* pAimed = CCSPlayerController::FromPawn(static_cast<CCSPlayerPawn*>(entTarget));
-
-		// Can ignore immunity and blocked flags here, since we are NOT targetting them
-		if (GetTargetError(pPlayer, pAimed, NO_IMMUNITY) != ETargetError::NO_ERRORS)
-			return ETargetError::INVALID;
-
-		nType = ETargetType::ALL_BUT_AIM;
-
-		for (int i = 0; i < gpGlobals->maxClients; i++)
-		{
-			if (m_vecPlayers[i] == nullptr)
-				continue;
-
-			CCSPlayerController* pTarget = CCSPlayerController::FromSlot(i);
-			if (pAimed == pTarget)
-				continue;
-
-			if (GetTargetError(pPlayer, pTarget, iBlockedFlags) == ETargetError::NO_ERRORS)
-				rgiClients[iNumClients++] = i;
-		}
-	}
 	else if (*pszTarget == '#')
 	{
 		int iUserID = V_StringToUint16(pszTarget + 1, -1);
@@ -1312,9 +1093,12 @@ ETargetError CPlayerManager::GetPlayersFromString(CCSPlayerController* pPlayer,
 		if (bExactName)
 			pszTarget++;
 
-		for (int i = 0; i < gpGlobals->maxClients; i++)
+		// Only the players whose name matches need their controller looked at
+		for (uint64 iMatches = g_playerNameIndex.FindMatches(pszTarget, bExactName); iMatches; iMatches &= iMatches - 1)
 		{
-			if (m_vecPlayers[i] == nullptr)
+			int i = std::countr_zero(iMatches);
+
+			if (i >= gpGlobals->maxClients || m_vecPlayers[i] == nullptr)
 				continue;
 
 			CCSPlayerController* pTarget = CCSPlayerController::FromSlot(i);
@@ -1322,18 +1106,15 @@ ETargetError CPlayerManager::GetPlayersFromString(CCSPlayerController* pPlayer,
 			if (!pTarget || !pTarget->IsController() || !pTarget->IsConnected() || pTarget->m_bIsHLTV)
 				continue;
 
-			if ((!bExactName && V_stristr(pTarget->GetPlayerName(), pszTarget)) || !V_strcmp(pTarget->GetPlayerName(), pszTarget))
+			nType = ETargetType::PLAYER;
+			if (iNumClients == 1)
 			{
-				nType = ETargetType::PLAYER;
-				if (iNumClients == 1)
-				{
-					iNumClients = 0;
-					return ETargetError::MULTIPLE_NAME_MATCHES;
-				}
-				eType = GetTargetError(pPlayer, pTarget, iBlockedFlags);
-				if (eType == ETargetError::NO_ERRORS)
-					rgiClients[iNumClients++] = i;
+				iNumClients = 0;
+				return ETargetError::MULTIPLE_NAME_MATCHES;
 			}
+			eType = GetTargetError(pPlayer, pTarget, iBlockedFlags);
+			if (eType == ETargetError::NO_ERRORS)
+				rgiClients[iNumClients++] = i;
 		}
 		if (eType != ETargetError::NO_ERRORS)
 			return eType;
@@ -1439,6 +1220,20 @@ ZEPlayer *CPlayerManager::GetPlayer(CPlayerSlot slot)
 	return m_vecPlayers[slot.Get()];
 };
 
+// Slots of everyone with any of iFlags, for ClientPrintMask
+uint64 CPlayerManager::GetAdminMask(uint64 iFlags)
+{
+	uint64 iMask = 0;
+
+	for (int i = 0; i < gpGlobals->maxClients; i++)
+	{
+		if (m_vecPlayers[i] && m_vecPlayers[i]->IsAdminFlagSet(iFlags))
+			iMask |= 1ull << i;
+	}
+
+	return iMask;
+}
+
 // In userids, the lower byte is always the player slot
 CPlayerSlot CPlayerManager::GetSlotFromUserId(uint16 userid)
 {
@@ -1457,11 +1252,23 @@ ZEPlayer *CPlayerManager::GetPlayerFromUserId(uint16 userid)
 
 ZEPlayer* CPlayerManager::GetPlayerFromSteamId(uint64 steamid)
 {
-	for (ZEPlayer* player : m_vecPlayers)
-	{
-		if (player && player->IsAuthenticated() && player->GetSteamId64() == steamid)
-			return player;
-	}
+	int *pSlot = m_mapSteamIDToSlot.Find(steamid);
+	ZEPlayer* player = pSlot ? m_vecPlayers[*pSlot] : nullptr;
+
+	if (player && player->IsAuthenticated() && player->GetSteamId64() == steamid)
+		return player;
+
+	return nullptr;
+}
+
+// Unlike GetPlayerFromSteamId, this also finds players who haven't authenticated yet by the SteamID they connected with
+ZEPlayer* CPlayerManager::GetPlayerFromUnauthenticatedSteamId(uint64 steamid)
+{
+	int *pSlot = m_mapSteamIDToSlot.Find(steamid);
+	ZEPlayer* player = pSlot ? m_vecPlayers[*pSlot] : nullptr;
+
+	if (player && !player->IsFakeClient() && player->GetUnauthenticatedSteamId64() == steamid)
+		return player;
 
 	return nullptr;
 }
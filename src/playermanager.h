@@ -28,6 +28,8 @@
 #include "entity/lights.h"
 #include "entity/cparticlesystem.h"
 #include "gamesystem.h"
+#include "ctimer.h"
+#include "steamidmap.h"
 
 #define NO_TARGET_BLOCKS		(0)
 #define NO_RANDOM				(1 << 1)
@@ -140,72 +142,103 @@ private:
 	};
 };
 
+// Everything about a player that gets read or written every tick, one cache line per slot
+// These live in one contiguous array in CPlayerManager so per-tick loops over players stay within it
+struct alignas(64) ZEPlayerHot_t
+{
+	uint64 m_iHideMask;
+	uint64 m_iLastInputs;
+	std::time_t m_iLastInputTime;
+	float m_flSpeedMod;
+	float m_flMaxSpeed;
+	int m_iHideDistance;
+	uint32 m_iPlayerState;
+	int m_iLeaderIndex;
+	CHandle<CBarnLight> m_hFlashLight;
+	CHandle<CBaseModelEntity> m_hGlowModel;
+	bool m_bFakeClient;
+	bool m_bAuthenticated;
+	bool m_bConnected;
+	bool m_bInGame;
+	bool m_bIsInfected;
+};
+
+static_assert(sizeof(ZEPlayerHot_t) == 64, "ZEPlayerHot_t should fit in a single cache line");
+
+// The rest of ZEPlayer is the cold part, CPlayerManager constructs it in place in preallocated per-slot storage
 class ZEPlayer
 {
 public:
-	ZEPlayer(CPlayerSlot slot, bool m_bFakeClient = false): m_slot(slot), m_bFakeClient(m_bFakeClient), m_Handle(slot)
+	ZEPlayer(CPlayerSlot slot, ZEPlayerHot_t *pHot, bool bFakeClient = false): m_pHot(pHot), m_slot(slot), m_Handle(slot)
 	{ 
-		m_bAuthenticated = false;
+		*m_pHot = ZEPlayerHot_t();
+		m_pHot->m_bFakeClient = bFakeClient;
+		m_pHot->m_bAuthenticated = false;
 		m_iAdminFlags = 0;
 		m_iAdminImmunity = 0;
 		m_SteamID = nullptr;
+		m_szIp[0] = '\0';
 		m_bGagged = false;
 		m_bMuted = false;
-		m_iHideDistance = 0;
-		m_bConnected = false;
+		m_pHot->m_iHideDistance = 0;
+		m_pHot->m_iHideMask = 0;
+		m_pHot->m_bConnected = false;
 		m_iTotalDamage = 0;
 		m_iTotalHits = 0;
 		m_iTotalKills = 0;
 		m_bVotedRTV = false;
 		m_bVotedExtend = false;
-		m_bIsInfected = false;
+		m_pHot->m_bIsInfected = false;
 		m_flRTVVoteTime = 0;
 		m_flExtendVoteTime = 0;
 		m_iFloodTokens = 0;
 		m_flLastTalkTime = 0;
-		m_bInGame = false;
+		m_pHot->m_bInGame = false;
 		m_iMZImmunity = 0; // out of 100
 		m_flNominateTime = -60.0f;
-		m_iPlayerState = 1; // STATE_WELCOME is the initial state
-		m_iLeaderIndex = 0;
+		m_pHot->m_iPlayerState = 1; // STATE_WELCOME is the initial state
+		m_pHot->m_iLeaderIndex = 0;
 		m_iLeaderTracerIndex = 0;
 		m_flLeaderVoteTime = -30.0f;
-		m_flSpeedMod = 1.f;
-		m_flMaxSpeed = 1.f;
-		m_iLastInputs = IN_NONE;
-		m_iLastInputTime = std::time(0);
+		m_pHot->m_flSpeedMod = 1.f;
+		m_pHot->m_flMaxSpeed = 1.f;
+		m_pHot->m_iLastInputs = IN_NONE;
+		m_pHot->m_iLastInputTime = std::time(0);
 		m_pActiveZRClass = nullptr;
 		m_pActiveZRModel = nullptr;
 	}
 
 	~ZEPlayer()
 	{
-		CBarnLight *pFlashLight = m_hFlashLight.Get();
+		CBarnLight *pFlashLight = m_pHot->m_hFlashLight.Get();
 
 		if (pFlashLight)
 			pFlashLight->Remove();
+
+		m_hBeaconTimer.Cancel();
+		m_hGlowTimer.Cancel();
+		m_hGlowDurationTimer.Cancel();
 	}
 
-	bool IsFakeClient() { return m_bFakeClient; }
-	bool IsAuthenticated() { return m_bAuthenticated; }
-	bool IsConnected() { return m_bConnected; }
-	uint64 GetUnauthenticatedSteamId64() { return m_UnauthenticatedSteamID->ConvertToUint64(); }
-	const CSteamID* GetUnauthenticatedSteamId() { return m_UnauthenticatedSteamID; }
+	bool IsFakeClient() { return m_pHot->m_bFakeClient; }
+	bool IsAuthenticated() { return m_pHot->m_bAuthenticated; }
+	bool IsConnected() { return m_pHot->m_bConnected; }
+	uint64 GetUnauthenticatedSteamId64() { return m_UnauthenticatedSteamID.ConvertToUint64(); }
+	const CSteamID* GetUnauthenticatedSteamId() { return m_UnauthenticatedSteamID.ConvertToUint64() ? &m_UnauthenticatedSteamID : nullptr; }
 	uint64 GetSteamId64() { return m_SteamID->ConvertToUint64(); }
 	const CSteamID* GetSteamId() { return m_SteamID; }
 	bool IsAdminFlagSet(uint64 iFlag);
 	bool IsFlooding();
 	
-	void SetConnected() { m_bConnected = true; }
-	void SetUnauthenticatedSteamId(const CSteamID* steamID) { m_UnauthenticatedSteamID = steamID; }
+	void SetConnected() { m_pHot->m_bConnected = true; }
+	void SetUnauthenticatedSteamId(uint64 xuid) { m_UnauthenticatedSteamID.SetFromUint64(xuid); }
 	void SetSteamId(const CSteamID* steamID) { m_SteamID = steamID; }
 	void SetAdminFlags(uint64 iAdminFlags) { m_iAdminFlags = iAdminFlags; }
 	void SetAdminImmunity(int iAdminImmunity) { m_iAdminImmunity = iAdminImmunity; }
 	void SetPlayerSlot(CPlayerSlot slot) { m_slot = slot; }
 	void SetMuted(bool muted) { m_bMuted = muted; }
 	void SetGagged(bool gagged) { m_bGagged = gagged; }
-	void SetTransmit(int index, bool shouldTransmit) { shouldTransmit ? m_shouldTransmit.Set(index) : m_shouldTransmit.Clear(index); }
-	void ClearTransmit() { m_shouldTransmit.ClearAll(); }
+	void SetHideMask(uint64 iHideMask) { m_pHot->m_iHideMask = iHideMask; }
 	void SetHideDistance(int distance);
 	void SetTotalDamage(int damage) { m_iTotalDamage = damage; }
 	void SetTotalHits(int hits) { m_iTotalHits = hits; }
@@ -213,23 +246,23 @@ public:
 	void SetRTVVote(bool bRTVVote) { m_bVotedRTV = bRTVVote; }
 	void SetRTVVoteTime(float flCurtime) { m_flRTVVoteTime = flCurtime; }
 	void SetExtendVote(bool bExtendVote) { m_bVotedExtend = bExtendVote; }
-	void SetInfectState(bool bInfectState) { m_bIsInfected = bInfectState; }
+	void SetInfectState(bool bInfectState) { m_pHot->m_bIsInfected = bInfectState; }
 	void SetExtendVoteTime(float flCurtime) { m_flExtendVoteTime = flCurtime; }
-	void SetIpAddress(std::string strIp) { m_strIp = strIp; }
-	void SetInGame(bool bInGame) { m_bInGame = bInGame; }
+	void SetIpAddress(const char *pszNetworkID);
+	void SetInGame(bool bInGame) { m_pHot->m_bInGame = bInGame; }
 	void SetImmunity(int iMZImmunity) { m_iMZImmunity = iMZImmunity; }
 	void SetNominateTime(float flCurtime) { m_flNominateTime = flCurtime; }
-	void SetFlashLight(CBarnLight *pLight) { m_hFlashLight.Set(pLight); }
+	void SetFlashLight(CBarnLight *pLight) { m_pHot->m_hFlashLight.Set(pLight); }
 	void SetBeaconParticle(CParticleSystem *pParticle) { m_hBeaconParticle.Set(pParticle); }
-	void SetPlayerState(uint32 iPlayerState) { m_iPlayerState = iPlayerState; }
+	void SetPlayerState(uint32 iPlayerState) { m_pHot->m_iPlayerState = iPlayerState; }
 	void SetLeader(int leaderIndex);
 	void SetLeaderTracer(int tracerIndex) { m_iLeaderTracerIndex = tracerIndex; }
 	void SetLeaderVoteTime(float flCurtime) { m_flLeaderVoteTime = flCurtime; }
-	void SetGlowModel(CBaseModelEntity *pModel) { m_hGlowModel.Set(pModel); }
-	void SetSpeedMod(float flSpeedMod) { m_flSpeedMod = flSpeedMod; }
-	void SetLastInputs(uint64 iLastInputs) { m_iLastInputs = iLastInputs; }
-	void UpdateLastInputTime() { m_iLastInputTime = std::time(0); }
-	void SetMaxSpeed(float flMaxSpeed) { m_flMaxSpeed = flMaxSpeed; }
+	void SetGlowModel(CBaseModelEntity *pModel) { m_pHot->m_hGlowModel.Set(pModel); }
+	void SetSpeedMod(float flSpeedMod) { m_pHot->m_flSpeedMod = flSpeedMod; }
+	void SetLastInputs(uint64 iLastInputs) { m_pHot->m_iLastInputs = iLastInputs; }
+	void UpdateLastInputTime() { m_pHot->m_iLastInputTime = std::time(0); }
+	void SetMaxSpeed(float flMaxSpeed) { m_pHot->m_flMaxSpeed = flMaxSpeed; }
 	void ReplicateConVar(const char* pszName, const char* pszValue);
 	void SetActiveZRClass(std::shared_ptr<ZRClass> pZRModel) { m_pActiveZRClass = pZRModel; }
 	void SetActiveZRModel(std::shared_ptr<ZRModelEntry> pZRClass) { m_pActiveZRModel = pZRClass; }
@@ -238,8 +271,9 @@ public:
 	int GetAdminImmunity() { return m_iAdminImmunity; }
 	bool IsMuted() { return m_bMuted; }
 	bool IsGagged() { return m_bGagged; }
-	bool ShouldBlockTransmit(int index) { return m_shouldTransmit.Get(index); }
-	int GetHideDistance();
+	bool ShouldBlockTransmit(int index) { return m_pHot->m_iHideMask & ((uint64)1 << index); }
+	uint64 GetHideMask() { return m_pHot->m_iHideMask; }
+	int GetHideDistance() { return m_pHot->m_iHideDistance; }
 	CPlayerSlot GetPlayerSlot() { return m_slot; }
 	int GetTotalDamage() { return m_iTotalDamage; }
 	int GetTotalHits() { return m_iTotalHits; }
@@ -247,27 +281,27 @@ public:
 	bool GetRTVVote() { return m_bVotedRTV; }
 	float GetRTVVoteTime() { return m_flRTVVoteTime; }
 	bool GetExtendVote() { return m_bVotedExtend; }
-	bool IsInfected() { return m_bIsInfected; }
+	bool IsInfected() { return m_pHot->m_bIsInfected; }
 	float GetExtendVoteTime() { return m_flExtendVoteTime; }
-	const char* GetIpAddress() { return m_strIp.c_str(); }
-	bool IsInGame() { return m_bInGame; }
+	const char* GetIpAddress() { return m_szIp; }
+	bool IsInGame() { return m_pHot->m_bInGame; }
 	int GetImmunity() { return m_iMZImmunity; }
 	float GetNominateTime() { return m_flNominateTime; }
-	CBarnLight *GetFlashLight() { return m_hFlashLight.Get(); }
+	CBarnLight *GetFlashLight() { return m_pHot->m_hFlashLight.Get(); }
 	CParticleSystem *GetBeaconParticle() { return m_hBeaconParticle.Get(); }
 	ZEPlayerHandle GetHandle() { return m_Handle; }
-	uint32 GetPlayerState() { return m_iPlayerState; }
-	bool IsLeader() { return (bool) m_iLeaderIndex; }
-	int GetLeaderIndex() { return m_iLeaderIndex; }
+	uint32 GetPlayerState() { return m_pHot->m_iPlayerState; }
+	bool IsLeader() { return (bool) m_pHot->m_iLeaderIndex; }
+	int GetLeaderIndex() { return m_pHot->m_iLeaderIndex; }
 	int GetLeaderTracer() { return m_iLeaderTracerIndex; }
 	int GetLeaderVoteCount();
 	bool HasPlayerVotedLeader(ZEPlayer* pPlayer);
 	float GetLeaderVoteTime() { return m_flLeaderVoteTime; }
-	CBaseModelEntity *GetGlowModel() { return m_hGlowModel.Get(); }
-	float GetSpeedMod() { return m_flSpeedMod; }
-	float GetMaxSpeed() { return m_flMaxSpeed; }
-	uint64 GetLastInputs() { return m_iLastInputs; }
-	std::time_t GetLastInputTime() { return m_iLastInputTime; }
+	CBaseModelEntity *GetGlowModel() { return m_pHot->m_hGlowModel.Get(); }
+	float GetSpeedMod() { return m_pHot->m_flSpeedMod; }
+	float GetMaxSpeed() { return m_pHot->m_flMaxSpeed; }
+	uint64 GetLastInputs() { return m_pHot->m_iLastInputs; }
+	std::time_t GetLastInputTime() { return m_pHot->m_iLastInputTime; }
 	std::shared_ptr<ZRClass> GetActiveZRClass() { return m_pActiveZRClass; }
 	std::shared_ptr<ZRModelEntry> GetActiveZRModel() { return m_pActiveZRModel; }
 	
@@ -285,45 +319,34 @@ public:
 	void EndGlow();
 
 private:
-	bool m_bAuthenticated;
-	bool m_bConnected;
-	const CSteamID* m_UnauthenticatedSteamID;
+	ZEPlayerHot_t *m_pHot;
+	CSteamID m_UnauthenticatedSteamID;
 	const CSteamID* m_SteamID;
 	CPlayerSlot m_slot;
-	bool m_bFakeClient;
 	bool m_bMuted;
 	bool m_bGagged;
 	uint64 m_iAdminFlags;
 	int m_iAdminImmunity;
-	int m_iHideDistance;
-	CBitVec<MAXPLAYERS> m_shouldTransmit;
 	int m_iTotalDamage;
 	int m_iTotalHits;
 	int m_iTotalKills;
 	bool m_bVotedRTV;
 	float m_flRTVVoteTime;
 	bool m_bVotedExtend;
-	bool m_bIsInfected;
 	float m_flExtendVoteTime;
 	int m_iFloodTokens;
 	float m_flLastTalkTime;
-	std::string m_strIp;
-	bool m_bInGame;
+	char m_szIp[64]; // Without the port
 	int m_iMZImmunity;
 	float m_flNominateTime;
-	CHandle<CBarnLight> m_hFlashLight;
 	CHandle<CParticleSystem> m_hBeaconParticle;
+	CTimerHandle m_hBeaconTimer;
 	ZEPlayerHandle m_Handle;
-	uint32 m_iPlayerState;
-	int m_iLeaderIndex;
 	CUtlVector<ZEPlayerHandle> m_vecLeaderVotes;
 	int m_iLeaderTracerIndex;
 	float m_flLeaderVoteTime;
-	CHandle<CBaseModelEntity> m_hGlowModel;
-	float m_flSpeedMod;
-	float m_flMaxSpeed;
-	uint64 m_iLastInputs;
-	std::time_t m_iLastInputTime;
+	CTimerHandle m_hGlowTimer;
+	CTimerHandle m_hGlowDurationTimer;
 	std::shared_ptr<ZRClass> m_pActiveZRClass;
 	std::shared_ptr<ZRModelEntry> m_pActiveZRModel;
 };
@@ -356,6 +379,7 @@ public:
 	CPlayerSlot GetSlotFromUserId(uint16 userid);
 	ZEPlayer *GetPlayerFromUserId(uint16 userid);
 	ZEPlayer *GetPlayerFromSteamId(uint64 steamid);
+	ZEPlayer *GetPlayerFromUnauthenticatedSteamId(uint64 steamid);
 	ETargetError GetPlayersFromString(CCSPlayerController* pPlayer, const char* pszTarget, int &iNumClients, int *clients, uint64 iBlockedFlags = NO_TARGET_BLOCKS);
 	ETargetError GetPlayersFromString(CCSPlayerController* pPlayer, const char* pszTarget, int &iNumClients, int *clients, uint64 iBlockedFlags, ETargetType& nType);
 	static std::string GetErrorString(ETargetError eType, int iSlot = 0);
@@ -363,6 +387,7 @@ public:
 	bool CanTargetPlayers(CCSPlayerController* pPlayer, const char* pszTarget, int& iNumClients, int* clients, uint64 iBlockedFlags, ETargetType& nType);
 
 	ZEPlayer *GetPlayer(CPlayerSlot slot);
+	uint64 GetAdminMask(uint64 iFlags);
 
 	uint64 GetStopSoundMask() { return m_nUsingStopSound; }
 	uint64 GetSilenceSoundMask() { return m_nUsingSilenceSound; }
@@ -386,8 +411,40 @@ public:
 	STEAM_GAMESERVER_CALLBACK_MANUAL(CPlayerManager, OnValidateAuthTicket, ValidateAuthTicketResponse_t, m_CallbackValidateAuthTicketResponse);
 
 private:
+	// Players are built in place in the per-slot storage, so connecting and disconnecting never touches the heap
+	// This stays in the header since memdbgon.h can redefine new in source files
+	ZEPlayer *CreatePlayer(CPlayerSlot slot, bool bFakeClient)
+	{
+		int iSlot = slot.Get();
+
+		// Nothing should be left behind in this slot, but make sure it gets cleaned up instead of overwritten
+		if (m_vecPlayers[iSlot])
+		{
+			UnmapSteamID(iSlot);
+			DestroyPlayer(m_vecPlayers[iSlot]);
+			m_vecPlayers[iSlot] = nullptr;
+		}
+
+		return new (m_rgPlayerStorage[iSlot]) ZEPlayer(slot, &m_rgPlayerHot[iSlot], bFakeClient);
+	}
+
+	void DestroyPlayer(ZEPlayer *pPlayer)
+	{
+		if (pPlayer)
+			pPlayer->~ZEPlayer();
+	}
+
+	void UnmapSteamID(int iSlot);
+
 	ZEPlayer *m_vecPlayers[MAXPLAYERS];
 
+	// Hot per-tick state for every slot back to back, and room for the rest of each ZEPlayer
+	ZEPlayerHot_t m_rgPlayerHot[MAXPLAYERS];
+	alignas(ZEPlayer) uint8 m_rgPlayerStorage[MAXPLAYERS][sizeof(ZEPlayer)];
+
+	// SteamID the client connected with to its slot, filled before authentication so auth callbacks can use it too
+	CSteamIDMap<int> m_mapSteamIDToSlot;
+
 	uint64 m_nUsingStopSound;
 	uint64 m_nUsingSilenceSound;
 	uint64 m_nUsingStopDecals;
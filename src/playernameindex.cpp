@@ -0,0 +1,232 @@
+/**
+ * =============================================================================
+ * CS2Fixes
+ * Copyright (C) 2023-2024 Source2ZE
+ * =============================================================================
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License, version 3.0, as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "playernameindex.h"
+#include "icvar.h"
+#include "tier0/platform.h"
+#include <bit>
+
+#include "tier0/memdbgon.h"
+
+CPlayerNameIndex g_playerNameIndex;
+
+// Only ASCII is folded, the same as V_stristr
+static inline uint8 FoldNameChar(char c)
+{
+	return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : (uint8)c;
+}
+
+static int FoldName(const char *pszName, char *pszOut, int iOutSize)
+{
+	int iLength = 0;
+
+	for (; pszName[iLength] && iLength < iOutSize - 1; iLength++)
+		pszOut[iLength] = FoldNameChar(pszName[iLength]);
+
+	pszOut[iLength] = '\0';
+	return iLength;
+}
+
+static inline int GetTrigramBucket(const char *pszTrigram)
+{
+	uint32 iHash = ((uint8)pszTrigram[0] << 16) | ((uint8)pszTrigram[1] << 8) | (uint8)pszTrigram[2];
+	return (iHash * 2654435761u) >> 20;
+}
+
+static_assert(NAME_TRIGRAM_BUCKETS == 1 << 12, "GetTrigramBucket keeps the top 12 bits of the hash");
+
+void CPlayerNameIndex::Clear()
+{
+	m_iNameMask = 0;
+	V_memset(m_szNames, 0, sizeof(m_szNames));
+	V_memset(m_szFoldedNames, 0, sizeof(m_szFoldedNames));
+	V_memset(m_iCharMasks, 0, sizeof(m_iCharMasks));
+	V_memset(m_iTrigramMasks, 0, sizeof(m_iTrigramMasks));
+}
+
+// A bucket can be shared by several trigrams of the same name, but every one of them belongs to this slot
+// so clearing the slot's bit from all of its buckets on removal never affects anyone else
+void CPlayerNameIndex::SetSlotBits(int iSlot, bool bSet)
+{
+	const char *pszFolded = m_szFoldedNames[iSlot];
+	uint64 iBit = 1ull << iSlot;
+
+	for (int i = 0; pszFolded[i]; i++)
+	{
+		uint64 &iCharMask = m_iCharMasks[(uint8)pszFolded[i]];
+		iCharMask = bSet ? iCharMask | iBit : iCharMask & ~iBit;
+
+		if (!pszFolded[i + 1] || !pszFolded[i + 2])
+			continue;
+
+		uint64 &iTrigramMask = m_iTrigramMasks[GetTrigramBucket(&pszFolded[i])];
+		iTrigramMask = bSet ? iTrigramMask | iBit : iTrigramMask & ~iBit;
+	}
+}
+
+void CPlayerNameIndex::SetName(int iSlot, const char *pszName)
+{
+	if (iSlot < 0 || iSlot >= MAXPLAYERS)
+		return;
+
+	if ((m_iNameMask & (1ull << iSlot)) && !V_strcmp(m_szNames[iSlot], pszName))
+		return;
+
+	RemoveName(iSlot);
+
+	V_strncpy(m_szNames[iSlot], pszName, sizeof(m_szNames[iSlot]));
+	FoldName(pszName, m_szFoldedNames[iSlot], sizeof(m_szFoldedNames[iSlot]));
+
+	SetSlotBits(iSlot, true);
+	m_iNameMask |= 1ull << iSlot;
+}
+
+void CPlayerNameIndex::RemoveName(int iSlot)
+{
+	if (iSlot < 0 || iSlot >= MAXPLAYERS || !(m_iNameMask & (1ull << iSlot)))
+		return;
+
+	SetSlotBits(iSlot, false);
+	m_iNameMask &= ~(1ull << iSlot);
+	m_szNames[iSlot][0] = '\0';
+	m_szFoldedNames[iSlot][0] = '\0';
+}
+
+uint64 CPlayerNameIndex::FindMatches(const char *pszQuery, bool bExact) const
+{
+	char szFolded[PLAYER_NAME_LENGTH];
+
+	// Nothing stored can be this long, and an exact match couldn't be cut off either
+	if (V_strlen(pszQuery) >= PLAYER_NAME_LENGTH)
+		return 0;
+
+	int iLength = FoldName(pszQuery, szFolded, sizeof(szFolded));
+	uint64 iCandidates = m_iNameMask;
+
+	// V_stristr never matches an empty search string, so only an empty name can match it
+	if (!iLength)
+		bExact = true;
+
+	if (iLength < 3)
+	{
+		for (int i = 0; i < iLength; i++)
+			iCandidates &= m_iCharMasks[(uint8)szFolded[i]];
+	}
+	else
+	{
+		for (int i = 0; i + 2 < iLength && iCandidates; i++)
+			iCandidates &= m_iTrigramMasks[GetTrigramBucket(&szFolded[i])];
+	}
+
+	// The masks only rule names out, whatever is left still has to be compared
+	uint64 iMatches = 0;
+
+	for (; iCandidates; iCandidates &= iCandidates - 1)
+	{
+		int iSlot = std::countr_zero(iCandidates);
+
+		if (bExact ? !V_strcmp(m_szNames[iSlot], pszQuery) : !!V_strstr(m_szFoldedNames[iSlot], szFolded))
+			iMatches |= 1ull << iSlot;
+	}
+
+	return iMatches;
+}
+
+// What GetPlayersFromString used to do for every slot before the index, minus the controller lookups
+static uint64 ScanNames(const char (*pszNames)[PLAYER_NAME_LENGTH], uint64 iNameMask, const char *pszQuery, bool bExact)
+{
+	uint64 iMatches = 0;
+
+	for (int i = 0; i < MAXPLAYERS; i++)
+	{
+		if (!(iNameMask & (1ull << i)))
+			continue;
+
+		if ((!bExact && V_stristr(pszNames[i], pszQuery)) || !V_strcmp(pszNames[i], pszQuery))
+			iMatches |= 1ull << i;
+	}
+
+	return iMatches;
+}
+
+CON_COMMAND_F(cs2f_name_index_bench, "Compare partial name lookups through the name index against a scan of every name, using 64 synthetic names", FCVAR_SPONLY | FCVAR_LINKED_CONCOMMAND)
+{
+	int iIterations = args.ArgC() > 1 ? V_StringToInt32(args[1], 20000) : 20000;
+
+	if (iIterations < 1)
+		iIterations = 1;
+
+	static const char *rgpszWords[] = { "Zombie", "Hunter", "xX_", "Sniper", "Mr.", "Pro", "Noob", "Dark", "Knight", "Ghost",
+										"Tiger", "Frost", "Pixel", "Rogue", "Storm", "Wolf" };
+	static const char *rgpszQueries[] = { "zomb", "HUNTER", "xx_", "ghost12", "wolf", "ro", "a", "knight7", "nobodyhasthis", "mr.pixel", "&Dark3", "3" };
+
+	// Heap allocated, the index is too big for the stack
+	CPlayerNameIndex *pIndex = new CPlayerNameIndex();
+	char (*pszNames)[PLAYER_NAME_LENGTH] = new char[MAXPLAYERS][PLAYER_NAME_LENGTH];
+
+	for (int i = 0; i < MAXPLAYERS; i++)
+	{
+		V_snprintf(pszNames[i], PLAYER_NAME_LENGTH, "%s%s%i", rgpszWords[i % std::size(rgpszWords)],
+				   rgpszWords[(i * 7 + 3) % std::size(rgpszWords)], i);
+		pIndex->SetName(i, pszNames[i]);
+	}
+
+	uint64 iNameMask = pIndex->GetNameMask();
+	int iMismatches = 0;
+
+	for (const char *pszQuery : rgpszQueries)
+	{
+		bool bExact = *pszQuery == '&';
+		const char *pszName = bExact ? pszQuery + 1 : pszQuery;
+
+		if (ScanNames(pszNames, iNameMask, pszName, bExact) != pIndex->FindMatches(pszName, bExact))
+		{
+			Message("Name index disagrees with a scan for \"%s\"\n", pszQuery);
+			iMismatches++;
+		}
+	}
+
+	// Keeps the compiler from throwing the lookups away
+	volatile uint64 iSink = 0;
+	double flStart = Plat_FloatTime();
+
+	for (int i = 0; i < iIterations; i++)
+	{
+		for (const char *pszQuery : rgpszQueries)
+			iSink = iSink ^ ScanNames(pszNames, iNameMask, pszQuery, false);
+	}
+
+	double flScan = Plat_FloatTime() - flStart;
+	flStart = Plat_FloatTime();
+
+	for (int i = 0; i < iIterations; i++)
+	{
+		for (const char *pszQuery : rgpszQueries)
+			iSink = iSink ^ pIndex->FindMatches(pszQuery, false);
+	}
+
+	double flIndex = Plat_FloatTime() - flStart;
+	double flQueries = (double)iIterations * std::size(rgpszQueries);
+
+	Message("Name lookups over %i names, %.0f queries: scan %.1f ns/query, index %.1f ns/query (%.1fx), %i mismatches\n",
+			MAXPLAYERS, flQueries, flScan * 1e9 / flQueries, flIndex * 1e9 / flQueries, flIndex > 0 ? flScan / flIndex : 0.0, iMismatches);
+
+	delete[] pszNames;
+	delete pIndex;
+}
@@ -0,0 +1,54 @@
+/**
+ * =============================================================================
+ * CS2Fixes
+ * Copyright (C) 2023-2024 Source2ZE
+ * =============================================================================
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License, version 3.0, as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "common.h"
+
+// Same size as CBasePlayerController::m_iszPlayerName
+#define PLAYER_NAME_LENGTH 128
+#define NAME_TRIGRAM_BUCKETS 4096
+
+// Case folded copy of every player's name, with a slot mask per character and per trigram bucket
+// so partial name targetting only has to look at players whose names can actually contain the query
+class CPlayerNameIndex
+{
+public:
+	CPlayerNameIndex() { Clear(); }
+
+	void Clear();
+	void SetName(int iSlot, const char *pszName);
+	void RemoveName(int iSlot);
+
+	// Slots whose name contains pszQuery case insensitively (like V_stristr), or is exactly pszQuery if bExact
+	uint64 FindMatches(const char *pszQuery, bool bExact) const;
+
+	const char *GetName(int iSlot) const { return m_szNames[iSlot]; }
+	uint64 GetNameMask() const { return m_iNameMask; }
+
+private:
+	void SetSlotBits(int iSlot, bool bSet);
+
+	uint64 m_iNameMask;
+	char m_szNames[MAXPLAYERS][PLAYER_NAME_LENGTH];
+	char m_szFoldedNames[MAXPLAYERS][PLAYER_NAME_LENGTH];
+	uint64 m_iCharMasks[256];
+	uint64 m_iTrigramMasks[NAME_TRIGRAM_BUCKETS];
+};
+
+extern CPlayerNameIndex g_playerNameIndex;
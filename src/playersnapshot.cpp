@@ -0,0 +1,283 @@
+/**
+ * =============================================================================
+ * CS2Fixes
+ * Copyright (C) 2023-2024 Source2ZE
+ * =============================================================================
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License, version 3.0, as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "playersnapshot.h"
+#include "entity/ccsplayercontroller.h"
+#include "entity/ccsplayerpawn.h"
+#include "playermanager.h"
+#include "tier0/vprof.h"
+
+#include "tier0/memdbgon.h"
+
+extern CGameEntitySystem *g_pEntitySystem;
+extern CGlobalVars *gpGlobals;
+extern CPlayerManager *g_playerManager;
+
+CPlayerSnapshot g_playerSnapshot;
+
+void CPlayerSnapshot::Clear()
+{
+	V_memset(this, 0, sizeof(*this));
+	m_iTransmitTick = -1;
+}
+
+void CPlayerSnapshot::ClearSlot(int slot)
+{
+	uint64 iBit = SLOT_BIT(slot);
+
+	m_iValidMask &= ~iBit;
+	m_iConnectedMask &= ~iBit;
+	m_iHLTVMask &= ~iBit;
+	m_iPawnMask &= ~iBit;
+	m_iPlayerPawnMask &= ~iBit;
+	m_iAliveMask &= ~iBit;
+	m_iObserverMask &= ~iBit;
+
+	for (int i = 0; i < TEAM_MASK_COUNT; i++)
+		m_iTeamMask[i] &= ~iBit;
+
+	m_pController[slot] = nullptr;
+	m_pPawn[slot] = nullptr;
+	m_pPlayerPawn[slot] = nullptr;
+	m_pObserverTarget[slot] = nullptr;
+}
+
+static CBaseEntity *GetObserverTarget(CBasePlayerPawn *pPawn)
+{
+	CPlayer_ObserverServices *pObserverServices = pPawn->m_pObserverServices;
+
+	if (!pObserverServices)
+		return nullptr;
+
+	return pObserverServices->m_hObserverTarget().Get();
+}
+
+void CPlayerSnapshot::Update()
+{
+	Clear();
+
+	if (!g_pEntitySystem || !gpGlobals)
+		return;
+
+	VPROF("CPlayerSnapshot::Update");
+
+	for (int i = 0; i < gpGlobals->maxClients; i++)
+	{
+		CCSPlayerController *pController = CCSPlayerController::FromSlot(i);
+
+		if (!pController)
+			continue;
+
+		uint64 iBit = SLOT_BIT(i);
+		int iTeam = pController->m_iTeamNum;
+
+		m_iValidMask |= iBit;
+		m_pController[i] = pController;
+		m_iTeam[i] = iTeam;
+		m_iPawnState[i] = STATE_WELCOME;
+
+		if (iTeam >= 0 && iTeam < TEAM_MASK_COUNT)
+			m_iTeamMask[iTeam] |= iBit;
+
+		if (pController->IsConnected())
+			m_iConnectedMask |= iBit;
+
+		if (pController->m_bIsHLTV)
+			m_iHLTVMask |= iBit;
+
+		CCSPlayerPawn *pPlayerPawn = pController->GetPlayerPawn();
+
+		if (pPlayerPawn)
+		{
+			m_iPlayerPawnMask |= iBit;
+			m_pPlayerPawn[i] = pPlayerPawn;
+
+			if (pPlayerPawn->IsAlive())
+				m_iAliveMask |= iBit;
+		}
+
+		CBasePlayerPawn *pPawn = pController->GetPawn();
+
+		if (!pPawn)
+			continue;
+
+		m_iPawnMask |= iBit;
+		m_pPawn[i] = pPawn;
+
+		// All CS2 pawns are derived from this
+		m_iPawnState[i] = ((CCSPlayerPawnBase *)pPawn)->m_iPlayerState();
+
+		if (m_iPawnState[i] == STATE_OBSERVER_MODE)
+		{
+			m_iObserverMask |= iBit;
+			m_pObserverTarget[i] = GetObserverTarget(pPawn);
+		}
+
+		Vector vecOrigin = pPawn->GetAbsOrigin();
+		m_flOriginX[i] = vecOrigin.x;
+		m_flOriginY[i] = vecOrigin.y;
+		m_flOriginZ[i] = vecOrigin.z;
+
+		CPlayer_MovementServices *pMovementServices = pPawn->m_pMovementServices;
+
+		if (pMovementServices)
+		{
+			uint64 *pButtons = pMovementServices->m_nButtons().m_pButtonStates();
+			m_iButtons[0][i] = pButtons[0];
+			m_iButtons[1][i] = pButtons[1];
+		}
+	}
+}
+
+void CPlayerSnapshot::UpdatePawnStates()
+{
+	VPROF("CPlayerSnapshot::UpdatePawnStates");
+
+	m_iObserverMask = 0;
+
+	for (uint64 iMask = m_iValidMask; iMask; iMask &= iMask - 1)
+	{
+		int i = std::countr_zero(iMask);
+		CBasePlayerPawn *pPawn = m_pController[i]->GetPawn();
+
+		m_pPawn[i] = pPawn;
+		m_pObserverTarget[i] = nullptr;
+
+		if (!pPawn)
+		{
+			m_iPawnMask &= ~SLOT_BIT(i);
+			m_iPawnState[i] = STATE_WELCOME;
+			continue;
+		}
+
+		m_iPawnMask |= SLOT_BIT(i);
+		m_iPawnState[i] = ((CCSPlayerPawnBase *)pPawn)->m_iPlayerState();
+
+		if (m_iPawnState[i] == STATE_OBSERVER_MODE)
+		{
+			m_iObserverMask |= SLOT_BIT(i);
+			m_pObserverTarget[i] = GetObserverTarget(pPawn);
+		}
+	}
+}
+
+void CPlayerSnapshot::OnEntityDeleted(CEntityInstance *pEntity)
+{
+	for (uint64 iMask = m_iValidMask; iMask; iMask &= iMask - 1)
+	{
+		int i = std::countr_zero(iMask);
+
+		if (m_pController[i] == pEntity)
+		{
+			ClearSlot(i);
+			continue;
+		}
+
+		if (m_pPawn[i] == pEntity)
+		{
+			m_pPawn[i] = nullptr;
+			m_iPawnMask &= ~SLOT_BIT(i);
+		}
+
+		if (m_pPlayerPawn[i] == pEntity)
+		{
+			m_pPlayerPawn[i] = nullptr;
+			m_iPlayerPawnMask &= ~SLOT_BIT(i);
+			m_iAliveMask &= ~SLOT_BIT(i);
+		}
+
+		if (m_pObserverTarget[i] == pEntity)
+			m_pObserverTarget[i] = nullptr;
+	}
+}
+
+void CPlayerSnapshot::UpdateTransmitState(int iTick)
+{
+	if (m_iTransmitTick == iTick)
+		return;
+
+	VPROF("CPlayerSnapshot::UpdateTransmitState");
+
+	m_iTransmitTick = iTick;
+	m_iZEPlayerMask = 0;
+	m_iTransmitAliveMask = 0;
+	m_iHideableMask = 0;
+	m_iFlashLightMask = 0;
+
+	for (int i = 0; i < MAXPLAYERS; i++)
+	{
+		m_iHideMask[i] = 0;
+		m_iPawnEntIndex[i] = -1;
+		m_iFlashLightEntIndex[i] = -1;
+		m_iGlowModelEntIndex[i] = -1;
+		m_iObserverTargetSlot[i] = -1;
+	}
+
+	for (uint64 iMask = m_iValidMask; iMask; iMask &= iMask - 1)
+	{
+		int i = std::countr_zero(iMask);
+		uint64 iBit = SLOT_BIT(i);
+
+		if (m_pPlayerPawn[i])
+		{
+			m_iPawnEntIndex[i] = m_pPlayerPawn[i]->entindex();
+
+			if (m_pPlayerPawn[i]->IsAlive())
+				m_iTransmitAliveMask |= iBit;
+		}
+
+		if (m_pObserverTarget[i])
+		{
+			for (uint64 iTargets = m_iPawnMask; iTargets; iTargets &= iTargets - 1)
+			{
+				int j = std::countr_zero(iTargets);
+
+				if (m_pPawn[j] == m_pObserverTarget[i])
+				{
+					m_iObserverTargetSlot[i] = j;
+					break;
+				}
+			}
+		}
+
+		ZEPlayer *pPlayer = g_playerManager->GetPlayer(i);
+
+		if (!pPlayer)
+			continue;
+
+		m_iZEPlayerMask |= iBit;
+		m_iHideMask[i] = pPlayer->GetHideMask();
+
+		if (!pPlayer->IsLeader())
+			m_iHideableMask |= iBit;
+
+		CBaseModelEntity *pGlowModel = pPlayer->GetGlowModel();
+
+		if (pGlowModel)
+			m_iGlowModelEntIndex[i] = pGlowModel->entindex();
+
+		CBarnLight *pFlashLight = (m_iConnectedMask & iBit) ? pPlayer->GetFlashLight() : nullptr;
+
+		if (pFlashLight)
+		{
+			m_iFlashLightMask |= iBit;
+			m_iFlashLightEntIndex[i] = pFlashLight->entindex();
+		}
+	}
+}
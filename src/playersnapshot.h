@@ -0,0 +1,96 @@
+/**
+ * =============================================================================
+ * CS2Fixes
+ * Copyright (C) 2023-2024 Source2ZE
+ * =============================================================================
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License, version 3.0, as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "common.h"
+#include <bit>
+
+class CEntityInstance;
+class CBaseEntity;
+class CBasePlayerPawn;
+class CCSPlayerPawn;
+class CCSPlayerController;
+
+#define SLOT_BIT(slot) ((uint64)1 << (slot))
+
+// CS_TEAM_NONE through CS_TEAM_CT
+#define TEAM_MASK_COUNT 4
+
+// Player state shared by everything that runs per frame, built once per tick in ServerPreEntityThink
+// so consumers read these arrays instead of going through the entity system and schema accessors again
+// Masks have bit i set for player slot i, array entries are only meaningful for slots in m_iValidMask
+class CPlayerSnapshot
+{
+public:
+	CPlayerSnapshot() { Clear(); }
+
+	void Update();
+
+	// Pawn states change while entities think, so this refreshes only those before the post think consumers run
+	void UpdatePawnStates();
+
+	void Clear();
+	void ClearSlot(int slot);
+
+	// Forgets any pointer to an entity that's being deleted mid-tick
+	void OnEntityDeleted(CEntityInstance *pEntity);
+
+	uint64 GetTeamMask(int iTeam) { return (iTeam >= 0 && iTeam < TEAM_MASK_COUNT) ? m_iTeamMask[iTeam] : 0; }
+
+	uint64 m_iValidMask;		// Controller exists
+	uint64 m_iConnectedMask;
+	uint64 m_iHLTVMask;
+	uint64 m_iPawnMask;			// Has a current pawn, which is the observer pawn while dead
+	uint64 m_iPlayerPawnMask;	// Has an actual player pawn
+	uint64 m_iAliveMask;		// Player pawn is alive
+	uint64 m_iObserverMask;		// Current pawn is in STATE_OBSERVER_MODE
+	uint64 m_iTeamMask[TEAM_MASK_COUNT];
+
+	int m_iTeam[MAXPLAYERS];
+	uint32 m_iPawnState[MAXPLAYERS];
+	CCSPlayerController *m_pController[MAXPLAYERS];
+	CBasePlayerPawn *m_pPawn[MAXPLAYERS];
+	CCSPlayerPawn *m_pPlayerPawn[MAXPLAYERS];
+	CBaseEntity *m_pObserverTarget[MAXPLAYERS];
+
+	// Current pawn origin, split per axis so distance checks can work on all players at once
+	alignas(32) float m_flOriginX[MAXPLAYERS];
+	alignas(32) float m_flOriginY[MAXPLAYERS];
+	alignas(32) float m_flOriginZ[MAXPLAYERS];
+
+	// Button states of the current pawn's movement services
+	uint64 m_iButtons[2][MAXPLAYERS];
+
+	// Everything CheckTransmit needs, refreshed at most once per tick right before it runs
+	// since leaders, flashlights and hide masks can all change after the snapshot is taken
+	void UpdateTransmitState(int iTick);
+
+	int m_iTransmitTick;
+	uint64 m_iZEPlayerMask;
+	uint64 m_iTransmitAliveMask;	// Player pawn alive as of this update
+	uint64 m_iHideableMask;			// Players with a ZEPlayer that isn't a leader, leaders are never hidden
+	uint64 m_iFlashLightMask;		// Connected players with a flashlight
+	uint64 m_iHideMask[MAXPLAYERS];
+	int m_iPawnEntIndex[MAXPLAYERS];		// Player pawn, -1 if none
+	int m_iFlashLightEntIndex[MAXPLAYERS];	// -1 if none
+	int m_iGlowModelEntIndex[MAXPLAYERS];	// -1 if none
+	int m_iObserverTargetSlot[MAXPLAYERS];	// Slot whose current pawn is being spectated, -1 if none
+};
+
+extern CPlayerSnapshot g_playerSnapshot;
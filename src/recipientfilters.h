@@ -20,6 +20,7 @@
 #pragma once
 #include "irecipientfilter.h"
 #include "playermanager.h"
+#include <bit>
 
 // Simple filter for when only 1 recipient is needed
 class CSingleRecipientFilter : public IRecipientFilter
@@ -91,6 +92,18 @@ public:
 		}
 	}
 
+	// Players who have left since the mask was built are skipped
+	void AddRecipientsFromMask(uint64 iMask)
+	{
+		for (uint64 m = iMask; m; m &= m - 1)
+		{
+			int iSlot = std::countr_zero(m);
+
+			if (g_playerManager->GetPlayer(iSlot))
+				AddRecipient(iSlot);
+		}
+	}
+
 	void AddRecipient(CPlayerSlot slot)
 	{
 		// Don't add if it already exists
@@ -0,0 +1,592 @@
+/**
+ * =============================================================================
+ * CS2Fixes
+ * Copyright (C) 2023-2024 Source2ZE
+ * =============================================================================
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License, version 3.0, as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sharedcache.h"
+#include "adminsystem.h"
+#include "admintable.h"
+#include "common.h"
+#include "icvar.h"
+#include "playermanager.h"
+#include "tier0/platform.h"
+#include <cerrno>
+#include <chrono>
+#include <random>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "tier0/memdbgon.h"
+
+extern CGlobalVars *gpGlobals;
+
+CSharedCache g_sharedCache;
+
+static bool g_bSharedCacheEnable = false;
+FAKE_BOOL_CVAR(cs2f_shared_cache_enable, "Whether to share infraction changes and admins with other servers on this machine", g_bSharedCacheEnable, false, false)
+
+static std::string g_strSharedCacheName = "/cs2fixes_shared_cache";
+FAKE_STRING_CVAR(cs2f_shared_cache_name, "Shared memory segment to use, only servers with the same name share with each other", g_strSharedCacheName, false)
+
+bool CSharedCache::Open(const char *pszName)
+{
+	Close();
+
+#ifdef _WIN32
+	Warning("The shared cache is only supported on Linux\n");
+	return false;
+#else
+	int iFile = shm_open(pszName, O_RDWR | O_CREAT, 0660);
+
+	if (iFile < 0)
+	{
+		Warning("Failed to open shared memory segment %s\n", pszName);
+		return false;
+	}
+
+	// Whoever gets here first sizes it, zero filled is a valid empty cache
+	struct stat fileStat;
+	bool bSized = fstat(iFile, &fileStat) == 0 && (fileStat.st_size >= (off_t)sizeof(SharedCache_t) || ftruncate(iFile, sizeof(SharedCache_t)) == 0);
+	void *pMapping = bSized ? mmap(nullptr, sizeof(SharedCache_t), PROT_READ | PROT_WRITE, MAP_SHARED, iFile, 0) : MAP_FAILED;
+
+	close(iFile);
+
+	if (pMapping == MAP_FAILED)
+	{
+		Warning("Failed to map shared memory segment %s\n", pszName);
+		return false;
+	}
+
+	SharedCache_t *pCache = (SharedCache_t *)pMapping;
+	uint32 iMagic = 0;
+
+	if (pCache->iMagic.compare_exchange_strong(iMagic, SHARED_CACHE_INITIALIZING))
+	{
+		pthread_mutexattr_t mutexAttributes;
+		pthread_mutexattr_init(&mutexAttributes);
+		pthread_mutexattr_setpshared(&mutexAttributes, PTHREAD_PROCESS_SHARED);
+		pthread_mutexattr_setrobust(&mutexAttributes, PTHREAD_MUTEX_ROBUST);
+		pthread_mutex_init(&pCache->writerMutex, &mutexAttributes);
+		pthread_mutexattr_destroy(&mutexAttributes);
+
+		iMagic = SHARED_CACHE_MAGIC;
+		pCache->iMagic.store(iMagic, std::memory_order_release);
+	}
+
+	// Another server is setting it up right now
+	for (int i = 0; i < 1000 && iMagic == SHARED_CACHE_INITIALIZING; i++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		iMagic = pCache->iMagic.load(std::memory_order_acquire);
+	}
+
+	if (iMagic != SHARED_CACHE_MAGIC)
+	{
+		if (iMagic == SHARED_CACHE_INITIALIZING)
+			Warning("Shared memory segment %s was never finished being set up\n", pszName);
+		else
+			Warning("Shared memory segment %s is in use by an incompatible version\n", pszName);
+
+		munmap(pMapping, sizeof(SharedCache_t));
+		return false;
+	}
+
+	m_pCache = pCache;
+	m_strName = pszName;
+	// 0 is never used, it would match events nobody wrote
+	std::random_device random;
+
+	do
+		m_iID = ((uint64)random() << 32) ^ random() ^ (uint64)std::chrono::steady_clock::now().time_since_epoch().count();
+	while (m_iID == 0);
+
+	// Whatever happened before this server started is already in the files it loaded
+	m_nLastSequence = m_pCache->nSequence.load(std::memory_order_acquire);
+	m_nEventsSeen = m_pCache->nEvents;
+	m_nAdminGeneration = m_pCache->nAdminGeneration;
+
+	return true;
+#endif
+}
+
+void CSharedCache::Close()
+{
+	// Don't leave the other servers without what changed last
+	Flush();
+
+#ifndef _WIN32
+	if (m_pCache)
+		munmap(m_pCache, sizeof(SharedCache_t));
+#endif
+
+	m_pCache = nullptr;
+	m_vecOutbox.clear();
+	m_vecPendingAdmins.clear();
+	m_bAdminsPending = false;
+}
+
+void CSharedCache::PublishInfraction(EJournalOp nOp, const InfractionRecord_t &record)
+{
+	if (!m_pCache)
+		return;
+
+	SharedCacheEvent_t event = {};
+	event.iSteamID = record.iSteamID;
+	event.iEndTime = record.iEndTime;
+	event.iSourceID = m_iID;
+	event.iType = record.iType;
+	event.nOp = (uint8)nOp;
+
+	m_vecOutbox.push_back(event);
+}
+
+void CSharedCache::PublishAdmins(CAdminTable *pAdmins)
+{
+	if (!m_pCache || !pAdmins)
+		return;
+
+	int nAdmins = pAdmins->Count();
+
+	if (nAdmins > SHARED_CACHE_ADMINS)
+	{
+		Warning("Only the first %i of %i admins are shared with other servers\n", SHARED_CACHE_ADMINS, nAdmins);
+		nAdmins = SHARED_CACHE_ADMINS;
+	}
+
+	m_vecPendingAdmins.resize(nAdmins);
+
+	for (int i = 0; i < nAdmins; i++)
+	{
+		CAdmin *pAdmin = pAdmins->Get(i);
+		SharedCacheAdmin_t &admin = m_vecPendingAdmins[i];
+
+		admin.iSteamID = pAdmin->GetSteamID();
+		admin.iFlags = pAdmin->GetFlags();
+		admin.iImmunity = pAdmin->GetImmunity();
+		V_strncpy(admin.szName, pAdmin->GetName(), sizeof(admin.szName));
+	}
+
+	m_bAdminsPending = true;
+}
+
+bool CSharedCache::Lock()
+{
+#ifdef _WIN32
+	return false;
+#else
+	// Never waits, a writer that's busy or paused just means trying again next frame
+	int iResult = pthread_mutex_trylock(&m_pCache->writerMutex);
+
+	if (iResult == EOWNERDEAD)
+		RecoverLock();
+	else if (iResult != 0)
+		return false;
+
+	m_pCache->nSequence.fetch_add(1, std::memory_order_relaxed);
+
+	// Readers must see the odd sequence before any of the data changes
+	std::atomic_thread_fence(std::memory_order_release);
+	return true;
+#endif
+}
+
+void CSharedCache::Unlock()
+{
+#ifndef _WIN32
+	m_pCache->nSequence.fetch_add(1, std::memory_order_release);
+	pthread_mutex_unlock(&m_pCache->writerMutex);
+#endif
+}
+
+// Called holding the mutex after its last owner died with it, possibly halfway through writing
+// Counts and the snapshot's event number are written last, so what it left behind is never visible half written
+void CSharedCache::RecoverLock()
+{
+#ifndef _WIN32
+	pthread_mutex_consistent(&m_pCache->writerMutex);
+
+	// It never got to end its write
+	uint64 nSequence = m_pCache->nSequence.load(std::memory_order_relaxed);
+
+	if (nSequence & 1)
+		m_pCache->nSequence.store(nSequence + 1, std::memory_order_release);
+
+	Warning("A server died while writing to the shared cache, its last change may be lost\n");
+#endif
+}
+
+// Only a writer that died leaves the sequence odd for good, one that's alive but stalled still holds the mutex and is waited out
+void CSharedCache::CheckDeadWriter()
+{
+#ifndef _WIN32
+	int iResult = pthread_mutex_trylock(&m_pCache->writerMutex);
+
+	if (iResult == EOWNERDEAD)
+		RecoverLock();
+
+	if (iResult == 0 || iResult == EOWNERDEAD)
+		pthread_mutex_unlock(&m_pCache->writerMutex);
+#endif
+}
+
+bool CSharedCache::Flush(const std::vector<InfractionRecord_t> *pSnapshot)
+{
+	if (!m_pCache || (m_vecOutbox.empty() && !m_bAdminsPending))
+		return true;
+
+	// Try again next frame
+	if (!Lock())
+		return false;
+
+	// Counts go last so a writer that dies halfway leaves nothing half written visible
+	for (const SharedCacheEvent_t &event : m_vecOutbox)
+	{
+		m_pCache->rgEvents[m_pCache->nEvents % SHARED_CACHE_EVENTS] = event;
+		m_pCache->nEvents++;
+	}
+
+	if (pSnapshot && pSnapshot->size() > SHARED_CACHE_INFRACTIONS)
+	{
+		// A partial snapshot would look like unbans to whoever catches up from it
+		m_pCache->nSnapshotEvents = 0;
+	}
+	else if (pSnapshot)
+	{
+		// Nobody can catch up from it while it's being overwritten, even if this writer dies halfway
+		m_pCache->nSnapshotEvents = 0;
+
+		for (size_t i = 0; i < pSnapshot->size(); i++)
+			m_pCache->rgSnapshot[i] = {(*pSnapshot)[i].iSteamID, (int64)(*pSnapshot)[i].iEndTime, (*pSnapshot)[i].iType, 0};
+
+		m_pCache->nSnapshotInfractions = pSnapshot->size();
+		m_pCache->nSnapshotEvents = m_pCache->nEvents;
+	}
+
+	if (m_bAdminsPending)
+	{
+		memcpy(m_pCache->rgAdmins, m_vecPendingAdmins.data(), m_vecPendingAdmins.size() * sizeof(SharedCacheAdmin_t));
+		m_pCache->nAdmins = m_vecPendingAdmins.size();
+		m_pCache->iAdminSourceID = m_iID;
+		m_pCache->nAdminGeneration++;
+	}
+
+	Unlock();
+
+	m_vecOutbox.clear();
+	m_vecPendingAdmins.clear();
+	m_bAdminsPending = false;
+
+	return true;
+}
+
+bool CSharedCache::ReadChanges(std::vector<SharedCacheEvent_t> &vecEvents, std::vector<SharedCacheAdmin_t> &vecAdmins, std::vector<InfractionRecord_t> &vecSnapshot,
+							   bool &bAdminsChanged, bool &bResync)
+{
+	vecEvents.clear();
+	vecAdmins.clear();
+	vecSnapshot.clear();
+	bAdminsChanged = false;
+	bResync = false;
+
+	if (!m_pCache)
+		return false;
+
+	// Nearly every frame ends here
+	uint64 nSequence = m_pCache->nSequence.load(std::memory_order_acquire);
+
+	if (nSequence == m_nLastSequence)
+		return false;
+
+	if (nSequence & 1)
+	{
+		CheckDeadWriter();
+		return false;
+	}
+
+	// Anything read here can be torn until the sequence is checked again, so it's only ever used to stay in bounds
+	uint64 nEvents = m_pCache->nEvents;
+	uint64 nAdminGeneration = m_pCache->nAdminGeneration;
+	uint64 iAdminSourceID = m_pCache->iAdminSourceID;
+	uint32 nAdmins = m_pCache->nAdmins;
+
+	if (nEvents - m_nEventsSeen > SHARED_CACHE_EVENTS)
+	{
+		bResync = true;
+
+		uint64 nSnapshotEvents = m_pCache->nSnapshotEvents;
+		uint32 nSnapshot = m_pCache->nSnapshotInfractions;
+		uint64 iFirstEvent = nEvents - SHARED_CACHE_EVENTS;
+
+		// Carry on from the snapshot, or from the oldest event left if even that is too old
+		if (nSnapshotEvents != 0 && nSnapshotEvents <= nEvents)
+		{
+			for (uint32 i = 0; i < nSnapshot && i < SHARED_CACHE_INFRACTIONS; i++)
+				vecSnapshot.push_back({m_pCache->rgSnapshot[i].iSteamID, (time_t)m_pCache->rgSnapshot[i].iEndTime, m_pCache->rgSnapshot[i].iType});
+
+			if (nSnapshotEvents > iFirstEvent)
+				iFirstEvent = nSnapshotEvents;
+		}
+
+		for (uint64 i = iFirstEvent; i != nEvents; i++)
+			vecEvents.push_back(m_pCache->rgEvents[i % SHARED_CACHE_EVENTS]);
+	}
+	else
+	{
+		for (uint64 i = m_nEventsSeen; i != nEvents; i++)
+			vecEvents.push_back(m_pCache->rgEvents[i % SHARED_CACHE_EVENTS]);
+	}
+
+	if (nAdminGeneration != m_nAdminGeneration && iAdminSourceID != m_iID)
+	{
+		bAdminsChanged = true;
+		vecAdmins.assign(m_pCache->rgAdmins, m_pCache->rgAdmins + (nAdmins < SHARED_CACHE_ADMINS ? nAdmins : SHARED_CACHE_ADMINS));
+	}
+
+	std::atomic_thread_fence(std::memory_order_acquire);
+
+	// Somebody wrote in the meantime, it'll all be read again next frame
+	if (m_pCache->nSequence.load(std::memory_order_relaxed) != nSequence)
+	{
+		vecEvents.clear();
+		vecAdmins.clear();
+		vecSnapshot.clear();
+		bAdminsChanged = false;
+		bResync = false;
+		return false;
+	}
+
+	m_nLastSequence = nSequence;
+	m_nEventsSeen = nEvents;
+	m_nAdminGeneration = nAdminGeneration;
+
+	return true;
+}
+
+void CSharedCache::RunFrame()
+{
+	if (g_bSharedCacheEnable != IsOpen() || (IsOpen() && m_strName != g_strSharedCacheName))
+	{
+		Close();
+
+		if (g_bSharedCacheEnable && Open(g_strSharedCacheName.c_str()))
+		{
+			Message("Sharing infractions and admins through %s\n", m_strName.c_str());
+			PublishAdmins(g_pAdminSystem->GetAdmins());
+		}
+		else if (g_bSharedCacheEnable)
+		{
+			// Rather than trying again every frame
+			g_bSharedCacheEnable = false;
+		}
+	}
+
+	if (!m_pCache)
+		return;
+
+	std::vector<SharedCacheEvent_t> vecEvents;
+	std::vector<SharedCacheAdmin_t> vecAdmins;
+	std::vector<InfractionRecord_t> vecSnapshot;
+	bool bAdminsChanged = false, bResync = false;
+
+	ReadChanges(vecEvents, vecAdmins, vecSnapshot, bAdminsChanged, bResync);
+
+	if (bResync)
+	{
+		// The files have every change applied here until it fell behind, the snapshot has what came after
+		// An unban missed in between can't be told apart from an infraction only this server knows about, so that one stays
+		if (vecSnapshot.empty())
+			Warning("Fell behind on the shared cache and there's no snapshot to catch up from, some changes from other servers are missing\n");
+		else
+			Warning("Fell behind on the shared cache, catching up from its snapshot\n");
+
+		g_pAdminSystem->LoadInfractions();
+
+		for (int i = 0; i < gpGlobals->maxClients; i++)
+		{
+			ZEPlayer* pPlayer = g_playerManager->GetPlayer(i);
+
+			if (pPlayer && !pPlayer->IsFakeClient())
+				pPlayer->CheckInfractions();
+		}
+
+		for (const InfractionRecord_t &record : vecSnapshot)
+			g_pAdminSystem->ApplySharedInfraction(EJournalOp::ADD, record);
+	}
+
+	for (const SharedCacheEvent_t &event : vecEvents)
+	{
+		if (event.iSourceID != m_iID)
+			g_pAdminSystem->ApplySharedInfraction((EJournalOp)event.nOp, {event.iSteamID, (time_t)event.iEndTime, event.iType});
+	}
+
+	// Only once every change from the others is in, otherwise the snapshot would undo them for whoever catches up from it
+	if (!m_vecOutbox.empty() && m_nLastSequence == m_pCache->nSequence.load(std::memory_order_acquire))
+	{
+		std::vector<InfractionRecord_t> vecInfractions;
+		g_pAdminSystem->GetInfractionRecords(vecInfractions);
+		Flush(&vecInfractions);
+	}
+	else
+	{
+		Flush();
+	}
+
+	if (bAdminsChanged)
+	{
+		CAdminTable *pAdmins = new CAdminTable();
+
+		for (const SharedCacheAdmin_t &admin : vecAdmins)
+			pAdmins->AddAdmin(admin.szName, admin.iSteamID, admin.iFlags, admin.iImmunity);
+
+		g_pAdminSystem->SetAdmins(pAdmins);
+		g_pAdminSystem->ReapplyAdmins();
+
+		Message("Admins updated by another server, %i admins\n", pAdmins->Count());
+	}
+}
+
+CON_COMMAND_F(cs2f_shared_cache_status, "Show the state of the shared infraction and admin cache", FCVAR_SPONLY | FCVAR_LINKED_CONCOMMAND)
+{
+	if (!g_sharedCache.IsOpen())
+	{
+		Message("The shared cache is not open\n");
+		return;
+	}
+
+	Message("Sequence %llu, %llu infraction changes seen, admin list generation %llu\n",
+			g_sharedCache.GetSequence(), g_sharedCache.GetEventCount(), g_sharedCache.GetAdminGeneration());
+}
+
+CON_COMMAND_F(cs2f_shared_cache_test, "Write to a test segment from one thread while reading it from another and check nothing is ever seen torn", FCVAR_SPONLY | FCVAR_LINKED_CONCOMMAND)
+{
+#ifdef _WIN32
+	Message("The shared cache is only supported on Linux\n");
+#else
+	const char *pszName = "/cs2fixes_shared_cache_test";
+	const uint64 nTotalEvents = 200000;
+	CSharedCache writer, reader;
+
+	shm_unlink(pszName);
+
+	if (!writer.Open(pszName) || !reader.Open(pszName))
+	{
+		shm_unlink(pszName);
+		return;
+	}
+
+	std::atomic<bool> bDone{false};
+
+	// Events carry consecutive SteamIDs, and every admin in a generation has the same flags and a name matching its SteamID
+	std::thread writerThread([&]() {
+		uint64 nWritten = 0, iRandom = 1;
+
+		for (int iBatch = 0; nWritten < nTotalEvents; iBatch++)
+		{
+			iRandom = iRandom * 6364136223846793005ull + 1442695040888963407ull;
+			int nBatch = 1 + (iRandom >> 33) % 64;
+
+			for (int i = 0; i < nBatch && nWritten < nTotalEvents; i++, nWritten++)
+				writer.PublishInfraction(EJournalOp::ADD, {nWritten + 1, 0, 0});
+
+			if (iBatch % 64 == 0)
+			{
+				CAdminTable admins;
+				int nAdmins = 1 + (iRandom >> 40) % SHARED_CACHE_ADMINS;
+
+				for (int i = 0; i < nAdmins; i++)
+					admins.AddAdmin(std::to_string(i + 1).c_str(), i + 1, iBatch, 0);
+
+				writer.PublishAdmins(&admins);
+			}
+
+			// Stands in for every infraction there is, the newest event is all the reader needs to check it against
+			std::vector<InfractionRecord_t> vecSnapshot = {{nWritten, 0, 0}};
+
+			while (!writer.Flush(&vecSnapshot))
+				std::this_thread::yield();
+
+			// Far more often than servers would ever write, but leaves the reader room to keep up
+			std::this_thread::sleep_for(std::chrono::microseconds(20));
+		}
+
+		bDone = true;
+	});
+
+	std::vector<SharedCacheEvent_t> vecEvents;
+	std::vector<SharedCacheAdmin_t> vecAdmins;
+	std::vector<InfractionRecord_t> vecSnapshot;
+	bool bAdminsChanged, bResync;
+	uint64 iNextSteamID = 1, nReads = 0, nResyncs = 0, nAdminLists = 0, nWrong = 0;
+
+	while (true)
+	{
+		bool bFinished = bDone;
+
+		if (reader.ReadChanges(vecEvents, vecAdmins, vecSnapshot, bAdminsChanged, bResync))
+		{
+			nReads++;
+
+			// Fell behind, the events have to carry on right after the last one the snapshot has
+			if (bResync)
+			{
+				nResyncs++;
+				iNextSteamID = vecSnapshot.empty() ? 0 : vecSnapshot[0].iSteamID + 1;
+			}
+
+			for (const SharedCacheEvent_t &event : vecEvents)
+			{
+				if (iNextSteamID && event.iSteamID != iNextSteamID)
+					nWrong++;
+
+				iNextSteamID = event.iSteamID + 1;
+			}
+
+			if (bAdminsChanged)
+			{
+				nAdminLists++;
+
+				for (size_t i = 0; i < vecAdmins.size(); i++)
+				{
+					if (vecAdmins[i].iSteamID != i + 1 || vecAdmins[i].iFlags != vecAdmins[0].iFlags || strtoull(vecAdmins[i].szName, nullptr, 10) != i + 1)
+						nWrong++;
+				}
+			}
+		}
+		else if (bFinished)
+		{
+			break;
+		}
+	}
+
+	writerThread.join();
+
+	if (iNextSteamID != nTotalEvents + 1)
+		nWrong++;
+
+	Message("%llu reads, %llu admin lists, %llu resyncs, %llu wrong\n", nReads, nAdminLists, nResyncs, nWrong);
+
+	writer.Close();
+	reader.Close();
+	shm_unlink(pszName);
+#endif
+}
@@ -0,0 +1,143 @@
+/**
+ * =============================================================================
+ * CS2Fixes
+ * Copyright (C) 2023-2024 Source2ZE
+ * =============================================================================
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License, version 3.0, as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "platform.h"
+#include "infractionjournal.h"
+#include <atomic>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+#define SHARED_CACHE_MAGIC 0x43325304 // "C2S" and the layout version
+#define SHARED_CACHE_INITIALIZING 1
+#define SHARED_CACHE_EVENTS 8192
+#define SHARED_CACHE_ADMINS 4096
+#define SHARED_CACHE_INFRACTIONS 65536
+
+class CAdminTable;
+
+struct SharedCacheEvent_t
+{
+	uint64 iSteamID;
+	int64 iEndTime;
+	uint64 iSourceID; // Instance that made the change
+	int16 iType;
+	uint8 nOp; // EJournalOp
+	uint8 iReserved[5];
+};
+
+struct SharedCacheInfraction_t
+{
+	uint64 iSteamID;
+	int64 iEndTime;
+	int32 iType;
+	uint32 iReserved;
+};
+
+struct SharedCacheAdmin_t
+{
+	uint64 iSteamID;
+	uint64 iFlags;
+	int32 iImmunity;
+	char szName[44];
+};
+
+// Laid out the same in every process, whoever maps it first sets up the mutex and everything else starts out zeroed
+struct SharedCache_t
+{
+	std::atomic<uint32> iMagic;
+	uint32 iReserved;
+	std::atomic<uint64> nSequence; // Seqlock for readers, odd while someone is writing
+#ifndef _WIN32
+	pthread_mutex_t writerMutex; // Robust and process shared, only one writer at a time and a dead one is detected by the kernel
+#endif
+
+	// Everything below is only written while holding writerMutex with nSequence odd
+	uint64 nEvents; // Ever written, event i is in rgEvents[i % SHARED_CACHE_EVENTS]
+	uint64 nAdminGeneration;
+	uint64 iAdminSourceID;
+	uint32 nAdmins;
+	uint32 nSnapshotInfractions;
+	uint64 nSnapshotEvents; // rgSnapshot is every infraction once the first nSnapshotEvents events happened, 0 if there's none
+	SharedCacheEvent_t rgEvents[SHARED_CACHE_EVENTS];
+	SharedCacheAdmin_t rgAdmins[SHARED_CACHE_ADMINS];
+	SharedCacheInfraction_t rgSnapshot[SHARED_CACHE_INFRACTIONS];
+};
+
+static_assert(std::atomic<uint64>::is_always_lock_free, "The seqlock has to work across processes");
+
+// Shares infraction changes and the admin list between every server on this machine through a POSIX shared memory segment
+// Each server still loads and saves its own files, the segment only carries what changed since, so a ban on one server
+// takes effect on the others by their next frame, and each of them journals it as well so it outlives a restart.
+// Whoever writes changes also leaves a snapshot of every infraction, for a server that fell too far behind to catch up from.
+// The last server to load admins.cfg sets the admins for all of them
+class CSharedCache
+{
+public:
+	~CSharedCache() { Close(); }
+
+	bool Open(const char *pszName);
+	void Close();
+	bool IsOpen() { return m_pCache != nullptr; }
+
+	// Queued and written at the end of the frame, so a burst of changes takes the lock once
+	void PublishInfraction(EJournalOp nOp, const InfractionRecord_t &record);
+	void PublishAdmins(CAdminTable *pAdmins);
+
+	// pSnapshot has to be every infraction this server has, including all the others' changes up to now
+	bool Flush(const std::vector<InfractionRecord_t> *pSnapshot = nullptr);
+
+	// Whatever the others wrote since the last call, false if there's nothing new or it has to wait for a writer
+	// bResync means this fell too far behind and has to go back to the files plus vecSnapshot, vecEvents then carry on from the snapshot
+	bool ReadChanges(std::vector<SharedCacheEvent_t> &vecEvents, std::vector<SharedCacheAdmin_t> &vecAdmins, std::vector<InfractionRecord_t> &vecSnapshot,
+					 bool &bAdminsChanged, bool &bResync);
+
+	// Opens or closes the segment to follow cs2f_shared_cache_enable, then applies what the other servers changed
+	void RunFrame();
+
+	uint64 GetSequence() { return m_pCache ? m_pCache->nSequence.load(std::memory_order_relaxed) : 0; }
+	uint64 GetEventCount() { return m_nEventsSeen; }
+	uint64 GetAdminGeneration() { return m_nAdminGeneration; }
+
+private:
+	bool Lock();
+	void Unlock();
+	void RecoverLock();
+	void CheckDeadWriter();
+
+	SharedCache_t *m_pCache = nullptr;
+	std::string m_strName;
+
+	// Random for every Open, process IDs repeat across containers sharing /dev/shm
+	uint64 m_iID = 0;
+
+	uint64 m_nLastSequence = 0;
+	uint64 m_nEventsSeen = 0;
+	uint64 m_nAdminGeneration = 0;
+
+	std::vector<SharedCacheEvent_t> m_vecOutbox;
+	std::vector<SharedCacheAdmin_t> m_vecPendingAdmins;
+	bool m_bAdminsPending = false;
+};
+
+extern CSharedCache g_sharedCache;
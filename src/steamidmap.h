@@ -0,0 +1,168 @@
+/**
+ * =============================================================================
+ * CS2Fixes
+ * Copyright (C) 2023-2024 Source2ZE
+ * =============================================================================
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License, version 3.0, as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "platform.h"
+#include "utlvector.h"
+
+// Open addressing hash map keyed by SteamID64 with linear probing, 0 is never a valid SteamID so it marks empty entries
+// Removal shifts the following entries back instead of leaving tombstones, so lookups never slow down over a long map
+template <typename T>
+class CSteamIDMap
+{
+public:
+	CSteamIDMap() { Clear(); }
+
+	void Clear(int nExpected = 0)
+	{
+		int nCapacity = 16;
+
+		// Stay at or under half full
+		while (nCapacity < nExpected * 2)
+			nCapacity *= 2;
+
+		m_vecEntries.SetCount(nCapacity);
+
+		FOR_EACH_VEC(m_vecEntries, i)
+			m_vecEntries[i].iSteamID = 0;
+
+		m_nCount = 0;
+	}
+
+	int Count() const { return m_nCount; }
+
+	T *Find(uint64 iSteamID)
+	{
+		if (!iSteamID)
+			return nullptr;
+
+		uint32 iMask = m_vecEntries.Count() - 1;
+
+		for (uint32 i = HashSteamID(iSteamID) & iMask; m_vecEntries[i].iSteamID; i = (i + 1) & iMask)
+		{
+			if (m_vecEntries[i].iSteamID == iSteamID)
+				return &m_vecEntries[i].value;
+		}
+
+		return nullptr;
+	}
+
+	// Returns false without changing anything if the SteamID is already in the map
+	bool Insert(uint64 iSteamID, const T &value)
+	{
+		if (!iSteamID || Find(iSteamID))
+			return false;
+
+		if ((m_nCount + 1) * 2 > m_vecEntries.Count())
+			Grow();
+
+		InsertNew(iSteamID, value);
+		return true;
+	}
+
+	void Set(uint64 iSteamID, const T &value)
+	{
+		if (T *pValue = Find(iSteamID))
+			*pValue = value;
+		else
+			Insert(iSteamID, value);
+	}
+
+	bool Remove(uint64 iSteamID)
+	{
+		if (!iSteamID)
+			return false;
+
+		uint32 iMask = m_vecEntries.Count() - 1;
+		uint32 i = HashSteamID(iSteamID) & iMask;
+
+		for (; m_vecEntries[i].iSteamID != iSteamID; i = (i + 1) & iMask)
+		{
+			if (!m_vecEntries[i].iSteamID)
+				return false;
+		}
+
+		// Pull back every entry after the hole that would otherwise no longer be reachable from its home slot
+		for (uint32 j = (i + 1) & iMask; m_vecEntries[j].iSteamID; j = (j + 1) & iMask)
+		{
+			uint32 iHome = HashSteamID(m_vecEntries[j].iSteamID) & iMask;
+
+			if (((j - iHome) & iMask) >= ((j - i) & iMask))
+			{
+				m_vecEntries[i] = m_vecEntries[j];
+				i = j;
+			}
+		}
+
+		m_vecEntries[i].iSteamID = 0;
+		m_nCount--;
+		return true;
+	}
+
+private:
+	struct Entry_t
+	{
+		uint64 iSteamID;
+		T value;
+	};
+
+	// SteamIDs only really differ in their low 32 bits, mix everything down so nearby account IDs spread out
+	static uint32 HashSteamID(uint64 iSteamID)
+	{
+		iSteamID ^= iSteamID >> 33;
+		iSteamID *= 0xff51afd7ed558ccdull;
+		iSteamID ^= iSteamID >> 33;
+		return (uint32)iSteamID;
+	}
+
+	void InsertNew(uint64 iSteamID, const T &value)
+	{
+		uint32 iMask = m_vecEntries.Count() - 1;
+		uint32 i = HashSteamID(iSteamID) & iMask;
+
+		while (m_vecEntries[i].iSteamID)
+			i = (i + 1) & iMask;
+
+		m_vecEntries[i].iSteamID = iSteamID;
+		m_vecEntries[i].value = value;
+		m_nCount++;
+	}
+
+	void Grow()
+	{
+		CUtlVector<Entry_t> vecOld;
+		vecOld.Swap(m_vecEntries);
+
+		m_vecEntries.SetCount(vecOld.Count() * 2);
+
+		FOR_EACH_VEC(m_vecEntries, i)
+			m_vecEntries[i].iSteamID = 0;
+
+		m_nCount = 0;
+
+		FOR_EACH_VEC(vecOld, i)
+		{
+			if (vecOld[i].iSteamID)
+				InsertNew(vecOld[i].iSteamID, vecOld[i].value);
+		}
+	}
+
+	CUtlVector<Entry_t> m_vecEntries;
+	int m_nCount;
+};
@@ -0,0 +1,518 @@
+/**
+ * =============================================================================
+ * CS2Fixes
+ * Copyright (C) 2023-2024 Source2ZE
+ * =============================================================================
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License, version 3.0, as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "targetselector.h"
+#include "cs2_sdk/schema.h"
+#include <bit>
+#include <array>
+
+#include "tier0/memdbgon.h"
+
+#define SELECTOR_HASH_SEED		0x811c9dca
+#define SELECTOR_HASH_SLOTS		128
+#define SELECTOR_MAX_LENGTH		16
+#define SELECTOR_NO_ENTRY		0xFF
+
+#define CHECK(flag, error) { flag, ETargetError::error }
+#define NO_CHECK { NO_TARGET_BLOCKS, ETargetError::NO_ERRORS }
+
+// Order of the checks matters, the first blocked one is the error the caller gets back
+static constexpr TargetSelector_t g_rgTargetSelectors[] =
+{
+	{ "@me",			ETargetType::SELF,					ETargetSelectorMode::SELF,				{ CHECK(NO_SELF, SELF), NO_CHECK, NO_CHECK },									NO_TARGET_BLOCKS,							NO_TARGET_BLOCKS },
+	{ "@!me",			ETargetType::ALL_BUT_SELF,			ETargetSelectorMode::MULTIPLE,			{ CHECK(NO_MULTIPLE, MULTIPLE), NO_CHECK, NO_CHECK },							NO_SELF,									NO_TARGET_BLOCKS },
+	{ "@all",			ETargetType::ALL,					ETargetSelectorMode::MULTIPLE,			{ CHECK(NO_MULTIPLE, MULTIPLE), NO_CHECK, NO_CHECK },							NO_TARGET_BLOCKS,							NO_TARGET_BLOCKS },
+	{ "@!all",			ETargetType::NONE,					ETargetSelectorMode::REJECT,			{ NO_CHECK, NO_CHECK, NO_CHECK },												NO_TARGET_BLOCKS,							NO_TARGET_BLOCKS },
+	{ "@t",				ETargetType::T,						ETargetSelectorMode::MULTIPLE,			{ CHECK(NO_TERRORIST, TERRORIST), CHECK(NO_MULTIPLE, MULTIPLE), NO_CHECK },		NO_COUNTER_TERRORIST | NO_SPECTATOR,		NO_TARGET_BLOCKS },
+	{ "@!t",			ETargetType::ALL_BUT_T,				ETargetSelectorMode::MULTIPLE,			{ CHECK(NO_MULTIPLE, MULTIPLE), NO_CHECK, NO_CHECK },							NO_TERRORIST,								NO_TARGET_BLOCKS },
+	{ "@ct",			ETargetType::CT,					ETargetSelectorMode::MULTIPLE,			{ CHECK(NO_COUNTER_TERRORIST, COUNTER_TERRORIST), CHECK(NO_MULTIPLE, MULTIPLE), NO_CHECK },	NO_TERRORIST | NO_SPECTATOR,	NO_TARGET_BLOCKS },
+	{ "@!ct",			ETargetType::ALL_BUT_CT,			ETargetSelectorMode::MULTIPLE,			{ CHECK(NO_MULTIPLE, MULTIPLE), NO_CHECK, NO_CHECK },							NO_COUNTER_TERRORIST,						NO_TARGET_BLOCKS },
+	{ "@spec",			ETargetType::SPECTATOR,				ETargetSelectorMode::MULTIPLE,			{ CHECK(NO_SPECTATOR, SPECTATOR), CHECK(NO_DEAD, DEAD), CHECK(NO_MULTIPLE, MULTIPLE) },	NO_TERRORIST | NO_COUNTER_TERRORIST,	NO_TARGET_BLOCKS },
+	{ "@!spec",			ETargetType::ALL_BUT_SPECTATOR,		ETargetSelectorMode::MULTIPLE,			{ CHECK(NO_MULTIPLE, MULTIPLE), NO_CHECK, NO_CHECK },							NO_SPECTATOR,								NO_TARGET_BLOCKS },
+	{ "@random",		ETargetType::RANDOM,				ETargetSelectorMode::RANDOM,			{ CHECK(NO_RANDOM, RANDOM), NO_CHECK, NO_CHECK },								NO_TARGET_BLOCKS,							NO_TARGET_BLOCKS },
+	{ "@!random",		ETargetType::ALL_BUT_RANDOM,		ETargetSelectorMode::ALL_BUT_RANDOM,	{ CHECK(NO_RANDOM, RANDOM), NO_CHECK, NO_CHECK },								NO_TARGET_BLOCKS,							NO_RANDOM },
+	{ "@randomt",		ETargetType::RANDOM_T,				ETargetSelectorMode::RANDOM,			{ CHECK(NO_TERRORIST, TERRORIST), CHECK(NO_RANDOM, RANDOM), NO_CHECK },			NO_COUNTER_TERRORIST,						NO_TARGET_BLOCKS },
+	{ "@!randomt",		ETargetType::ALL_BUT_RANDOM_T,		ETargetSelectorMode::ALL_BUT_RANDOM,	{ CHECK(NO_RANDOM, RANDOM), NO_CHECK, NO_CHECK },								NO_TARGET_BLOCKS,							NO_RANDOM | NO_COUNTER_TERRORIST | NO_SPECTATOR },
+	{ "@randomct",		ETargetType::RANDOM_CT,				ETargetSelectorMode::RANDOM,			{ CHECK(NO_COUNTER_TERRORIST, COUNTER_TERRORIST), CHECK(NO_RANDOM, RANDOM), NO_CHECK },	NO_TERRORIST,					NO_TARGET_BLOCKS },
+	{ "@!randomct",		ETargetType::RANDOM_CT,				ETargetSelectorMode::ALL_BUT_RANDOM,	{ CHECK(NO_RANDOM, RANDOM), NO_CHECK, NO_CHECK },								NO_TARGET_BLOCKS,							NO_RANDOM | NO_TERRORIST | NO_SPECTATOR },
+	{ "@randomspec",	ETargetType::RANDOM_SPEC,			ETargetSelectorMode::RANDOM,			{ CHECK(NO_SPECTATOR, SPECTATOR), CHECK(NO_DEAD, DEAD), CHECK(NO_RANDOM, RANDOM) },	NO_TERRORIST | NO_COUNTER_TERRORIST,	NO_TARGET_BLOCKS },
+	{ "@!randomspec",	ETargetType::ALL_BUT_RANDOM_SPEC,	ETargetSelectorMode::ALL_BUT_RANDOM,	{ CHECK(NO_RANDOM, RANDOM), NO_CHECK, NO_CHECK },								NO_TARGET_BLOCKS,							NO_RANDOM | NO_TERRORIST | NO_COUNTER_TERRORIST },
+	{ "@dead",			ETargetType::DEAD,					ETargetSelectorMode::MULTIPLE,			{ CHECK(NO_DEAD, DEAD), CHECK(NO_MULTIPLE, MULTIPLE), NO_CHECK },				NO_ALIVE,									NO_TARGET_BLOCKS },
+	{ "@!alive",		ETargetType::DEAD,					ETargetSelectorMode::MULTIPLE,			{ CHECK(NO_DEAD, DEAD), CHECK(NO_MULTIPLE, MULTIPLE), NO_CHECK },				NO_ALIVE,									NO_TARGET_BLOCKS },
+	{ "@alive",			ETargetType::ALIVE,					ETargetSelectorMode::MULTIPLE,			{ CHECK(NO_ALIVE, ALIVE), CHECK(NO_MULTIPLE, MULTIPLE), NO_CHECK },				NO_DEAD,									NO_TARGET_BLOCKS },
+	{ "@!dead",			ETargetType::ALIVE,					ETargetSelectorMode::MULTIPLE,			{ CHECK(NO_ALIVE, ALIVE), CHECK(NO_MULTIPLE, MULTIPLE), NO_CHECK },				NO_DEAD,									NO_TARGET_BLOCKS },
+	{ "@bot",			ETargetType::BOT,					ETargetSelectorMode::MULTIPLE,			{ CHECK(NO_BOT, BOT), CHECK(NO_MULTIPLE, MULTIPLE), NO_CHECK },					NO_HUMAN,									NO_TARGET_BLOCKS },
+	{ "@!human",		ETargetType::BOT,					ETargetSelectorMode::MULTIPLE,			{ CHECK(NO_BOT, BOT), CHECK(NO_MULTIPLE, MULTIPLE), NO_CHECK },					NO_HUMAN,									NO_TARGET_BLOCKS },
+	{ "@human",			ETargetType::HUMAN,					ETargetSelectorMode::MULTIPLE,			{ CHECK(NO_HUMAN, HUMAN), CHECK(NO_MULTIPLE, MULTIPLE), NO_CHECK },				NO_BOT,										NO_TARGET_BLOCKS },
+	{ "@!bot",			ETargetType::HUMAN,					ETargetSelectorMode::MULTIPLE,			{ CHECK(NO_HUMAN, HUMAN), CHECK(NO_MULTIPLE, MULTIPLE), NO_CHECK },				NO_BOT,										NO_TARGET_BLOCKS },
+	{ "@aim",			ETargetType::AIM,					ETargetSelectorMode::AIM,				{ NO_CHECK, NO_CHECK, NO_CHECK },												NO_TARGET_BLOCKS,							NO_TARGET_BLOCKS },
+	{ "@!aim",			ETargetType::ALL_BUT_AIM,			ETargetSelectorMode::ALL_BUT_AIM,		{ NO_CHECK, NO_CHECK, NO_CHECK },												NO_TARGET_BLOCKS,							NO_TARGET_BLOCKS },
+};
+
+#undef CHECK
+#undef NO_CHECK
+
+static_assert(std::size(g_rgTargetSelectors) < SELECTOR_NO_ENTRY, "Too many target selectors for the lookup table");
+
+static constexpr uint32 HashSelector(const char *pszToken)
+{
+	return hash_32_fnv1a_const(pszToken, SELECTOR_HASH_SEED) & (SELECTOR_HASH_SLOTS - 1);
+}
+
+// Maps a hash slot to its index in g_rgTargetSelectors, tokens are stored lowercase so lookups lowercase the input first
+static constexpr std::array<uint8, SELECTOR_HASH_SLOTS> BuildSelectorLookup()
+{
+	std::array<uint8, SELECTOR_HASH_SLOTS> rgLookup{};
+
+	for (auto &iEntry : rgLookup)
+		iEntry = SELECTOR_NO_ENTRY;
+
+	for (size_t i = 0; i < std::size(g_rgTargetSelectors); i++)
+		rgLookup[HashSelector(g_rgTargetSelectors[i].pszToken)] = (uint8)i;
+
+	return rgLookup;
+}
+
+static constexpr bool SelectorLookupIsPerfect()
+{
+	std::array<bool, SELECTOR_HASH_SLOTS> rgUsed{};
+
+	for (const auto &selector : g_rgTargetSelectors)
+	{
+		uint32 iSlot = HashSelector(selector.pszToken);
+
+		if (rgUsed[iSlot])
+			return false;
+
+		rgUsed[iSlot] = true;
+	}
+
+	return true;
+}
+
+static_assert(SelectorLookupIsPerfect(), "Target selector hash collision, pick a different SELECTOR_HASH_SEED");
+
+static constexpr std::array<uint8, SELECTOR_HASH_SLOTS> g_rgSelectorLookup = BuildSelectorLookup();
+
+const TargetSelector_t *FindTargetSelector(const char *pszTarget)
+{
+	if (pszTarget[0] != '@')
+		return nullptr;
+
+	char szToken[SELECTOR_MAX_LENGTH];
+	int iLength = 0;
+
+	for (; pszTarget[iLength]; iLength++)
+	{
+		if (iLength == SELECTOR_MAX_LENGTH - 1)
+			return nullptr;
+
+		char c = pszTarget[iLength];
+		szToken[iLength] = (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+	}
+
+	szToken[iLength] = '\0';
+
+	uint8 iIndex = g_rgSelectorLookup[HashSelector(szToken)];
+
+	if (iIndex == SELECTOR_NO_ENTRY || V_strcmp(g_rgTargetSelectors[iIndex].pszToken, szToken))
+		return nullptr;
+
+	return &g_rgTargetSelectors[iIndex];
+}
+
+ETargetError ApplyTargetSelector(const TargetSelector_t *pSelector, bool bHasPlayer, uint64 &iBlockedFlags)
+{
+	if (pSelector->nMode == ETargetSelectorMode::REJECT)
+		return ETargetError::INVALID;
+
+	for (const auto &check : pSelector->rgChecks)
+	{
+		if (iBlockedFlags & check.iBlockedFlag)
+			return check.nError;
+	}
+
+	if (pSelector->nMode == ETargetSelectorMode::SELF && !bHasPlayer)
+		return ETargetError::SELF;
+
+	iBlockedFlags |= pSelector->iAddBlockedFlags;
+
+	return ETargetError::NO_ERRORS;
+}
+
+uint64 GetTargetableMask(const TargetTable_t &table, const TargetQuery_t &query, uint64 iBlockedFlags)
+{
+	uint64 iMask = table.iValidMask;
+
+	if (iBlockedFlags & NO_SELF && query.iSelfSlot >= 0)
+		iMask &= ~(1ull << query.iSelfSlot);
+	if (iBlockedFlags & NO_TERRORIST)
+		iMask &= ~table.iTerroristMask;
+	if (iBlockedFlags & NO_COUNTER_TERRORIST)
+		iMask &= ~table.iCounterTerroristMask;
+	if (iBlockedFlags & NO_SPECTATOR)
+		iMask &= ~table.iSpectatorMask;
+	if (iBlockedFlags & NO_DEAD)
+		iMask &= table.iAliveMask & ~table.iSpectatorMask;
+	if (iBlockedFlags & NO_ALIVE)
+		iMask &= ~table.iAliveMask;
+	if (iBlockedFlags & NO_BOT)
+		iMask &= ~table.iBotMask;
+	if (iBlockedFlags & NO_HUMAN)
+		iMask &= table.iBotMask;
+	if (iBlockedFlags & NO_UNAUTHENTICATED)
+		iMask &= table.iAuthenticatedMask;
+
+	if (query.iSelfImmunity < 0 || iBlockedFlags & NO_IMMUNITY || (query.iImmunityMode != 0 && query.iImmunityMode != 1))
+		return iMask;
+
+	for (uint64 iCandidates = iMask; iCandidates; iCandidates &= iCandidates - 1)
+	{
+		int i = std::countr_zero(iCandidates);
+		int iImmunity = table.rgiImmunity[i];
+
+		if ((query.iImmunityMode == 0 && iImmunity > query.iSelfImmunity)
+			|| (query.iImmunityMode == 1 && iImmunity <= query.iSelfImmunity && i != query.iSelfSlot))
+			iMask &= ~(1ull << i);
+	}
+
+	return iMask;
+}
+
+int PickRandomSlot(uint64 iMask)
+{
+	int iCount = std::popcount(iMask);
+
+	if (!iCount)
+		return -1;
+
+	for (int iSkip = rand() % iCount; iSkip; iSkip--)
+		iMask &= iMask - 1;
+
+	return std::countr_zero(iMask);
+}
+
+// Everything below is for cs2f_target_selftest, selectors are checked against a mock player table
+// instead of live controllers so the results don't depend on who's on the server
+
+struct MockTarget_t
+{
+	bool bValid;
+	int iTeam;
+	bool bAlive;
+	bool bBot;
+	bool bAuthenticated;
+	int iImmunity;
+};
+
+static void BuildMockTable(const MockTarget_t *pTargets, int nTargets, TargetTable_t &table)
+{
+	V_memset(&table, 0, sizeof(table));
+
+	for (int i = 0; i < nTargets; i++)
+	{
+		const MockTarget_t &target = pTargets[i];
+
+		if (!target.bValid)
+			continue;
+
+		uint64 iBit = 1ull << i;
+
+		table.iValidMask |= iBit;
+		table.rgiImmunity[i] = target.iImmunity;
+
+		if (target.iTeam == CS_TEAM_T)
+			table.iTerroristMask |= iBit;
+		else if (target.iTeam == CS_TEAM_CT)
+			table.iCounterTerroristMask |= iBit;
+		else
+			table.iSpectatorMask |= iBit;
+
+		if (target.bAlive)
+			table.iAliveMask |= iBit;
+		if (target.bBot)
+			table.iBotMask |= iBit;
+		if (target.bAuthenticated)
+			table.iAuthenticatedMask |= iBit;
+	}
+}
+
+// Same checks as GetTargetError in playermanager.cpp, one target at a time
+static bool MockCanTarget(const MockTarget_t &target, int iSlot, const TargetQuery_t &query, uint64 iBlockedFlags)
+{
+	if (!target.bValid)
+		return false;
+	else if (iBlockedFlags & NO_SELF && iSlot == query.iSelfSlot)
+		return false;
+	else if (iBlockedFlags & NO_TERRORIST && target.iTeam == CS_TEAM_T)
+		return false;
+	else if (iBlockedFlags & NO_COUNTER_TERRORIST && target.iTeam == CS_TEAM_CT)
+		return false;
+	else if (iBlockedFlags & NO_SPECTATOR && target.iTeam <= CS_TEAM_SPECTATOR)
+		return false;
+	else if (iBlockedFlags & NO_DEAD && (!target.bAlive || target.iTeam <= CS_TEAM_SPECTATOR))
+		return false;
+	else if (iBlockedFlags & NO_ALIVE && target.bAlive)
+		return false;
+	else if (iBlockedFlags & NO_BOT && target.bBot)
+		return false;
+	else if (iBlockedFlags & NO_HUMAN && !target.bBot)
+		return false;
+	else if (iBlockedFlags & NO_UNAUTHENTICATED && !target.bAuthenticated)
+		return false;
+	else if (query.iSelfImmunity >= 0 && !(iBlockedFlags & NO_IMMUNITY)
+			 && ((query.iImmunityMode == 0 && target.iImmunity > query.iSelfImmunity)
+				 || (query.iImmunityMode == 1 && target.iImmunity <= query.iSelfImmunity && iSlot != query.iSelfSlot)))
+		return false;
+
+	return true;
+}
+
+struct SelectorGoldenCase_t
+{
+	const char *pszTarget;
+	uint64 iBlockedFlags;
+	TargetQuery_t query;
+	ETargetError nExpectedError;
+	uint64 iExpectedMask;
+};
+
+// Slot 0 is the player running the command
+static const MockTarget_t g_rgGoldenTargets[] =
+{
+	{ true,		CS_TEAM_T,			true,	false,	true,	50 },
+	{ true,		CS_TEAM_CT,			true,	false,	true,	50 },
+	{ true,		CS_TEAM_CT,			false,	true,	true,	0 },
+	{ true,		CS_TEAM_SPECTATOR,	false,	false,	false,	0 },
+	{ true,		CS_TEAM_T,			false,	false,	true,	100 },
+	{ false,	CS_TEAM_T,			true,	false,	true,	0 },
+};
+
+#define PLAYER_QUERY	{ 0, 50, 0 }
+#define CONSOLE_QUERY	{ -1, -1, 0 }
+
+static const SelectorGoldenCase_t g_rgGoldenCases[] =
+{
+	{ "@all",		NO_TARGET_BLOCKS,								PLAYER_QUERY,	ETargetError::NO_ERRORS,			0x0F },
+	{ "@ALL",		NO_TARGET_BLOCKS,								CONSOLE_QUERY,	ETargetError::NO_ERRORS,			0x1F },
+	{ "@all",		NO_UNAUTHENTICATED,								PLAYER_QUERY,	ETargetError::NO_ERRORS,			0x07 },
+	{ "@all",		NO_IMMUNITY,									PLAYER_QUERY,	ETargetError::NO_ERRORS,			0x1F },
+	{ "@all",		NO_TARGET_BLOCKS,								{ 0, 50, 1 },	ETargetError::NO_ERRORS,			0x11 },
+	{ "@all",		NO_TARGET_BLOCKS,								{ 0, 50, 2 },	ETargetError::NO_ERRORS,			0x1F },
+	{ "@all",		NO_MULTIPLE,									PLAYER_QUERY,	ETargetError::MULTIPLE,				0 },
+	{ "@!all",		NO_TARGET_BLOCKS,								PLAYER_QUERY,	ETargetError::INVALID,				0 },
+	{ "@me",		NO_TARGET_BLOCKS,								PLAYER_QUERY,	ETargetError::NO_ERRORS,			0x0F },
+	{ "@me",		NO_SELF,										PLAYER_QUERY,	ETargetError::SELF,					0 },
+	{ "@me",		NO_TARGET_BLOCKS,								CONSOLE_QUERY,	ETargetError::SELF,					0 },
+	{ "@!me",		NO_TARGET_BLOCKS,								PLAYER_QUERY,	ETargetError::NO_ERRORS,			0x0E },
+	{ "@t",			NO_TARGET_BLOCKS,								PLAYER_QUERY,	ETargetError::NO_ERRORS,			0x01 },
+	{ "@t",			NO_TERRORIST | NO_MULTIPLE,						PLAYER_QUERY,	ETargetError::TERRORIST,			0 },
+	{ "@!t",		NO_TARGET_BLOCKS,								PLAYER_QUERY,	ETargetError::NO_ERRORS,			0x0E },
+	{ "@ct",		NO_TARGET_BLOCKS,								PLAYER_QUERY,	ETargetError::NO_ERRORS,			0x06 },
+	{ "@Ct",		NO_MULTIPLE,									PLAYER_QUERY,	ETargetError::MULTIPLE,				0 },
+	{ "@!ct",		NO_TARGET_BLOCKS,								PLAYER_QUERY,	ETargetError::NO_ERRORS,			0x09 },
+	{ "@spec",		NO_TARGET_BLOCKS,								PLAYER_QUERY,	ETargetError::NO_ERRORS,			0x08 },
+	{ "@spec",		NO_DEAD | NO_MULTIPLE,							PLAYER_QUERY,	ETargetError::DEAD,					0 },
+	{ "@!spec",		NO_TARGET_BLOCKS,								PLAYER_QUERY,	ETargetError::NO_ERRORS,			0x07 },
+	{ "@dead",		NO_TARGET_BLOCKS,								PLAYER_QUERY,	ETargetError::NO_ERRORS,			0x0C },
+	{ "@!alive",	NO_TARGET_BLOCKS,								PLAYER_QUERY,	ETargetError::NO_ERRORS,			0x0C },
+	{ "@alive",		NO_TARGET_BLOCKS,								PLAYER_QUERY,	ETargetError::NO_ERRORS,			0x03 },
+	{ "@!dead",		NO_ALIVE,										PLAYER_QUERY,	ETargetError::ALIVE,				0 },
+	{ "@bot",		NO_TARGET_BLOCKS,								PLAYER_QUERY,	ETargetError::NO_ERRORS,			0x04 },
+	{ "@!human",	NO_BOT,											PLAYER_QUERY,	ETargetError::BOT,					0 },
+	{ "@human",		NO_TARGET_BLOCKS,								PLAYER_QUERY,	ETargetError::NO_ERRORS,			0x0B },
+	{ "@random",	NO_RANDOM,										PLAYER_QUERY,	ETargetError::RANDOM,				0 },
+	{ "@randomt",	NO_TARGET_BLOCKS,								PLAYER_QUERY,	ETargetError::NO_ERRORS,			0x09 },
+	{ "@randomct",	NO_COUNTER_TERRORIST,							PLAYER_QUERY,	ETargetError::COUNTER_TERRORIST,	0 },
+	{ "@randomspec",NO_DEAD | NO_RANDOM,							PLAYER_QUERY,	ETargetError::DEAD,					0 },
+	{ "@!random",	NO_RANDOM,										PLAYER_QUERY,	ETargetError::RANDOM,				0 },
+};
+
+#undef PLAYER_QUERY
+#undef CONSOLE_QUERY
+
+static int TestSelectorLookup()
+{
+	int iFailures = 0;
+
+	for (const auto &selector : g_rgTargetSelectors)
+	{
+		char szUpper[SELECTOR_MAX_LENGTH];
+		int iLength = 0;
+
+		for (; selector.pszToken[iLength]; iLength++)
+		{
+			char c = selector.pszToken[iLength];
+			szUpper[iLength] = (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+		}
+
+		szUpper[iLength] = '\0';
+
+		if (FindTargetSelector(selector.pszToken) != &selector || FindTargetSelector(szUpper) != &selector)
+		{
+			Message("FAIL: lookup of %s\n", selector.pszToken);
+			iFailures++;
+		}
+	}
+
+	static const char *rgpszNotSelectors[] = { "", "@", "me", "#1", "$7656", "@foo", "@alll", "@al", "@!", "@randomspecs", "@@all", "@all ", "@randomspecrandomspec" };
+
+	for (const char *pszTarget : rgpszNotSelectors)
+	{
+		if (FindTargetSelector(pszTarget))
+		{
+			Message("FAIL: \"%s\" matched a selector\n", pszTarget);
+			iFailures++;
+		}
+	}
+
+	return iFailures;
+}
+
+static int TestSelectorGolden()
+{
+	TargetTable_t table;
+	BuildMockTable(g_rgGoldenTargets, std::size(g_rgGoldenTargets), table);
+
+	int iFailures = 0;
+
+	for (const auto &test : g_rgGoldenCases)
+	{
+		const TargetSelector_t *pSelector = FindTargetSelector(test.pszTarget);
+		uint64 iBlockedFlags = test.iBlockedFlags;
+		ETargetError nError = pSelector ? ApplyTargetSelector(pSelector, test.query.iSelfSlot >= 0, iBlockedFlags) : ETargetError::INVALID;
+		uint64 iMask = 0;
+
+		// @me is checked against the whole table, the caller only looks at its own bit
+		if (nError == ETargetError::NO_ERRORS)
+			iMask = GetTargetableMask(table, test.query, iBlockedFlags);
+
+		if (nError != test.nExpectedError || iMask != test.iExpectedMask)
+		{
+			Message("FAIL: %s (flags %llx, mode %i) gave error %i mask %llx, expected error %i mask %llx\n", test.pszTarget, test.iBlockedFlags,
+					test.query.iImmunityMode, (int)nError, iMask, (int)test.nExpectedError, test.iExpectedMask);
+			iFailures++;
+		}
+	}
+
+	// Whoever @!randomt leaves out has to come from here
+	TargetQuery_t query = { 0, 50, 0 };
+	uint64 iInverse = GetTargetableMask(table, query, FindTargetSelector("@!randomt")->iInverseFlags | NO_IMMUNITY);
+
+	if (iInverse != 0x11)
+	{
+		Message("FAIL: @!randomt picks from %llx, expected 11\n", iInverse);
+		iFailures++;
+	}
+
+	for (int i = 0; i < 1000; i++)
+	{
+		int iSlot = PickRandomSlot(iInverse);
+
+		if (iSlot < 0 || !(iInverse & (1ull << iSlot)))
+		{
+			Message("FAIL: PickRandomSlot gave %i out of %llx\n", iSlot, iInverse);
+			iFailures++;
+			break;
+		}
+	}
+
+	if (PickRandomSlot(0) != -1)
+	{
+		Message("FAIL: PickRandomSlot picked from an empty mask\n");
+		iFailures++;
+	}
+
+	return iFailures;
+}
+
+// Random tables against the one target at a time checks, for every combination of the flags GetTargetableMask looks at
+static int TestSelectorDifferential(int nTables)
+{
+	static const uint64 rgFlags[] = { NO_SELF, NO_BOT, NO_HUMAN, NO_UNAUTHENTICATED, NO_DEAD, NO_ALIVE,
+									  NO_TERRORIST, NO_COUNTER_TERRORIST, NO_SPECTATOR, NO_IMMUNITY };
+	static const int rgImmunities[] = { 0, 1, 50, 100 };
+
+	MockTarget_t rgTargets[MAXPLAYERS];
+	int iFailures = 0;
+
+	for (int iTable = 0; iTable < nTables && iFailures < 10; iTable++)
+	{
+		for (int i = 0; i < MAXPLAYERS; i++)
+		{
+			rgTargets[i].bValid = rand() % 4 != 0;
+			rgTargets[i].iTeam = rand() % 4;
+			rgTargets[i].bAlive = rand() % 2;
+			rgTargets[i].bBot = rand() % 3 == 0;
+			rgTargets[i].bAuthenticated = rand() % 4 != 0;
+			rgTargets[i].iImmunity = rgImmunities[rand() % std::size(rgImmunities)];
+		}
+
+		TargetTable_t table;
+		BuildMockTable(rgTargets, MAXPLAYERS, table);
+
+		TargetQuery_t query;
+		query.iSelfSlot = rand() % (MAXPLAYERS + 1) - 1;
+		query.iSelfImmunity = query.iSelfSlot >= 0 && rgTargets[query.iSelfSlot].bValid ? rgTargets[query.iSelfSlot].iImmunity : -1;
+		query.iImmunityMode = rand() % 3;
+
+		for (int iCombo = 0; iCombo < (1 << std::size(rgFlags)); iCombo++)
+		{
+			uint64 iBlockedFlags = NO_TARGET_BLOCKS;
+
+			for (int iFlag = 0; iFlag < (int)std::size(rgFlags); iFlag++)
+			{
+				if (iCombo & (1 << iFlag))
+					iBlockedFlags |= rgFlags[iFlag];
+			}
+
+			uint64 iExpected = 0;
+
+			for (int i = 0; i < MAXPLAYERS; i++)
+			{
+				if (MockCanTarget(rgTargets[i], i, query, iBlockedFlags))
+					iExpected |= 1ull << i;
+			}
+
+			uint64 iMask = GetTargetableMask(table, query, iBlockedFlags);
+
+			if (iMask != iExpected)
+			{
+				Message("FAIL: table %i flags %llx self %i mode %i gave %llx, expected %llx\n", iTable, iBlockedFlags,
+						query.iSelfSlot, query.iImmunityMode, iMask, iExpected);
+				iFailures++;
+				break;
+			}
+		}
+	}
+
+	return iFailures;
+}
+
+CON_COMMAND_F(cs2f_target_selftest, "Check target selector lookup and evaluation against known results", FCVAR_SPONLY | FCVAR_LINKED_CONCOMMAND)
+{
+	int nTables = args.ArgC() > 1 ? V_StringToInt32(args[1], 200) : 200;
+
+	int iFailures = TestSelectorLookup();
+	iFailures += TestSelectorGolden();
+	iFailures += TestSelectorDifferential(nTables);
+
+	Message("Target selector self test: %i selectors, %i golden cases, %i random tables, %i failures\n",
+			(int)std::size(g_rgTargetSelectors), (int)std::size(g_rgGoldenCases), nTables, iFailures);
+}
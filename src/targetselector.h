@@ -0,0 +1,82 @@
+/**
+ * =============================================================================
+ * CS2Fixes
+ * Copyright (C) 2023-2024 Source2ZE
+ * =============================================================================
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License, version 3.0, as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "playermanager.h"
+
+enum class ETargetSelectorMode
+{
+	SELF,
+	MULTIPLE,
+	RANDOM,
+	ALL_BUT_RANDOM,	// Everyone matching the blocked flags except one random player matching the inverse flags
+	AIM,
+	ALL_BUT_AIM,
+	REJECT,			// Always INVALID
+};
+
+struct TargetSelectorCheck_t
+{
+	uint64 iBlockedFlag;
+	ETargetError nError;
+};
+
+// One @ token, the checks run in order against the caller's blocked flags before anything is looked up
+struct TargetSelector_t
+{
+	const char *pszToken;
+	ETargetType nType;
+	ETargetSelectorMode nMode;
+	TargetSelectorCheck_t rgChecks[3];
+	uint64 iAddBlockedFlags;
+	uint64 iInverseFlags;
+};
+
+// Case insensitive, returns nullptr for anything that isn't a known @ token
+const TargetSelector_t *FindTargetSelector(const char *pszTarget);
+
+// Runs the selector's checks and adds its own blocked flags, bHasPlayer is whether a player (not the console) is targetting
+ETargetError ApplyTargetSelector(const TargetSelector_t *pSelector, bool bHasPlayer, uint64 &iBlockedFlags);
+
+// Everything GetTargetError looks at for every slot, as masks
+struct TargetTable_t
+{
+	uint64 iValidMask;		// Connected, non-HLTV controller with a ZEPlayer
+	uint64 iTerroristMask;
+	uint64 iCounterTerroristMask;
+	uint64 iSpectatorMask;	// CS_TEAM_SPECTATOR and below
+	uint64 iAliveMask;		// m_bPawnIsAlive
+	uint64 iBotMask;
+	uint64 iAuthenticatedMask;
+	int rgiImmunity[MAXPLAYERS];
+};
+
+// Who's targetting, iSelfSlot is -1 for the console and iSelfImmunity is -1 when immunity doesn't apply
+struct TargetQuery_t
+{
+	int iSelfSlot;
+	int iSelfImmunity;
+	int iImmunityMode;		// cs2f_admin_immunity
+};
+
+// Slots for which GetTargetError would return ETargetError::NO_ERRORS
+uint64 GetTargetableMask(const TargetTable_t &table, const TargetQuery_t &query, uint64 iBlockedFlags);
+
+// Uniformly random slot out of iMask, -1 if it's empty
+int PickRandomSlot(uint64 iMask);
@@ -0,0 +1,292 @@
+/**
+ * =============================================================================
+ * CS2Fixes
+ * Copyright (C) 2023-2024 Source2ZE
+ * =============================================================================
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License, version 3.0, as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "triggertimer.h"
+#include "common.h"
+#include "icvar.h"
+#include "tier0/platform.h"
+
+#include "tier0/memdbgon.h"
+
+// Longer messages only have their start looked at, chat can't show much more than this anyway
+#define MAX_TRIGGER_TIMER_TEXT 256
+
+// Whole words of digits only, anything else is 0 just like V_StringToUint32 without an end pointer
+static uint32 ParseTriggerTimerNumber(const char *pWord, int nLength)
+{
+	if (nLength == 0)
+		return 0;
+
+	uint64 iValue = 0;
+
+	for (int i = 0; i < nLength; i++)
+	{
+		if (pWord[i] < '0' || pWord[i] > '9')
+			return 0;
+
+		iValue = iValue * 10 + (pWord[i] - '0');
+
+		if (iValue > UINT32_MAX)
+			return 0;
+	}
+
+	return (uint32)iValue;
+}
+
+uint32 ParseTriggerTimerLength(const char *pText)
+{
+	// Lowercase letters and digits only, everything else is dropped and spaces separate the words
+	// Words are kept as offsets into one stack buffer so nothing is allocated
+	char szFiltered[MAX_TRIGGER_TIMER_TEXT];
+	uint8 rgiWordStart[MAX_TRIGGER_TIMER_TEXT];
+	uint8 rgnWordLength[MAX_TRIGGER_TIMER_TEXT];
+	int nFiltered = 0;
+	int nWords = 0;
+	bool bInWord = false;
+
+	for (const char *p = pText; *p && nFiltered < MAX_TRIGGER_TIMER_TEXT - 1; p++)
+	{
+		char c = *p;
+
+		if (c == ' ')
+		{
+			bInWord = false;
+			continue;
+		}
+
+		if (c >= 'A' && c <= 'Z')
+			c += 'a' - 'A';
+		else if ((c < 'a' || c > 'z') && (c < '0' || c > '9'))
+			continue;
+
+		if (!bInWord)
+		{
+			rgiWordStart[nWords] = nFiltered;
+			rgnWordLength[nWords] = 0;
+			nWords++;
+			bInWord = true;
+		}
+
+		szFiltered[nFiltered++] = c;
+		rgnWordLength[nWords - 1]++;
+	}
+
+	// Word 0 is "Console:", the first relevant word is at index 1
+	uint32 iTriggerTimerLength = 0;
+
+	if (nWords == 2)
+		iTriggerTimerLength = ParseTriggerTimerNumber(szFiltered + rgiWordStart[1], rgnWordLength[1]);
+
+	for (int i = 1; i < nWords && iTriggerTimerLength == 0; i++)
+	{
+		const char *pWord = szFiltered + rgiWordStart[i];
+		uint32 iCurrentValue = ParseTriggerTimerNumber(pWord, rgnWordLength[i]);
+
+		// Case: ... X sec(onds) ... or ... X min(utes) ...
+		if (iCurrentValue > 0 && i + 1 < nWords && rgnWordLength[i + 1] > 2)
+		{
+			const char *pNextWord = szFiltered + rgiWordStart[i + 1];
+
+			if (!V_strncmp(pNextWord, "sec", 3))
+				iTriggerTimerLength = iCurrentValue;
+			else if (!V_strncmp(pNextWord, "min", 3))
+				iTriggerTimerLength = iCurrentValue * 60;
+		}
+
+		// Case: ... Xs - only support up to 3 digit numbers (in seconds) for this timer parse method
+		if (iCurrentValue == 0)
+		{
+			int nScanLength = MIN(rgnWordLength[i], 4);
+
+			for (int j = 0; j < nScanLength; j++)
+			{
+				if (pWord[j] >= '0' && pWord[j] <= '9')
+					continue;
+
+				if (pWord[j] == 's')
+					iTriggerTimerLength = ParseTriggerTimerNumber(pWord, j);
+
+				break;
+			}
+		}
+	}
+
+	return iTriggerTimerLength;
+}
+
+// Set associative so a lookup only compares against a few entries, LRU within each set
+#define TRIGGER_TIMER_CACHE_SETS 16
+#define TRIGGER_TIMER_CACHE_WAYS 4
+
+struct TriggerTimerCacheEntry_t
+{
+	uint64 iHash;
+	uint32 iTriggerTimerLength;
+	uint32 iLastUsed;	// 0 for unused entries
+};
+
+static TriggerTimerCacheEntry_t g_rgTriggerTimerCache[TRIGGER_TIMER_CACHE_SETS][TRIGGER_TIMER_CACHE_WAYS];
+static uint32 g_iTriggerTimerCacheClock = 0;
+
+static uint64 HashTriggerTimerText(const char *pText)
+{
+	uint64 iHash = 0xcbf29ce484222325;
+
+	for (const char *p = pText; *p; p++)
+		iHash = (iHash ^ (uint8)*p) * 0x100000001b3;
+
+	return iHash;
+}
+
+uint32 GetTriggerTimerLength(const char *pText)
+{
+	uint64 iHash = HashTriggerTimerText(pText);
+	TriggerTimerCacheEntry_t *pSet = g_rgTriggerTimerCache[(iHash >> 32) % TRIGGER_TIMER_CACHE_SETS];
+	TriggerTimerCacheEntry_t *pOldest = &pSet[0];
+
+	g_iTriggerTimerCacheClock++;
+
+	for (int i = 0; i < TRIGGER_TIMER_CACHE_WAYS; i++)
+	{
+		if (pSet[i].iLastUsed && pSet[i].iHash == iHash)
+		{
+			pSet[i].iLastUsed = g_iTriggerTimerCacheClock;
+			return pSet[i].iTriggerTimerLength;
+		}
+
+		if (pSet[i].iLastUsed < pOldest->iLastUsed)
+			pOldest = &pSet[i];
+	}
+
+	pOldest->iHash = iHash;
+	pOldest->iTriggerTimerLength = ParseTriggerTimerLength(pText);
+	pOldest->iLastUsed = g_iTriggerTimerCacheClock;
+
+	return pOldest->iTriggerTimerLength;
+}
+
+static void ClearTriggerTimerCache()
+{
+	V_memset(g_rgTriggerTimerCache, 0, sizeof(g_rgTriggerTimerCache));
+	g_iTriggerTimerCacheClock = 0;
+}
+
+struct TriggerTimerTestCase_t
+{
+	const char *pszText;
+	uint32 iExpected;
+};
+
+// Console lines as ZE maps print them, expected results are what the old CSplitString parser returned
+static const TriggerTimerTestCase_t g_rgTriggerTimerCorpus[] = {
+	{ "Console: Hold for 10 seconds", 10 },
+	{ "Console: DOOR OPENS IN 20 SECONDS", 20 },
+	{ "Console: ** The boat will leave in 30s **", 30 },
+	{ "Console: Defend here for 1 minute", 60 },
+	{ "Console: 45", 45 },
+	{ "Console: Nuke in 2 mins!", 120 },
+	{ "Console: Round 3 - Stage 2", 0 },
+	{ "Console: The laser will fire in 5 seconds", 5 },
+	{ "Console: Zombies will be teleported in 15 sec", 15 },
+	{ "Console: Final boss spawns in 1:30", 0 },
+	{ "Console: Gate opening in 10...", 0 },
+	{ "Console: WARNING 100s until nuke", 100 },
+	{ "Console: 1000s", 0 },
+	{ "Console: Map by Luffaren", 0 },
+	{ "Console: Hold 3 minutes", 180 },
+	{ "Console: HOLD 20 SEC!!!", 20 },
+	{ "Console: >> Elevator leaves in 25 seconds <<", 25 },
+	{ "Console: [Stage 1/5] Defend the door for 40 seconds", 40 },
+	{ "Console: The helicopter will arrive in 60 SECONDS, hold the roof!", 60 },
+	{ "Console: ** Train departs in 8s **", 8 },
+	{ "Console: 5 seconds until the bridge collapses", 5 },
+	{ "Console: Hold for 2 minutes and 30 seconds", 120 },
+	{ "Console: *** 30 ***", 30 },
+	{ "Console: Teleporting zombies in 3...2...1", 0 },
+	{ "Console: Lasers active for 45s", 45 },
+	{ "Console: Extreme mode enabled, zombies have 20000 HP", 0 },
+	{ "Console: Boss HP: 5000", 0 },
+	{ "Console: Humans win!", 0 },
+	{ "Console: Door closes in 0 seconds", 0 },
+	{ "Console: You have 90 secs to get to the boat", 90 },
+	{ "Console: Push the button 4 times", 0 },
+	{ "Console: 2s", 2 },
+	{ "Console: 15 sek", 0 },
+	{ "Console: Shortcut opens in 12 s", 0 },
+	{ "Console: Rocket launch in T-60 seconds", 0 },
+	{ "Console: Escape in 1min", 0 },
+	{ "Console: 3 MINUTES UNTIL NUKE", 180 },
+	{ "Console: Defend 5 more seconds", 0 },
+	{ "Console: ZM cage opens in 20 secounds", 20 },
+	{ "Console: Level 2 - Extreme", 0 },
+	{ "Console: Hold position 7seconds", 7 },
+	{ "Console:   Double  spaced   10   seconds  ", 10 },
+	{ "Console: Mine cart leaves in 35s, get on!", 35 },
+	{ "Console: 120", 120 },
+};
+
+CON_COMMAND_F(cs2f_trigger_timer_test, "Check the trigger timer parser against a corpus of map console messages and benchmark it", FCVAR_SPONLY | FCVAR_LINKED_CONCOMMAND)
+{
+	int nCases = sizeof(g_rgTriggerTimerCorpus) / sizeof(*g_rgTriggerTimerCorpus);
+	int nFailed = 0;
+
+	ClearTriggerTimerCache();
+
+	for (const TriggerTimerTestCase_t &test : g_rgTriggerTimerCorpus)
+	{
+		uint32 iParsed = ParseTriggerTimerLength(test.pszText);
+		uint32 iCached = GetTriggerTimerLength(test.pszText);
+		uint32 iCachedRepeat = GetTriggerTimerLength(test.pszText);
+
+		if (iParsed != test.iExpected || iCached != test.iExpected || iCachedRepeat != test.iExpected)
+		{
+			Message("FAILED \"%s\": expected %u, parsed %u, cached %u then %u\n", test.pszText, test.iExpected, iParsed, iCached, iCachedRepeat);
+			nFailed++;
+		}
+	}
+
+	Message("%i/%i trigger timer cases passed\n", nCases - nFailed, nCases);
+
+	const int nIterations = 10000;
+	volatile uint32 iSink = 0;
+
+	double flStart = Plat_FloatTime();
+
+	for (int i = 0; i < nIterations; i++)
+	{
+		for (const TriggerTimerTestCase_t &test : g_rgTriggerTimerCorpus)
+			iSink = iSink + ParseTriggerTimerLength(test.pszText);
+	}
+
+	double flParse = Plat_FloatTime() - flStart;
+	flStart = Plat_FloatTime();
+
+	for (int i = 0; i < nIterations; i++)
+	{
+		for (const TriggerTimerTestCase_t &test : g_rgTriggerTimerCorpus)
+			iSink = iSink + GetTriggerTimerLength(test.pszText);
+	}
+
+	double flCached = Plat_FloatTime() - flStart;
+	int nMessages = nIterations * nCases;
+
+	Message("Parse: %.1f ns per message, cached: %.1f ns per message\n", flParse * 1e9 / nMessages, flCached * 1e9 / nMessages);
+
+	ClearTriggerTimerCache();
+}
@@ -0,0 +1,28 @@
+/**
+ * =============================================================================
+ * CS2Fixes
+ * Copyright (C) 2023-2024 Source2ZE
+ * =============================================================================
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License, version 3.0, as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "platform.h"
+
+// Seconds until whatever a console message is counting down to, 0 if it isn't a countdown
+// e.g. "Console: Hold for 10 seconds", "Console: Doors open in 2 min" or "Console: 30s left"
+uint32 ParseTriggerTimerLength(const char *pText);
+
+// ParseTriggerTimerLength for repeat messages is just a cache lookup, maps print the same lines every round
+uint32 GetTriggerTimerLength(const char *pText);
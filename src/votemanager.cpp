@@ -72,7 +72,7 @@ void VoteManager_Init()
 	g_RTVState = ERTVState::MAP_START;
 	g_ExtendState = EExtendState::MAP_START;
 
-	new CTimer(g_flExtendVoteDelay, false, true, []()
+	new CTimer("extend_vote_delay", g_flExtendVoteDelay, false, true, []()
 		{
 			if (g_ExtendState < EExtendState::POST_EXTEND_NO_EXTENDS_LEFT)
 				g_ExtendState = EExtendState::EXTEND_ALLOWED;
@@ -80,7 +80,7 @@ void VoteManager_Init()
 		}
 	);
 
-	new CTimer(g_flRtvDelay, false, true, []()
+	new CTimer("rtv_delay", g_flRtvDelay, false, true, []()
 		{
 			if (g_RTVState != ERTVState::BLOCKED_BY_ADMIN)
 				g_RTVState = ERTVState::RTV_ALLOWED;
@@ -88,7 +88,7 @@ void VoteManager_Init()
 		}
 	);
 
-	new CTimer(flExtendVoteTickrate, false, true, TimerCheckTimeleft);
+	new CTimer("check_timeleft", flExtendVoteTickrate, false, true, TimerCheckTimeleft);
 }
 
 int iVoteStartTicks = 3;
@@ -131,7 +131,7 @@ float TimerCheckTimeleft()
 	bVoteStarting = true;
 	ClientPrintAll(HUD_PRINTTALK, CHAT_PREFIX "Extend vote starting in 10 seconds!");
 
-	new CTimer(7.0f, false, true, []()
+	new CTimer("extend_vote_start", 7.0f, false, true, []()
 		{
 			if (iVoteStartTicks == 0)
 			{
@@ -285,7 +285,7 @@ CON_COMMAND_CHAT(rtv, "- Vote to end the current map sooner")
 		{
 			ClientPrintAll(HUD_PRINTTALK, CHAT_PREFIX "RTV succeeded! Ending the map now...");
 
-			new CTimer(3.0f, false, true, []()
+			new CTimer("rtv_end_round", 3.0f, false, true, []()
 				{
 					g_pGameRules->TerminateRound(5.0f, CSRoundEndReason::Draw);
 
@@ -735,7 +735,7 @@ bool VoteExtendEndCallback(YesNoVoteInfo info)
 			if (g_ExtendVoteMode == EExtendVoteMode::EXTENDVOTE_AUTO)
 			{
 				//small delay to allow cvar change to go through
-				new CTimer(0.1, false, true, []()
+				new CTimer("extend_vote_start", 0.1, false, true, []()
 					{
 						g_ExtendState = EExtendState::EXTEND_ALLOWED;
 						return -1.0f;
@@ -746,7 +746,7 @@ bool VoteExtendEndCallback(YesNoVoteInfo info)
 				g_ExtendState = EExtendState::POST_EXTEND_COOLDOWN;
 
 				// Allow another extend vote after added time lapses
-				new CTimer(g_iExtendTimeToAdd * 60.0f, false, true, []()
+				new CTimer("extend_cooldown", g_iExtendTimeToAdd * 60.0f, false, true, []()
 					{
 						if (g_ExtendState == EExtendState::POST_EXTEND_COOLDOWN)
 							g_ExtendState = EExtendState::EXTEND_ALLOWED;
@@ -791,7 +791,7 @@ void StartExtendVote(int iCaller)
 	g_pPanoramaVoteHandler->SendYesNoVoteToAll(g_flExtendVoteDuration, iCaller, "#SFUI_vote_passed_nextlevel_extend",
 		sDetailStr, &VoteExtendEndCallback, &VoteExtendHandler);
 
-	new CTimer(g_flExtendVoteDuration - 3.0f, false, true, []()
+	new CTimer("extend_vote_end", g_flExtendVoteDuration - 3.0f, false, true, []()
 		{
 			if (iVoteEndTicks == 0 || g_ExtendState != EExtendState::IN_PROGRESS)
 			{
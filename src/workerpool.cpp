@@ -0,0 +1,127 @@
+/**
+ * =============================================================================
+ * CS2Fixes
+ * Copyright (C) 2023-2024 Source2ZE
+ * =============================================================================
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License, version 3.0, as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "workerpool.h"
+
+#include "tier0/memdbgon.h"
+
+void CWorkerPool::SetThreadCount(int nThreads)
+{
+	if (nThreads == GetThreadCount())
+		return;
+
+	if (!m_vecThreads.empty())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_bStopping = true;
+		}
+
+		m_cvWork.notify_all();
+
+		for (std::thread &thread : m_vecThreads)
+			thread.join();
+
+		m_vecThreads.clear();
+		m_bStopping = false;
+	}
+
+	for (int i = 0; i < nThreads; i++)
+		m_vecThreads.emplace_back(&CWorkerPool::WorkerMain, this);
+}
+
+void CWorkerPool::RunJobs(int nJobs, WorkerJobFn pfnJob, void *pContext)
+{
+	int iJob;
+
+	while ((iJob = m_iNextJob.fetch_add(1)) < nJobs)
+	{
+		pfnJob(iJob, pContext);
+		m_nJobsLeft.fetch_sub(1);
+	}
+}
+
+void CWorkerPool::WorkerMain()
+{
+	unsigned int iSeenGeneration = 0;
+
+	while (true)
+	{
+		int nJobs;
+		WorkerJobFn pfnJob;
+		void *pContext;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cvWork.wait(lock, [&] { return m_bStopping || m_iGeneration != iSeenGeneration; });
+
+			if (m_bStopping)
+				return;
+
+			iSeenGeneration = m_iGeneration;
+			nJobs = m_nJobs;
+			pfnJob = m_pfnJob;
+			pContext = m_pContext;
+			m_nActiveWorkers++;
+		}
+
+		RunJobs(nJobs, pfnJob, pContext);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_nActiveWorkers--;
+		}
+
+		m_cvDone.notify_all();
+	}
+}
+
+void CWorkerPool::Run(int nJobs, WorkerJobFn pfnJob, void *pContext)
+{
+	if (m_vecThreads.empty() || nJobs <= 1)
+	{
+		for (int i = 0; i < nJobs; i++)
+			pfnJob(i, pContext);
+
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		// A worker that only woke up after the previous Run() returned could still be holding on to
+		// the old job counter, so wait for it to notice there's nothing left before resetting anything
+		m_cvDone.wait(lock, [&] { return m_nActiveWorkers == 0; });
+
+		m_nJobs = nJobs;
+		m_pfnJob = pfnJob;
+		m_pContext = pContext;
+		m_iNextJob = 0;
+		m_nJobsLeft = nJobs;
+		m_iGeneration++;
+	}
+
+	m_cvWork.notify_all();
+
+	RunJobs(nJobs, pfnJob, pContext);
+
+	// Every job has been claimed at this point, only wait for the ones still running on workers
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_cvDone.wait(lock, [&] { return m_nJobsLeft == 0; });
+}
@@ -0,0 +1,67 @@
+/**
+ * =============================================================================
+ * CS2Fixes
+ * Copyright (C) 2023-2024 Source2ZE
+ * =============================================================================
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License, version 3.0, as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef void (*WorkerJobFn)(int iJob, void *pContext);
+
+// Small persistent thread pool for splitting up work inside a single hook
+// Run() is fork-join: the calling thread takes jobs as well and it only returns once every job has finished,
+// so jobs can freely use data owned by the caller as long as no two jobs write to the same place
+class CWorkerPool
+{
+public:
+	CWorkerPool() {}
+	~CWorkerPool() { SetThreadCount(0); }
+
+	CWorkerPool(const CWorkerPool&) = delete;
+	CWorkerPool& operator=(const CWorkerPool&) = delete;
+
+	// Extra threads besides the caller, 0 stops them all and makes Run() serial
+	void SetThreadCount(int nThreads);
+	int GetThreadCount() { return (int)m_vecThreads.size(); }
+
+	// Runs pfnJob(0 .. nJobs - 1, pContext) in no particular order
+	void Run(int nJobs, WorkerJobFn pfnJob, void *pContext);
+
+private:
+	void WorkerMain();
+	void RunJobs(int nJobs, WorkerJobFn pfnJob, void *pContext);
+
+	std::vector<std::thread> m_vecThreads;
+	std::mutex m_mutex;
+	std::condition_variable m_cvWork;
+	std::condition_variable m_cvDone;
+
+	// Guarded by m_mutex
+	bool m_bStopping = false;
+	unsigned int m_iGeneration = 0;
+	int m_nActiveWorkers = 0;
+	int m_nJobs = 0;
+	WorkerJobFn m_pfnJob = nullptr;
+	void *m_pContext = nullptr;
+
+	std::atomic<int> m_iNextJob{0};
+	std::atomic<int> m_nJobsLeft{0};
+};
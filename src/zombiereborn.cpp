@@ -37,6 +37,7 @@
 #include "customio.h"
 #include <sstream>
 #include "leader.h"
+#include "playersnapshot.h"
 #include "tier0/vprof.h"
 #include <fstream>
 #include "vendor/nlohmann/json.hpp"
@@ -602,7 +603,7 @@ void CZRPlayerClassManager::ApplyHumanClass(std::shared_ptr<ZRHumanClass> pClass
 	{
 		CHandle<CCSPlayerPawn> hPawn = pPawn->GetHandle();
 
-		new CTimer(0.02f, false, false, [hPawn]()
+		new CTimer("zr_leader_visuals", 0.02f, false, false, [hPawn]()
 		{
 			CCSPlayerPawn *pPawn = hPawn.Get();
 			if (pPawn)
@@ -721,8 +722,7 @@ void CZRPlayerClassManager::GetZRClassList(int iTeam, CUtlVector<std::shared_ptr
 	}
 }
 
-double CZRRegenTimer::s_flNextExecution;
-CZRRegenTimer *CZRRegenTimer::s_vecRegenTimers[MAXPLAYERS];
+CTimerHandle CZRRegenTimer::s_vecRegenTimers[MAXPLAYERS];
 
 bool CZRRegenTimer::Execute()
 {
@@ -738,7 +738,7 @@ bool CZRRegenTimer::Execute()
 void CZRRegenTimer::StartRegen(float flRegenInterval, int iRegenAmount, CCSPlayerController *pController)
 {
 	int slot = pController->GetPlayerSlot();
-	CZRRegenTimer *pTimer = s_vecRegenTimers[slot];
+	CZRRegenTimer *pTimer = (CZRRegenTimer *)s_vecRegenTimers[slot].Get();
 	if (pTimer != nullptr)
 	{
 		pTimer->m_flInterval = flRegenInterval;
@@ -751,52 +751,17 @@ void CZRRegenTimer::StartRegen(float flRegenInterval, int iRegenAmount, CCSPlaye
 void CZRRegenTimer::StopRegen(CCSPlayerController *pController)
 {
 	int slot = pController->GetPlayerSlot();
-	if (!s_vecRegenTimers[slot])
-		return;
 
-	delete s_vecRegenTimers[slot];
-	s_vecRegenTimers[slot] = nullptr;
-}
-
-void CZRRegenTimer::Tick()
-{
-	// check every timer every 0.1
-	if (s_flNextExecution > g_flUniversalTime)
-		return;
-
-	VPROF("CZRRegenTimer::Tick");
-
-	s_flNextExecution = g_flUniversalTime + 0.1f;
-	for (int i = MAXPLAYERS - 1; i >= 0; i--)
-	{
-		CZRRegenTimer *pTimer = s_vecRegenTimers[i];
-		if (!pTimer)
-		{
-			continue;
-		}
-		
-		if (pTimer->m_flLastExecute == -1)
-			pTimer->m_flLastExecute = g_flUniversalTime;
-
-		// Timer execute 
-		if (pTimer->m_flLastExecute + pTimer->m_flInterval <= g_flUniversalTime)
-		{
-			pTimer->Execute();
-			pTimer->m_flLastExecute = g_flUniversalTime;
-		}
-	}
+	s_vecRegenTimers[slot].Cancel();
+	s_vecRegenTimers[slot] = CTimerHandle();
 }
 
 void CZRRegenTimer::RemoveAllTimers()
 {
 	for (int i = MAXPLAYERS - 1; i >= 0; i--)
 	{
-		if (!s_vecRegenTimers[i])
-		{
-			continue;
-		}
-		delete s_vecRegenTimers[i];
-		s_vecRegenTimers[i] = nullptr;
+		s_vecRegenTimers[i].Cancel();
+		s_vecRegenTimers[i] = CTimerHandle();
 	}
 }
 
@@ -805,7 +770,7 @@ void ZR_OnLevelInit()
 	g_ZRRoundState = EZRRoundState::ROUND_START;
 
 	// Delay one tick to override any .cfg's
-	new CTimer(0.02f, false, true, []()
+	new CTimer("zr_level_init", 0.02f, false, true, []()
 	{
 		// Here we force some cvars that are necessary for the gamemode
 		g_pEngineServer2->ServerCommand("mp_give_player_c4 0");
@@ -984,7 +949,7 @@ void ZR_OnPlayerSpawn(CCSPlayerController* pController)
 	}
 
 	CHandle<CCSPlayerController> handle = pController->GetHandle();
-	new CTimer(0.05f, false, false, [handle, bInfect]()
+	new CTimer("zr_spawn", 0.05f, false, false, [handle, bInfect]()
 	{
 		CCSPlayerController* pController = (CCSPlayerController*)handle.Get();
 		if (!pController)
@@ -1172,7 +1137,7 @@ void ZR_Infect(CCSPlayerController *pAttackerController, CCSPlayerController *pV
 		pZEPlayer->SetInfectState(true);
 
 		ZEPlayerHandle hPlayer = pZEPlayer->GetHandle();
-		new CTimer(g_flMoanInterval + (rand() % 5), false, false, [hPlayer]() { return ZR_MoanTimer(hPlayer); });
+		new CTimer("zr_moan", g_flMoanInterval + (rand() % 5), false, false, [hPlayer]() { return ZR_MoanTimer(hPlayer); });
 	}
 }
 
@@ -1210,7 +1175,7 @@ void ZR_InfectMotherZombie(CCSPlayerController *pVictimController, std::vector<S
 	pZEPlayer->SetInfectState(true);
 
 	ZEPlayerHandle hPlayer = pZEPlayer->GetHandle();
-	new CTimer(g_flMoanInterval + (rand() % 5), false, false, [hPlayer]() { return ZR_MoanTimer(hPlayer); });
+	new CTimer("zr_moan", g_flMoanInterval + (rand() % 5), false, false, [hPlayer]() { return ZR_MoanTimer(hPlayer); });
 }
 
 // make players who've been picked as MZ recently less likely to be picked again
@@ -1332,7 +1297,7 @@ void ZR_StartInitialCountdown()
 		V_swap(g_iInfectSpawnTimeMin, g_iInfectSpawnTimeMax);
 
 	g_iInfectionCountDown = g_iInfectSpawnTimeMin + (rand() % (g_iInfectSpawnTimeMax - g_iInfectSpawnTimeMin + 1));
-	new CTimer(0.0f, false, false, []()
+	new CTimer("zr_infect_countdown", 0.0f, false, false, []()
 	{
 		if (g_ZRRoundState != EZRRoundState::ROUND_START)
 			return -1.0f;
@@ -1454,7 +1419,7 @@ void SpawnPlayer(CCSPlayerController* pController)
 	}
 
 	CHandle<CCSPlayerController> handle = pController->GetHandle();
-	new CTimer(2.0f, false, false, [handle]()
+	new CTimer("zr_respawn", 2.0f, false, false, [handle]()
 	{
 		CCSPlayerController* pController = (CCSPlayerController*)handle.Get();
 		if (!pController || !g_bRespawnEnabled || pController->m_iTeamNum < CS_TEAM_T)
@@ -1524,7 +1489,7 @@ void ZR_OnPlayerDeath(IGameEvent* pEvent)
 
 	// respawn player
 	CHandle<CCSPlayerController> handle = pVictimController->GetHandle();
-	new CTimer(g_flRespawnDelay < 0.0f ? 2.0f : g_flRespawnDelay, false, false, [handle]()
+	new CTimer("zr_respawn", g_flRespawnDelay < 0.0f ? 2.0f : g_flRespawnDelay, false, false, [handle]()
 	{
 		CCSPlayerController* pController = (CCSPlayerController*)handle.Get();
 		if (!pController || !g_bRespawnEnabled || pController->m_iTeamNum < CS_TEAM_T)
@@ -1542,7 +1507,7 @@ void ZR_OnRoundFreezeEnd(IGameEvent* pEvent)
 // there is probably a better way to check when time is running out...
 void ZR_OnRoundTimeWarning(IGameEvent* pEvent)
 {
-	new CTimer(10.0, false, false, []()
+	new CTimer("zr_round_time_warning", 10.0, false, false, []()
 	{
 		if (g_ZRRoundState == EZRRoundState::ROUND_END)
 			return -1.0f;
@@ -1554,13 +1519,12 @@ void ZR_OnRoundTimeWarning(IGameEvent* pEvent)
 // check whether players on a team are all dead
 bool ZR_IsTeamAlive(int iTeamNum)
 {
-	CCSPlayerPawn* pPawn = nullptr;
-	while (nullptr != (pPawn = (CCSPlayerPawn*)UTIL_FindEntityByClassname(pPawn, "player")))
+	// Players die and switch teams mid-tick, so only the pawn pointers come from the snapshot
+	for (uint64 iMask = g_playerSnapshot.m_iPlayerPawnMask; iMask; iMask &= iMask - 1)
 	{
-		if (!pPawn->IsAlive())
-			continue;
-		
-		if (pPawn->m_iTeamNum() == iTeamNum)
+		CCSPlayerPawn* pPawn = g_playerSnapshot.m_pPlayerPawn[std::countr_zero(iMask)];
+
+		if (pPawn->IsAlive() && pPawn->m_iTeamNum() == iTeamNum)
 			return true;
 	}
 	return false;
@@ -1701,7 +1665,7 @@ CON_COMMAND_CHAT(ztele, "- Teleport to spawn")
 
 	CHandle<CCSPlayerPawn> pawnHandle = pPawn->GetHandle();
 
-	new CTimer(5.0f, false, false, [spawnHandle, pawnHandle, initialpos]()
+	new CTimer("ztele", 5.0f, false, false, [spawnHandle, pawnHandle, initialpos]()
 	{
 		CCSPlayerPawn* pPawn = pawnHandle.Get();
 		SpawnPoint* pSpawn = spawnHandle.Get();
@@ -217,22 +217,25 @@ private:
 	CUtlMap<uint32, std::shared_ptr<ZRHumanClass>> m_HumanClassMap;
 };
 
+// Tick timer so every player regenerating at the same interval gets healed on the same tick
 class CZRRegenTimer : public CTimerBase
 {
 public:
 	CZRRegenTimer(float flRegenInterval, int iRegenAmount, CHandle<CCSPlayerPawn> hPawnHandle) :
-		CTimerBase(flRegenInterval, false, false), m_iRegenAmount(iRegenAmount), m_hPawnHandle(hPawnHandle) {};
+		CTimerBase(flRegenInterval, false, false, "zr_regen"), m_iRegenAmount(iRegenAmount), m_hPawnHandle(hPawnHandle)
+	{
+		m_bTickMode = true;
+		AddTimer(this);
+	};
 
 	bool Execute();
 	static void StartRegen(float flRegenInterval, int iRegenAmount, CCSPlayerController *pController);
 	static void StopRegen(CCSPlayerController *pController);
 	static int GetIndex(CPlayerSlot slot);
-	static void Tick();
 	static void RemoveAllTimers();
 
 private:
-	static double s_flNextExecution;
-	static CZRRegenTimer *s_vecRegenTimers[MAXPLAYERS];
+	static CTimerHandle s_vecRegenTimers[MAXPLAYERS];
 	int m_iRegenAmount;
 	CHandle<CCSPlayerPawn> m_hPawnHandle;
 };